@@ -10,16 +10,52 @@
 #include "Type.h"
 #include <Lex/TokenKinds.h>
 #include <Sema/IdentifierInfo.h>
+#include <cstdint>
 
 INTERPRETER_NAMESPACE_BEGIN
 
 class token;
+class sema;
+
+/**
+ * The value of a numeric expression evaluated by a kernel. The
+ * value is always stored as a floating point number, and
+ * @code{is_integer} indicates whether it is an @code{INTEGER_T}.
+ */
+struct number_value {
+  FLOAT_POINT_T value;
+  bool is_integer;
+};
 
 /**
  * expr - represents an expression
  * @note expression is also a statement
  */
 class expr : public stmt {
+public:
+  /**
+   * The type of the value of the expression inferred by
+   * @code{sema::infer_type}. The result of the arithmetic operators
+   * on integers may be either an integer or a floating point number
+   * (e.g. 1 / 2), which depends on the value, so it is inferred as
+   * @code{ik_number}. @code{ik_unknown} means that the expression
+   * has not been inferred, or its type cannot be known yet.
+   */
+  enum inferred_kind : unsigned char {
+    ik_unknown,
+    ik_integer,
+    ik_float_point,
+    ik_number,
+    ik_string,
+    ik_tuple,
+    ik_void,
+  };
+  /**
+   * The evaluation function specialized for the operator and the
+   * inferred types of the operands. Returns false if the evaluation
+   * fails (the diagnostic has been reported).
+   */
+  using kernel_t = bool (*)(sema&, expr*, number_value&);
 protected:
   expr(stmt_kind kind, std::size_t start_loc, std::size_t end_loc )
     : stmt(kind, start_loc, end_loc) { }
@@ -27,6 +63,62 @@ public:
   [[nodiscard]] bool is_expr() const final { return true; }
   [[nodiscard]] virtual bool is_binary_expr() const { return false; }
   [[nodiscard]] virtual bool is_unary_expr() const { return false; }
+
+  [[nodiscard]] inferred_kind get_inferred_kind() const { return _inferred_kind; }
+  /**
+   * Returns true if the value of the expression never changes, which
+   * is only meaningful if the expression has been inferred.
+   */
+  [[nodiscard]] bool is_inferred_constant() const { return _inferred_constant; }
+  /**
+   * Returns the kernel used to evaluate the expression, or
+   * @code{nullptr} if the expression must be evaluated by the
+   * generic evaluator (e.g. it is not a numeric expression).
+   */
+  [[nodiscard]] kernel_t get_kernel() const { return _kernel; }
+  void set_inferred_info(inferred_kind kind, bool constant, kernel_t kernel) {
+    _inferred_kind = kind;
+    _inferred_constant = constant;
+    _kernel = kernel;
+  }
+
+  /**
+   * Returns the node whose value is shared by this node, or
+   * @code{nullptr}. The nodes which are the same subexpression of an
+   * expression share the value of the first one, which is computed
+   * only once in each evaluation of the whole expression (see
+   * @code{sema::evaluate}).
+   */
+  [[nodiscard]] expr* get_shared_node() const { return _shared; }
+  void set_shared_node(expr* e) { _shared = e; }
+  /**
+   * Returns true and sets @param{result} if the value has been cached
+   * in the evaluation @param{evaluation}.
+   */
+  bool find_cached_value(std::uint64_t evaluation, number_value& result) const {
+    if (_cached_evaluation != evaluation)
+      return false;
+    result = _cached_value;
+    return true;
+  }
+  void cache_value(std::uint64_t evaluation, number_value value) {
+    _cached_evaluation = evaluation;
+    _cached_value = value;
+  }
+  /**
+   * Whether the common subexpressions of the expression have been
+   * found, which is only meaningful on the roots.
+   */
+  [[nodiscard]] bool is_subexprs_shared() const { return _subexprs_shared; }
+  void set_subexprs_shared() { _subexprs_shared = true; }
+private:
+  inferred_kind _inferred_kind = ik_unknown;
+  bool _inferred_constant = false;
+  bool _subexprs_shared = false;
+  kernel_t _kernel = nullptr;
+  expr* _shared = nullptr;
+  std::uint64_t _cached_evaluation = 0;
+  number_value _cached_value{};
 };
 
 using expr_result_t = std::unique_ptr<expr>;
@@ -172,12 +264,29 @@ public:
 };
 
 class string_expr : public expr {
-  std::string value;
+  /**
+   * The value of the string if it is not the same as the characters
+   * in the source, e.g. it contains escape characters.
+   */
+  std::string _decoded;
+  string_ref value;
 public:
-  string_expr(std::string value, std::size_t start_loc, std::size_t end_loc)
-    : expr(string_expr_type, start_loc, end_loc), value(std::move(value)) { }
-
-  [[nodiscard]] const std::string& get_value() const { return value; }
+  /**
+   * Creates a string whose value is @param{value}, which refers to the
+   * source and is not copied.
+   */
+  string_expr(string_ref value, std::size_t start_loc, std::size_t end_loc)
+    : expr(string_expr_type, start_loc, end_loc), value(value) { }
+  string_expr(std::string decoded, std::size_t start_loc, std::size_t end_loc)
+    : expr(string_expr_type, start_loc, end_loc), _decoded(std::move(decoded)),
+      value(_decoded) { }
+  // A copy would refer to the decoded string of the original.
+  string_expr(const string_expr&) = delete;
+  string_expr(string_expr&&) = delete;
+  string_expr& operator=(const string_expr&) = delete;
+  string_expr& operator=(string_expr&&) = delete;
+
+  [[nodiscard]] string_ref get_value() const { return value; }
 };
 
 class tuple_expr : public expr {
@@ -239,12 +348,22 @@ public:
     _info = info;
   }
   [[nodiscard]] const function_info& get_bind_func() const { return *_info; }
+
+  /**
+   * Returns the call of @code{cos} on the same argument if this is a call
+   * of @code{sin}, or the call of @code{sin} if this is a call of
+   * @code{cos}, whose value is computed together with this one.
+   * Otherwise returns @code{nullptr}.
+   */
+  [[nodiscard]] call_expr* get_fused_call() const { return _fused; }
+  void set_fused_call(call_expr* e) { _fused = e; }
 private:
   string_ref _func_name;
   param_list_t _args;
   enum { FUNC_NAME, L_PAREN, R_PAREN, END };
   std::size_t _locs[END];
   const function_info* _info;
+  call_expr* _fused = nullptr;
 };
 
 /**
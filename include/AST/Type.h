@@ -177,7 +177,10 @@ struct get_type_impl<std::vector<Ty>> {
 template<class ArgTy>
 struct _prepare_arg_impl {
   static ArgTy get_arg(std::any arg) {
-    return std::any_cast<ArgTy>(arg);
+    return std::any_cast<ArgTy>(std::move(arg));
+  }
+  static void get_arg_to(const std::any& arg, ArgTy& result) {
+    result = std::any_cast<const ArgTy&>(arg);
   }
 };
 template<class ElemTy>
@@ -191,6 +194,12 @@ struct _prepare_arg_impl<std::vector<ElemTy>> {
     }
     return result;
   }
+  static void get_arg_to(const std::any& arg, std::vector<ElemTy>& result) {
+    const auto& vec = std::any_cast<const std::vector<std::any>&>(arg);
+    result.resize(vec.size());
+    for (std::size_t i = 0; i < vec.size(); ++i)
+      _prepare_arg_impl<ElemTy>::get_arg_to(vec[i], result[i]);
+  }
 };
 template<class Ty>
 struct _make_ret_value_impl {
@@ -227,7 +236,16 @@ std::vector<type> get_types() {
 
 template<class Ty>
 Ty unpack_value(std::any val) {
-  return _prepare_arg_impl<Ty>::get_arg(val);
+  return _prepare_arg_impl<Ty>::get_arg(std::move(val));
+}
+
+/**
+ * Unpacks @param{val} into @param{result} like @code{unpack_value}. The
+ * tuples are updated in place, which reuses their memory.
+ */
+template<class Ty>
+void unpack_value_to(const std::any& val, Ty& result) {
+  _prepare_arg_impl<Ty>::get_arg_to(val, result);
 }
 
 template<class Ty>
@@ -11,6 +11,7 @@
 #define DRAWING_LANG_INTERPRETER_DIAGCONSUMER_H
 
 #include <Utils/def.h>
+#include <ostream>
 
 INTERPRETER_NAMESPACE_BEGIN
 
@@ -34,6 +35,24 @@ class cmd_diag_consumer final : public diag_consumer {
 public:
   void report(const diag_data* data) override;
 };
+
+/**
+ * The consumer writes the diag messages to a stream in the same form as
+ * @code{cmd_diag_consumer}, e.g. to send them back to a client of the
+ * server mode.
+ */
+class stream_diag_consumer final : public diag_consumer {
+public:
+  explicit stream_diag_consumer(std::ostream& out) : _out(out) { }
+  void report(const diag_data* data) override;
+  /**
+   * Returns @code{true} if an error has been reported.
+   */
+  [[nodiscard]] bool has_error() const { return _has_error; }
+private:
+  std::ostream& _out;
+  bool _has_error = false;
+};
 INTERPRETER_NAMESPACE_END
 
 #endif //DRAWING_LANG_INTERPRETER_DIAGCONSUMER_H
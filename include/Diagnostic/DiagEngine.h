@@ -42,7 +42,7 @@ enum diag_id {
 
 class diag_engine {
 public:
-  diag_engine() : _file_manager(nullptr), _diag_consumer(nullptr) { }
+  diag_engine() : _file_manager(nullptr), _diag_consumer(nullptr), _scanned(0) { }
   void set_file(const file_manager* manager);
   void set_consumer(diag_consumer* consumer);
 
@@ -64,11 +64,23 @@ private:
   const file_manager* _file_manager;
   diag_consumer* _diag_consumer;
   /**
-   * Saves the start location of each line.
+   * Saves the start location of each line found so far. The lines are
+   * only found when a diagnostic needs them, and the file is scanned
+   * no further than the line of the location (see @code{_scan_lines}).
+   * After the whole file is scanned, the last element is the size of
+   * the file.
    */
-  std::vector<std::size_t> _lines;
+  mutable std::vector<std::size_t> _lines;
+  /**
+   * The number of characters scanned.
+   */
+  mutable std::size_t _scanned;
 
-  void _generate_line_cache();
+  /**
+   * Scans the file until the line containing @param{location} and the
+   * start of the next line are found.
+   */
+  void _scan_lines(std::size_t location) const;
 
   [[nodiscard]] std::optional<std::size_t>
   _get_line_num(std::size_t location, bool& invalid) const;
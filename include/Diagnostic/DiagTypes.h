@@ -22,6 +22,17 @@ ERROR(err_test_with_param_type, "This is a test error message with param: %0.")
 // Start
 ERROR(err_no_input_file, "no input file")
 ERROR(err_open_file, "cannot open file '%0'")
+ERROR(err_write_file, "cannot write file '%0'")
+ERROR(err_missing_option_value, "missing value after '%0'")
+ERROR(err_unknown_option, "unknown option '%0'")
+ERROR(err_option_conflict, "'%0' cannot be used with '%1'")
+ERROR(err_watch_file, "cannot watch file '%0'")
+ERROR(err_invalid_display_list, "'%0' is not a valid display list")
+ERROR(err_serve_socket, "cannot listen on socket '%0'")
+ERROR(err_run_timeout, "the program is stopped after running for %0 ms")
+ERROR(err_program_too_large, "the program is larger than %0 bytes")
+ERROR(err_run_failed, "the program is stopped by an internal error: %0")
+ERROR(err_sweep_stmt, "a variant can only assign the parameters")
 
 // Lexer
 WARNING(null_in_file, "null character ignored")
@@ -64,8 +75,11 @@ ERROR(err_mul_str_negative_num, "cannot multiply a string with a negative number
 ERROR(err_assign_constant, "cannot assign to constant")
 ERROR(err_assign_elem_count, "invalid value for '%0': requires %1 argument(s), but %2 provided")
 ERROR(err_size_value, "invalid value '%0' for '%1': cannot use negative numbers or zeros as size")
+ERROR(err_canvas_area, "invalid value for 'background_size': the canvas cannot have more than %0 pixels")
 ERROR(err_color_value, "invalid value '%0' used as color: the value must be between 0 and 255")
 ERROR(err_line_width, "invalid value '%0' for 'line_width'")
+ERROR(err_line_mode, "invalid value '%0' for 'line_mode': the value must be 0 or 1")
+ERROR(err_color_depth, "invalid value '%0' for 'color_depth': the value must be 8 or 32")
 WARNING(warn_set_after_drawing, "setting '%0' after drawing: value ignored")
 ERROR(err_assign_incompatible_type, "assigning to '%0' from incompatible type '%1'")
 ERROR(err_invalid_compare_type, "cannot compare '%0' with '%1'")
@@ -74,6 +88,13 @@ ERROR(err_deduced_variable_type, "cannot define variable of type '%0'")
 // Internal Impl
 ERROR(err_color_str, "invalid color value '%0'")
 ERROR(err_param_value, "invalid value '%0' for '%1'")
+ERROR(err_emit_frame, "cannot write frame to '%0'")
+
+// C++ emitter
+ERROR(err_emit_unsupported, "cannot translate %0 to C++")
+ERROR(err_emit_dynamic_type, "cannot deduce the type of '%0' before running the program")
+ERROR(err_emit_dynamic_call, "cannot resolve the call to '%0' before running the program")
+ERROR(err_unknown_parameter, "unknown parameter '%0'")
 
 #undef ERROR
 #undef WARNING
@@ -0,0 +1,62 @@
+/**
+ * This file defines the @code{cpp_emitter} class, which translates a
+ * program into a C++ translation unit.
+ *
+ * The emitted file is a complete program which includes
+ * @file{InternalSupport/Transpiled.h} and links against the
+ * @code{internal} library (with @code{sema}, @code{diag} and
+ * @code{utils}, which it depends on). It runs the statements as the
+ * interpreter does, but the expressions are compiled, and the
+ * predefined functions are called directly. The variables defined at
+ * the top level of the program with an Integer, Double or String value
+ * become parameters, which can be given as @code{name=value} in the
+ * command line of the emitted program to replace the values assigned
+ * to them in their definitions.
+ *
+ * The overloads of the calls are resolved when the program is emitted,
+ * so the calls whose overloads depend on the values of more than one
+ * argument cannot be emitted, nor can the operators on strings and
+ * tuples, or the tuples whose types depend on the values. Whether a
+ * number is an Integer is decided when running the program as the
+ * interpreter does. The errors found while emitting (including the
+ * errors the interpreter would report when running the program, such
+ * as calling an unknown function) are reported as diagnostics.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_CPPEMITTER_H
+#define DRAWING_LANG_INTERPRETER_CPPEMITTER_H
+
+#include <AST/Stmt.h>
+#include <Sema/Sema.h>
+#include <Utils/FileManager.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+class cpp_emitter {
+public:
+  /**
+   * @param{action} must use a symbol table to which
+   * @code{internal_impl::export_all_symbols} has exported the
+   * predefined symbols. The variables defined by the program are added
+   * to it while emitting.
+   */
+  explicit cpp_emitter(sema& action) : action(action) { }
+
+  /**
+   * Emits the C++ program for @param{stmts}, which are parsed from
+   * @param{source}. Returns @code{std::nullopt} if the program cannot
+   * be emitted.
+   */
+  [[nodiscard]] std::optional<std::string>
+  emit(const std::vector<stmt_result_t>& stmts, const file_manager& source);
+private:
+  sema& action;
+};
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_CPPEMITTER_H
@@ -0,0 +1,77 @@
+/**
+ * This file defines the @code{stmt_effects} class, which summarizes
+ * what a statement reads and writes when it runs.
+ *
+ * The effects are found from the syntax tree only: the variables are
+ * identified by their names, and a statement is assumed to have every
+ * effect of all its parts, even if it stops early because of an error.
+ * The interpreter uses them to find the statements which can be
+ * evaluated before the statements in front of them finish (see
+ * @code{interpreter::run_stmts}).
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_EFFECTS_H
+#define DRAWING_LANG_INTERPRETER_EFFECTS_H
+
+#include <AST/Stmt.h>
+#include <AST/Expr.h>
+#include <Utils/StringRef.h>
+#include <vector>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+class stmt_effects {
+public:
+  /**
+   * Returns true if the value of variable @param{name} is read, not
+   * including the drawing state read by the draw calls.
+   */
+  [[nodiscard]] bool reads(string_ref name) const;
+  /**
+   * Returns true if variable @param{name} is assigned or defined.
+   */
+  [[nodiscard]] bool writes(string_ref name) const;
+  [[nodiscard]] const std::vector<string_ref>& get_reads() const { return _reads; }
+  [[nodiscard]] const std::vector<string_ref>& get_writes() const { return _writes; }
+  /**
+   * Returns true if the statement draws on the canvas, which reads the
+   * drawing state (see @code{is_drawing_state}).
+   */
+  [[nodiscard]] bool draws() const { return _draws; }
+  /**
+   * Returns true if the statement prints, saves or emits the picture,
+   * or clears it, whose order must be kept.
+   */
+  [[nodiscard]] bool has_io() const { return _io; }
+
+  /**
+   * Returns true if the statement reads something which @param{earlier}
+   * writes, so it cannot be evaluated before @param{earlier} finishes.
+   */
+  [[nodiscard]] bool depends_on(const stmt_effects& earlier) const;
+
+  /**
+   * Returns true if variable @param{name} changes how the points are
+   * drawn, e.g. @code{origin} and @code{line_color}.
+   */
+  static bool is_drawing_state(string_ref name);
+
+  /**
+   * Adds the effects of @param{s} (and all its parts).
+   */
+  void add(stmt* s);
+  void add_read(string_ref name);
+  void add_write(string_ref name);
+private:
+  std::vector<string_ref> _reads;
+  std::vector<string_ref> _writes;
+  bool _draws = false;
+  bool _io = false;
+
+  friend class effect_collector;
+};
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_EFFECTS_H
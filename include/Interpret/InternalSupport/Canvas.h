@@ -0,0 +1,277 @@
+/**
+ * This file defines the @code{canvas} class, which is the image the
+ * predefined functions draw on.
+ *
+ * The canvas is split into square tiles, and a tile is allocated only
+ * when something is drawn on it. The tiles that are never touched are
+ * filled with the background color implicitly, so the memory used by
+ * the canvas depends on the area that is drawn, rather than the size
+ * of the canvas. This allows a very large @code{background_size}.
+ *
+ * The canvas also remembers the tiles which are changed since the last
+ * frame, so @code{frame_encoder} only converts these tiles again, and
+ * @code{canvas::clear} only resets the tiles which have been drawn on.
+ *
+ * Copying a canvas shares the tiles, and a shared tile is copied when
+ * it is drawn on again, so a copy of the canvas (e.g. a checkpoint in
+ * the watch mode) costs only the tiles which are changed after it.
+ *
+ * The pixels are 8-bit BGR unless the background is translucent or a
+ * higher precision is asked for (see @code{canvas::pixel_format}). The
+ * translucent colors are composited source-over: a primitive is first
+ * rasterized into a coverage mask, and the color is blended into the
+ * pixels by the coverage. The other pixel formats keep premultiplied
+ * alpha, which makes the blending a multiply-add per channel, and are
+ * converted to 8-bit straight alpha only when the canvas is written.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_CANVAS_H
+#define DRAWING_LANG_INTERPRETER_CANVAS_H
+
+#include <Utils/def.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+class canvas {
+public:
+  /**
+   * The width and the height of a tile in pixels.
+   */
+  static constexpr int tile_size = 256;
+
+  enum class pixel_format : unsigned char {
+    /**
+     * 8-bit BGR, which is always opaque.
+     */
+    bgr,
+    /**
+     * 8-bit BGRA with premultiplied alpha.
+     */
+    bgra,
+    /**
+     * 32-bit floating-point BGRA in [0, 1] with premultiplied alpha,
+     * so that many faint colors add up without rounding errors (e.g.
+     * a density plot of millions of points).
+     */
+    bgra_float,
+  };
+
+  canvas() = default;
+  /**
+   * Creates a canvas filled with @param{background}, which is a BGRA
+   * color in [0, 255]. The alpha is ignored by the BGR format.
+   */
+  canvas(cv::Size size, cv::Scalar background, pixel_format format = pixel_format::bgr);
+
+  [[nodiscard]] bool empty() const { return _size.width == 0 || _size.height == 0; }
+  [[nodiscard]] cv::Size size() const { return _size; }
+  [[nodiscard]] pixel_format format() const { return _format; }
+  /**
+   * Returns the number of the channels of the images rendered from the
+   * canvas, which is 4 if the canvas has an alpha channel.
+   */
+  [[nodiscard]] int channels() const { return _format == pixel_format::bgr ? 3 : 4; }
+  [[nodiscard]] bool contains(cv::Point p) const {
+    return p.x >= 0 && p.y >= 0 && p.x < _size.width && p.y < _size.height;
+  }
+  /**
+   * Returns the number of the tiles which have been allocated.
+   */
+  [[nodiscard]] std::size_t allocated_tiles() const { return _drawn_tiles.size(); }
+  /**
+   * Returns the fraction of the area of the canvas in the tiles which
+   * have ever been drawn on, including the ones which are cleared.
+   */
+  [[nodiscard]] double touched_fraction() const;
+  /**
+   * Returns the indices of the tiles (in row-major order) which have
+   * changed since the last call, and forgets them. Every tile of a new
+   * canvas is changed.
+   */
+  std::vector<std::size_t> take_dirty_tiles();
+  /**
+   * Fills the canvas with the background color again. Only the tiles
+   * which have been drawn on are reset.
+   */
+  void clear();
+
+  /**
+   * Marks the pixel @param{p} as stamped. Returns false if the pixel
+   * has been stamped since the last call of @code{clear_stamps}, so
+   * the caller can skip drawing the same primitive on it again.
+   */
+  bool stamp(cv::Point p);
+  void clear_stamps();
+
+  /**
+   * Draws a filled anti-aliased circle. The coordinates and the radius
+   * have @param{shift} fractional bits, as in @code{cv::circle}. The
+   * color is BGRA in [0, 255], and it is composited if it is not opaque.
+   */
+  void circle(cv::Point center, int radius, const cv::Scalar& color, int shift);
+  /**
+   * Draws an anti-aliased open polyline, as in @code{cv::polylines}.
+   * The color is the same as that of @code{circle}.
+   */
+  void polylines(const std::vector<cv::Point>& points, const cv::Scalar& color,
+                 int thickness, int shift);
+
+  /**
+   * Copies the rows [@param{begin}, @param{end}) of the canvas to
+   * a dense 8-bit image, which is BGR or BGRA with straight alpha
+   * (see @code{channels}).
+   */
+  [[nodiscard]] cv::Mat render_rows(int begin, int end) const;
+  /**
+   * Writes the canvas to the file @param{path}, and the image is
+   * flipped vertically if @param{flip} is true. PPM/PNM and PNG files
+   * are written band by band, so the whole image never exists in the
+   * memory. Other formats are encoded by OpenCV. The alpha channel is
+   * dropped by the formats without it (e.g. PPM). Returns false if the
+   * file cannot be written.
+   */
+  bool write(const std::string& path, bool flip) const;
+  /**
+   * Encodes the canvas into @param{result} as @code{write} writes the
+   * file @param{path}, but the file is not written. Returns false if
+   * the format of @param{path} is not supported.
+   */
+  bool encode(const std::string& path, std::string& result, bool flip) const;
+  /**
+   * Writes the canvas to @param{out} as a binary PPM (P6) image, which
+   * is a frame of a video stream made of concatenated PPM images.
+   * Returns false if the frame cannot be written.
+   */
+  bool write_frame(std::ostream& out, bool flip) const;
+private:
+  friend class frame_encoder;
+
+  cv::Size _size;
+  pixel_format _format = pixel_format::bgr;
+  /**
+   * The background color in the pixel format of the canvas, and the
+   * background pixel of the rendered images.
+   */
+  cv::Scalar _background;
+  uchar _background_pixel[4] = { };
+  int _tile_cols = 0;
+  int _tile_rows = 0;
+  /**
+   * The tiles in row-major order. A null pointer means the tile has
+   * not been drawn on. The tiles on the right and the bottom edges are
+   * cropped to the canvas. The tiles may be shared with the copies of
+   * the canvas, and are copied before they are changed.
+   */
+  std::vector<std::shared_ptr<cv::Mat>> _tiles;
+  /**
+   * The tiles which have been allocated.
+   */
+  std::vector<std::size_t> _drawn_tiles;
+  /**
+   * The state of each tile, made of the bits below, and the tiles which
+   * have changed since the last frame. @code{_all_dirty} means all the
+   * tiles have changed, as in a new canvas.
+   */
+  enum : std::uint8_t { _dirty_bit = 1, _touched_bit = 2 };
+  std::vector<std::uint8_t> _tile_state;
+  std::vector<std::size_t> _dirty_tiles;
+  bool _all_dirty = true;
+  std::uint64_t _touched_area = 0;
+  /**
+   * The stamp bitmaps of the tiles, one bit per pixel, and the
+   * tiles which have been stamped since they are cleared.
+   */
+  std::vector<std::vector<std::uint64_t>> _stamps;
+  std::vector<std::size_t> _stamped_tiles;
+  /**
+   * The coverage mask of a tile which the translucent primitives are
+   * rasterized into. It is all zeros except in @code{_draw_on_tile}.
+   * The copies of the canvas do not share it, since they may draw on
+   * other threads (e.g. the variants of a parameter sweep).
+   */
+  struct _scratch_mask {
+    cv::Mat mask;
+
+    _scratch_mask() = default;
+    _scratch_mask(const _scratch_mask&) { }
+    _scratch_mask& operator=(const _scratch_mask&) { return *this; }
+  };
+  _scratch_mask _coverage;
+
+  [[nodiscard]] cv::Rect _get_tile_rect(int tile_x, int tile_y) const;
+  cv::Mat& _touch_tile(int tile_x, int tile_y);
+  void _mark_dirty(std::size_t tile);
+  /**
+   * Draws a primitive of @param{color} on a tile by calling
+   * @param{draw} with the image to draw on and the color to draw with.
+   * The primitive is in the box @param{box} (in pixels).
+   */
+  template<class Draw>
+  void _draw_on_tile(int tile_x, int tile_y, cv::Rect box, const cv::Scalar& color, Draw&& draw);
+  /**
+   * Converts @param{count} pixels at @param{src} to the pixels of the
+   * rendered images (see @code{render_rows}).
+   */
+  void _convert_pixels(const uchar* src, uchar* dst, int count) const;
+  /**
+   * Returns the range of the tiles [x0, x1) * [y0, y1) which overlap
+   * the box [min, max] (in pixels), or an empty range.
+   */
+  [[nodiscard]] cv::Rect _get_tile_range(cv::Point min, cv::Point max) const;
+  /**
+   * Copies the row @param{y} of the canvas to @param{row}. The pixels
+   * of the untouched tiles are copied from @param{background}, which
+   * is a row filled with the background color.
+   */
+  void _copy_row(int y, uchar* row, const uchar* background) const;
+  /**
+   * Converts the tile @param{tile} to RGB and copies it to the right
+   * place of @param{image}, which has the same size as the canvas and
+   * is flipped vertically if @param{flip} is true.
+   */
+  void _copy_tile_rgb(std::size_t tile, uchar* image, bool flip) const;
+};
+
+/**
+ * Writes the frames of a canvas as @code{canvas::write_frame} does.
+ * The last frame is kept, and only the tiles which have changed since
+ * it are converted again, so an animation which changes a small part of
+ * the canvas in each frame does not convert the whole canvas every time.
+ */
+class frame_encoder {
+public:
+  /**
+   * Writes @param{image} to @param{out} as a binary PPM (P6) image.
+   * The changed tiles of @param{image} are forgotten (see
+   * @code{canvas::take_dirty_tiles}), so all the frames of a canvas
+   * must be written by the same encoder. Returns false if the frame
+   * cannot be written.
+   */
+  bool write(canvas& image, std::ostream& out, bool flip);
+  /**
+   * Forgets the last frame, e.g. when the canvas is replaced by
+   * another one.
+   */
+  void reset() { _frame.clear(); }
+private:
+  cv::Size _size;
+  bool _flip = false;
+  /**
+   * The header and the pixels of the last frame.
+   */
+  std::vector<uchar> _frame;
+  std::size_t _header_size = 0;
+};
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_CANVAS_H
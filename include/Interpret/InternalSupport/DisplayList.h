@@ -0,0 +1,189 @@
+/**
+ * This file defines the @code{display_list} class, which records
+ * the drawing operations of a program so that the picture can be
+ * rendered again (e.g. at another resolution) without running the
+ * program.
+ *
+ * The points are recorded before they are transformed, together with
+ * the @code{origin}, @code{scale}, @code{rot}, @code{line_width},
+ * @code{line_color} and @code{line_mode} used to draw them. A state is
+ * only recorded when it changes. All the records are packed into a
+ * byte buffer in the native byte order.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_DISPLAYLIST_H
+#define DRAWING_LANG_INTERPRETER_DISPLAYLIST_H
+
+#include <AST/Type.h>
+#include "Canvas.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+class display_list {
+public:
+  struct draw_state {
+    std::array<INTEGER_T, 2> origin;
+    std::array<FLOAT_POINT_T, 2> scale;
+    FLOAT_POINT_T rot;
+    INTEGER_T line_width;
+    /**
+     * RGBA, and the alpha is 255 if @code{line_color} has 3 components.
+     */
+    std::array<INTEGER_T, 4> line_color;
+    INTEGER_T line_mode;
+
+    bool operator==(const draw_state& rhs) const {
+      return origin == rhs.origin && scale == rhs.scale && rot == rhs.rot &&
+             line_width == rhs.line_width && line_color == rhs.line_color &&
+             line_mode == rhs.line_mode;
+    }
+    bool operator!=(const draw_state& rhs) const { return !(*this == rhs); }
+  };
+
+  /**
+   * Records that the canvas is created with the size, the background
+   * color (RGBA) and the pixel format.
+   */
+  void record_canvas(cv::Size size, const std::array<INTEGER_T, 4>& color, canvas::pixel_format format);
+  /**
+   * Records the state used by the following points. Nothing is
+   * recorded if the state is the same as the last one.
+   */
+  void record_state(const draw_state& state);
+  /**
+   * Records a point drawn by the @code{draw} call @param{site}.
+   */
+  void record_point(cv::Point2d p, std::size_t site);
+  void record_begin_stroke() { _put(_op::begin_stroke); }
+  void record_end_stroke() { _put(_op::end_stroke); }
+  void record_skip_points() { _put(_op::skip_points); }
+  /**
+   * Records that all the pending strokes are rendered (e.g. by
+   * @code{save}).
+   */
+  void record_flush() { _put(_op::flush); }
+  /**
+   * Records that the canvas is filled with the background color again
+   * (by @code{clear}).
+   */
+  void record_clear() { _put(_op::clear); }
+
+  /**
+   * Returns the size of the buffer in bytes.
+   */
+  [[nodiscard]] std::size_t size() const { return _buffer.size(); }
+
+  bool save(const std::string& path) const;
+  static std::optional<display_list> load(const std::string& path);
+
+  /**
+   * Calls the member functions of @param{visitor} for each record in
+   * order:
+   *
+   *   on_canvas(cv::Size, const std::array<INTEGER_T, 4>&, canvas::pixel_format)
+   *   on_state(const draw_state&)
+   *   on_point(cv::Point2d, std::size_t)
+   *   on_begin_stroke(), on_end_stroke(), on_skip_points(), on_flush(),
+   *   on_clear()
+   *
+   * Returns false if the buffer is broken.
+   */
+  template<class Visitor>
+  bool replay(Visitor& visitor) const;
+private:
+  enum class _op : unsigned char {
+    canvas,
+    state,
+    point,
+    begin_stroke,
+    end_stroke,
+    skip_points,
+    flush,
+    clear,
+  };
+
+  std::vector<unsigned char> _buffer;
+  std::optional<draw_state> _last_state;
+
+  template<class T>
+  void _put(const T& value) {
+    std::size_t pos = _buffer.size();
+    _buffer.resize(pos + sizeof(T));
+    std::memcpy(_buffer.data() + pos, &value, sizeof(T));
+  }
+
+  template<class T>
+  bool _get(std::size_t& pos, T& value) const {
+    if (_buffer.size() - pos < sizeof(T))
+      return false;
+    std::memcpy(&value, _buffer.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+  }
+};
+
+template<class Visitor>
+bool display_list::replay(Visitor& visitor) const {
+  std::size_t pos = 0;
+  while (pos < _buffer.size()) {
+    _op op;
+    _get(pos, op);
+    switch (op) {
+    case _op::canvas: {
+      std::int32_t width, height;
+      std::array<INTEGER_T, 4> color;
+      canvas::pixel_format format;
+      if (!_get(pos, width) || !_get(pos, height) || !_get(pos, color) || !_get(pos, format) ||
+          format > canvas::pixel_format::bgra_float)
+        return false;
+      visitor.on_canvas(cv::Size(width, height), color, format);
+      break;
+    }
+    case _op::state: {
+      draw_state state;
+      if (!_get(pos, state))
+        return false;
+      visitor.on_state(state);
+      break;
+    }
+    case _op::point: {
+      std::uint32_t site;
+      double x, y;
+      if (!_get(pos, site) || !_get(pos, x) || !_get(pos, y))
+        return false;
+      visitor.on_point(cv::Point2d(x, y), site);
+      break;
+    }
+    case _op::begin_stroke:
+      visitor.on_begin_stroke();
+      break;
+    case _op::end_stroke:
+      visitor.on_end_stroke();
+      break;
+    case _op::skip_points:
+      visitor.on_skip_points();
+      break;
+    case _op::flush:
+      visitor.on_flush();
+      break;
+    case _op::clear:
+      visitor.on_clear();
+      break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_DISPLAYLIST_H
@@ -8,8 +8,20 @@
 #define DRAWING_LANG_INTERPRETER_INTERNALIMPL_H
 
 #include <AST/Type.h>
+#include <Sema/Interval.h>
+#include <Utils/StringRef.h>
+#include <Interpret/InternalSupport/Canvas.h>
+#include <Interpret/InternalSupport/DisplayList.h>
+#include <Interpret/InternalSupport/Random.h>
 #include <type_traits>
+#include <cstdint>
+#include <fstream>
 #include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
 
 // OpenCV
 #include <opencv2/core.hpp>
@@ -25,9 +37,142 @@ struct diag_info_pack;
  */
 class internal_impl {
 public:
+  /**
+   * The most numbers @code{rand_floats} and @code{rand_normals} make,
+   * so a mistyped count is reported instead of exhausting the memory.
+   */
+  static constexpr INTEGER_T max_random_count = 1 << 20;
+
   void export_all_symbols(symbol_table& table);
+  /**
+   * Limits the number of the pixels of the canvas, beyond which
+   * @code{background_size} reports an error, e.g. so that a program run
+   * by the server cannot make a picture too large to encode in memory.
+   * 0 means no limit.
+   */
+  void set_max_canvas_area(std::uint64_t area) { _max_canvas_area = area; }
+  /**
+   * Returns @code{true} if @param{name} is a predefined variable or
+   * constant.
+   */
+  static bool is_predefined_variable(string_ref name);
+
+  /**
+   * The values of the predefined variables and the drawing state
+   * (including the canvas), which the watch mode saves at the
+   * boundaries of the statements (see @file{Watch.h}). The tiles of
+   * the canvas are shared until they are drawn on again. The display
+   * list is not saved.
+   */
+  struct snapshot;
+  [[nodiscard]] std::shared_ptr<const snapshot> take_snapshot() const;
+  void restore(const snapshot& s);
+
+  using native_math_func_t = FLOAT_POINT_T (*)(FLOAT_POINT_T);
+  /**
+   * Returns a plain function which computes the same result as the
+   * predefined math function @param{name} on a Double, or nullptr if
+   * there is no such function. The diagnostics of the predefined
+   * functions are only made for the results which are not finite, so
+   * the caller can check the result instead.
+   */
+  static native_math_func_t get_native_math_function(string_ref name);
+
+  /**
+   * Marks the start of a connected stroke, used when @code{line_mode}
+   * is not 0. The interpreter calls it whenever a loop (re)starts, so
+   * the points drawn by the loop are joined into polylines, while the
+   * points drawn by different runs of the loop are never connected.
+   */
+  void begin_stroke();
+  /**
+   * Renders all the pending strokes and marks the end of the
+   * current connected stroke.
+   */
+  void end_stroke();
+  /**
+   * Records that some points are not drawn because they are proved to
+   * be off the canvas. The canvas is created as drawing does, and all
+   * the pending strokes are broken.
+   */
+  void skip_points();
+
+  /**
+   * Returns @code{true} if all the points (x, y) in the box
+   * @param{x} * @param{y} will be transformed to the outside of the
+   * canvas with the current @code{origin}, @code{scale} and @code{rot}.
+   */
+  [[nodiscard]] bool is_off_canvas(interval x, interval y) const;
+
+  /**
+   * Starts recording the drawing operations into a display list.
+   */
+  void start_recording();
+  /**
+   * Returns the recorded display list, or nullptr if the
+   * recording has not been started.
+   */
+  [[nodiscard]] const display_list* get_display_list() const;
+  /**
+   * Renders @param{list} again on a canvas of @param{size} and
+   * saves the picture to @param{path}. The picture is stretched to
+   * the new size, and the width of the lines is scaled as well.
+   * Returns false if the display list is broken.
+   */
+  bool replay(const display_list& list, cv::Size size, const std::string& path);
+
+  /**
+   * The number of the points drawn on the canvas, and the number of
+   * them which are actually rasterized. The others are dropped because
+   * they fall on a pixel (or the last vertex of a polyline) which has
+   * been drawn with the same line state.
+   */
+  struct render_stats {
+    std::size_t visible_points = 0;
+    std::size_t rasterized_points = 0;
+
+    /**
+     * Returns how many points are drawn for each rasterized one,
+     * or 0 if nothing is rasterized.
+     */
+    [[nodiscard]] FLOAT_POINT_T overdraw_ratio() const;
+  };
+  [[nodiscard]] const render_stats& get_render_stats() const { return _render_stats; }
+  /**
+   * Returns the fraction of the canvas which has been drawn on (see
+   * @code{canvas::touched_fraction}).
+   */
+  [[nodiscard]] FLOAT_POINT_T get_touched_fraction() const { return _draw_map.touched_fraction(); }
+
+  /**
+   * Keeps the results of the program in memory instead of writing them
+   * to stdout and the files, e.g. to return them to a client of the
+   * server mode (see @file{Serve.h}). The output of @code{print} and
+   * the frames of @code{emit_frame} (whatever the path is) are written
+   * to @param{output}, and the picture of each @code{save} replaces
+   * @param{image}, encoded as the file would be.
+   */
+  void capture_output(std::ostream& output, std::string& image);
+  /**
+   * Renders the pending strokes and encodes the canvas as the image
+   * file @param{path}, without writing the file (see
+   * @code{canvas::encode}).
+   */
+  bool encode_picture(const std::string& path, std::string& result);
+  /**
+   * Renders the pending strokes and writes the canvas to the image file
+   * @param{path} as @code{save} does, even if the output is captured.
+   * Returns false if the file cannot be written.
+   */
+  bool write_picture(const std::string& path);
 private:
-#define PREDEFINED_VARIABLE_WITH_FILTER(NAME, TYPE, VALUE, FILTER) PREDEFINED_VARIABLE(NAME, TYPE, VALUE)
+  /**
+   * The programs emitted by @code{cpp_emitter} use the predefined
+   * symbols directly (see @file{Transpiled.h}).
+   */
+  friend class transpiled_runtime;
+
+#define PREDEFINED_VARIABLE_WITH_FILTER(NAME, TYPE, VALUE, FILTER) TYPE _##NAME = VALUE;
 #define PREDEFINED_VARIABLE(NAME, TYPE, VALUE) TYPE _##NAME = VALUE;
 #define PREDEFINED_CONSTANT(NAME, TYPE, VALUE) std::add_const_t<TYPE> _##NAME = TYPE(VALUE);
 #define PREDEFINED_FUNCTION(spelling, FUNC_NAME, RET, ...) RET FUNC_NAME(__VA_ARGS__);
@@ -38,10 +183,111 @@ private:
 
   // internal status
   bool _have_drawn = false;
-  cv::Mat _draw_map;
+  std::uint64_t _max_canvas_area = 0;
+  /**
+   * The generator of the random functions. It is restarted by the value
+   * filter of @code{seed}, which is a const member function.
+   */
+  mutable philox_random _random;
+  canvas _draw_map;
+  /**
+   * Creates the canvas. It keeps the alpha if @code{background_color}
+   * has 4 components, and floating-point pixels if @code{color_depth}
+   * is 32 (see @code{canvas::pixel_format}).
+   */
   void _create_map();
+  /**
+   * Fills the canvas with the background color again, and drops the
+   * strokes which have not been rendered.
+   */
+  void _clear_map();
+  /**
+   * Creates the canvas if nothing has been drawn, and renders the
+   * pending strokes, before the canvas is written.
+   */
+  void _finish_picture();
+  /**
+   * Renders the pending strokes and writes the canvas to @param{out} as
+   * a frame (see @code{canvas::write_frame}). The frames written to
+   * stdout and the file share @code{_frame_encoder}, which only converts
+   * the tiles changed since the last frame.
+   */
+  bool _emit_frame(std::ostream& out);
+  frame_encoder _frame_encoder;
+  /**
+   * The file which @code{emit_frame} writes to. It stays open for the
+   * following frames, since closing a named pipe ends the stream read
+   * by the other side (e.g. ffmpeg).
+   */
+  std::string _frame_path;
+  std::unique_ptr<std::ofstream> _frame_file;
+  /**
+   * Where the output goes, which is changed by @code{capture_output}.
+   * The saved pictures are written to the files if @code{_saved_image}
+   * is nullptr.
+   */
+  std::ostream* _output = &std::cout;
+  std::string* _saved_image = nullptr;
   cv::Point2d _transform(cv::Point2d input) const;
-  void _draw_point(cv::Point2d p);
+  [[nodiscard]] cv::Size _get_canvas_size() const;
+  /**
+   * Draws a point. @param{site} identifies the @code{draw} call which
+   * draws the point, and the points drawn by the same call in a loop are
+   * connected if @code{line_mode} is not 0.
+   */
+  void _draw_point(cv::Point2d p, std::size_t site);
+
+  /**
+   * The factors applied to the transformed points and the line width
+   * when a display list is replayed at another resolution.
+   */
+  cv::Point2d _resolution = { 1, 1 };
+  FLOAT_POINT_T _line_scale = 1;
+  std::optional<display_list> _display_list;
+  render_stats _render_stats;
+  /**
+   * The line state of the stamps on the canvas.
+   */
+  int _stamp_radius = 0;
+  cv::Scalar _stamp_color;
+  struct _replayer;
+  [[nodiscard]] display_list::draw_state _get_draw_state() const;
+
+  /**
+   * A polyline waiting to be rendered. The points are saved in
+   * fixed-point form (see @code{_stroke_shift}) so that the
+   * rasterizer can place them with sub-pixel accuracy.
+   */
+  struct _stroke_t {
+    std::vector<cv::Point> points;
+    cv::Scalar color;
+    INTEGER_T width = 1;
+  };
+  static constexpr int _stroke_shift = 4;
+  /**
+   * The nesting depth of the loops. Points are only connected in loops.
+   */
+  std::size_t _stroke_depth = 0;
+  /**
+   * The pending strokes in the order of their first points, so that the
+   * overlapping strokes are always drawn in the same order, and their
+   * indices by the call site of draw.
+   */
+  std::vector<_stroke_t> _strokes;
+  std::unordered_map<std::size_t, std::size_t> _stroke_index;
+  /**
+   * Returns the line color in BGRA, whose alpha is 255 if
+   * @code{line_color} has 3 components.
+   */
+  [[nodiscard]] cv::Scalar _get_line_color() const;
+  /**
+   * Returns the radius of the points drawn with @param{width}, in the
+   * fixed-point form.
+   */
+  [[nodiscard]] int _get_point_radius(INTEGER_T width) const;
+  [[nodiscard]] int _get_line_thickness(INTEGER_T width) const;
+  void _flush_stroke(_stroke_t& s);
+  void _flush_all_strokes();
 };
 
 INTERPRETER_NAMESPACE_END
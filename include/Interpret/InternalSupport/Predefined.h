@@ -68,8 +68,11 @@ PREDEFINED_VARIABLE(t, FLOAT_POINT_T, 0.0)
 PREDEFINED_VARIABLE(P, std::vector<FLOAT_POINT_T>, LIST(0))
 PREDEFINED_VARIABLE_WITH_FILTER(background_size, std::vector<INTEGER_T>, LIST(500, 500), _background_size_value_filter)
 PREDEFINED_VARIABLE_WITH_FILTER(background_color, std::vector<INTEGER_T>, LIST(255, 255, 255), _background_color_value_filter)
+PREDEFINED_VARIABLE_WITH_FILTER(color_depth, INTEGER_T, 8, _color_depth_value_filter)
 PREDEFINED_VARIABLE_WITH_FILTER(line_width, INTEGER_T, 1, _line_width_value_filter)
 PREDEFINED_VARIABLE_WITH_FILTER(line_color, std::vector<INTEGER_T>, LIST(0, 0, 0), _line_color_value_filter)
+PREDEFINED_VARIABLE_WITH_FILTER(line_mode, INTEGER_T, 0, _line_mode_value_filter)
+PREDEFINED_VARIABLE_WITH_FILTER(seed, INTEGER_T, 0, _seed_value_filter)
 
 PREDEFINED_CONSTANT(PI, FLOAT_POINT_T, 3.14159265358979323846)
 PREDEFINED_CONSTANT(E, FLOAT_POINT_T, 2.718281828459)
@@ -87,10 +90,18 @@ PREDEFINED_CONST_FUNCTION(cos, _internal_cos_float, FLOAT_POINT_T, FLOAT_POINT_T
 PREDEFINED_CONST_FUNCTION(sin, _internal_sin_float, FLOAT_POINT_T, FLOAT_POINT_T)
 PREDEFINED_CONST_FUNCTION(tan, _internal_tan_float, FLOAT_POINT_T, DIAG, FLOAT_POINT_T)
 PREDEFINED_CONST_FUNCTION(ln, _internal_ln_float, FLOAT_POINT_T, DIAG, FLOAT_POINT_T)
-PREDEFINED_CONST_FUNCTION(rand_int, _internal_rand_integer, INTEGER_T, INTEGER_T, INTEGER_T)
+// random functions (see Random.h)
+PREDEFINED_FUNCTION(rand_int, _internal_rand_integer, INTEGER_T, INTEGER_T, INTEGER_T)
+PREDEFINED_FUNCTION(rand_float, _internal_rand_float, FLOAT_POINT_T, FLOAT_POINT_T, FLOAT_POINT_T)
+PREDEFINED_FUNCTION(rand_normal, _internal_rand_normal, FLOAT_POINT_T, FLOAT_POINT_T, FLOAT_POINT_T)
+PREDEFINED_FUNCTION(rand_floats, _internal_rand_floats, std::vector<FLOAT_POINT_T>, DIAG, INTEGER_T)
+PREDEFINED_FUNCTION(rand_normals, _internal_rand_normals, std::vector<FLOAT_POINT_T>, DIAG, INTEGER_T)
 // draw function
 PREDEFINED_FUNCTION(draw, _internal_draw_xy, VOID_T, DIAG, FLOAT_POINT_T, FLOAT_POINT_T)
 PREDEFINED_FUNCTION(save, _internal_save_img, VOID_T, STRING_T)
+PREDEFINED_FUNCTION(emit_frame, _internal_emit_frame_stdout, VOID_T, DIAG)
+PREDEFINED_FUNCTION(emit_frame, _internal_emit_frame, VOID_T, DIAG, STRING_T)
+PREDEFINED_FUNCTION(clear, _internal_clear, VOID_T)
 // used for overload
 PREDEFINED_CONST_FUNCTION(overload_func, _internal_overload_integer, VOID_T, INTEGER_T, INTEGER_T)
 PREDEFINED_CONST_FUNCTION(overload_func, _internal_overload_float, VOID_T, FLOAT_POINT_T, FLOAT_POINT_T)
@@ -100,7 +111,10 @@ REGISTER_VALUE_FILTER(scale, _scale_value_filter)
 REGISTER_VALUE_FILTER(background_size, _background_size_value_filter)
 REGISTER_VALUE_FILTER(line_width, _line_width_value_filter)
 REGISTER_VALUE_FILTER(background_color, _background_color_value_filter)
+REGISTER_VALUE_FILTER(color_depth, _color_depth_value_filter)
 REGISTER_VALUE_FILTER(line_color, _line_color_value_filter)
+REGISTER_VALUE_FILTER(line_mode, _line_mode_value_filter)
+REGISTER_VALUE_FILTER(seed, _seed_value_filter)
 
 #undef PREDEFINED_VARIABLE
 #undef PREDEFINED_VARIABLE_WITH_FILTER
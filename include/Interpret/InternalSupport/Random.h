@@ -0,0 +1,103 @@
+/**
+ * This file defines the @code{philox_random} class, which generates
+ * the random numbers of the predefined random functions.
+ *
+ * The generator is counter-based (Philox4x32-10): the n-th random
+ * number is computed from the seed and n alone, without a state updated
+ * by the previous numbers. So a program makes the same random numbers
+ * in each run with the same @code{seed}, and any part of the sequence
+ * can be computed directly, e.g. by several threads at the same time.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_RANDOM_H
+#define DRAWING_LANG_INTERPRETER_RANDOM_H
+
+#include <AST/Type.h>
+#include <array>
+#include <cstdint>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+class philox_random {
+public:
+  using block_t = std::array<std::uint32_t, 4>;
+  using key_t = std::array<std::uint32_t, 2>;
+
+  explicit philox_random(std::uint64_t seed = 0) { reseed(seed); }
+
+  /**
+   * Restarts the sequence with @param{seed}.
+   */
+  void reseed(std::uint64_t seed);
+  /**
+   * Returns the index of the next number in the sequence.
+   */
+  [[nodiscard]] std::uint64_t get_position() const { return _position; }
+
+  /**
+   * Applies the Philox4x32-10 bijection to @param{counter}.
+   */
+  [[nodiscard]] static block_t philox(block_t counter, key_t key);
+
+  /**
+   * Returns the @param{index}-th number of the sequence, which is
+   * uniformly distributed in [0, 1).
+   */
+  [[nodiscard]] FLOAT_POINT_T uniform_at(std::uint64_t index) const;
+  /**
+   * Fills @param{out} with @param{count} numbers of the sequence
+   * starting from the @param{index}-th one. The numbers are the same as
+   * the ones returned by @code{uniform_at}, but each block of the
+   * generator is computed only once.
+   */
+  void fill_uniform(std::uint64_t index, FLOAT_POINT_T* out, std::size_t count) const;
+
+  /**
+   * Returns the next number in [0, 1).
+   */
+  FLOAT_POINT_T next_uniform();
+  /**
+   * Returns the next number of the standard normal distribution, which
+   * uses two numbers of the sequence (see @code{fill_normal}).
+   */
+  FLOAT_POINT_T next_normal();
+  /**
+   * Returns the next integer in [@param{low}, @param{high}]. The bounds
+   * can be given in either order.
+   */
+  INTEGER_T next_integer(INTEGER_T low, INTEGER_T high);
+  /**
+   * Fills @param{out} with the next @param{count} numbers in [0, 1).
+   */
+  void next_uniforms(FLOAT_POINT_T* out, std::size_t count);
+  /**
+   * Fills @param{out} with the next @param{count} numbers of the
+   * standard normal distribution. The i-th one is made from the numbers
+   * 2i and 2i + 1 by the Box-Muller transform.
+   */
+  void next_normals(FLOAT_POINT_T* out, std::size_t count);
+private:
+  key_t _key{};
+  std::uint64_t _position = 0;
+  /**
+   * The last block computed by @code{next_uniform}.
+   */
+  std::uint64_t _cached_block = ~std::uint64_t(0);
+  block_t _cache{};
+
+  /**
+   * Each block makes two numbers of 53 bits.
+   */
+  [[nodiscard]] block_t _block(std::uint64_t block) const;
+  /**
+   * Returns the 64 bits of the next number and moves to the one after.
+   */
+  std::uint64_t _next_bits();
+  static FLOAT_POINT_T _to_uniform(std::uint32_t high, std::uint32_t low);
+  static FLOAT_POINT_T _to_normal(FLOAT_POINT_T u1, FLOAT_POINT_T u2);
+};
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_RANDOM_H
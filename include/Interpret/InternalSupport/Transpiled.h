@@ -0,0 +1,266 @@
+/**
+ * This file defines the runtime support of the C++ programs emitted
+ * by @code{cpp_emitter} (see @file{CppEmitter.h}).
+ *
+ * An emitted program calls the predefined functions of
+ * @code{internal_impl} and accesses the predefined variables directly
+ * through @code{transpiled_runtime}. The numbers are computed as the
+ * kernels of @code{sema} do (see @code{sema::infer_type}): each number
+ * carries whether it is an Integer, and @code{std::nullopt} means that
+ * the evaluation has failed and a diagnostic has been made. The
+ * diagnostics are reported with the locations in the original program,
+ * which is embedded in the emitted file.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_TRANSPILED_H
+#define DRAWING_LANG_INTERPRETER_TRANSPILED_H
+
+#include <AST/Expr.h>
+#include <Diagnostic/DiagEngine.h>
+#include <Diagnostic/DiagConsumer.h>
+#include <Sema/IdentifierInfo.h>
+#include <Utils/FileManager.h>
+#include "InternalImpl.h"
+#include <cmath>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+using transpiled_number = std::optional<number_value>;
+
+/**
+ * A tuple of numbers, which is a tuple of Integers if all the elements
+ * are Integers.
+ */
+struct transpiled_tuple {
+  std::vector<FLOAT_POINT_T> values;
+  bool is_integer;
+};
+
+/**
+ * The operands of a binary operator. They are given in a braced list,
+ * so that they are evaluated from left to right as in the interpreter.
+ */
+struct transpiled_operands {
+  transpiled_number lhs;
+  transpiled_number rhs;
+};
+
+class transpiled_runtime {
+public:
+  /**
+   * @param{source} is the program, which has @param{length} characters
+   * and is named @param{file_name} in the diagnostics.
+   */
+  transpiled_runtime(const char* source, std::size_t length, const char* file_name);
+  transpiled_runtime(const transpiled_runtime&) = delete;
+  transpiled_runtime& operator=(const transpiled_runtime&) = delete;
+
+  /**
+   * Reads the parameters in the form of @code{name=value} from the
+   * command line. Returns false if a parameter is not in @param{names},
+   * or @code{--help} is given, in which case the usage is printed.
+   */
+  bool parse_parameters(int argc, char* argv[], std::initializer_list<const char*> names);
+  /**
+   * Replaces @param{value} with the value of the parameter @param{name}
+   * if it is given in the command line.
+   */
+  void apply_parameter(const char* name, INTEGER_T& value);
+  void apply_parameter(const char* name, FLOAT_POINT_T& value);
+  void apply_parameter(const char* name, STRING_T& value);
+  void apply_parameter(const char* name, number_value& value);
+
+  [[nodiscard]] internal_impl& get_internal() { return _internal; }
+
+  static transpiled_number integer(INTEGER_T value) {
+    return number_value{ static_cast<FLOAT_POINT_T>(value), true };
+  }
+  static transpiled_number float_point(FLOAT_POINT_T value) {
+    return number_value{ value, false };
+  }
+  static std::optional<transpiled_tuple> tuple(const std::vector<INTEGER_T>& value) {
+    return transpiled_tuple{ std::vector<FLOAT_POINT_T>(value.begin(), value.end()), true };
+  }
+  static std::optional<transpiled_tuple> tuple(const std::vector<FLOAT_POINT_T>& value) {
+    return transpiled_tuple{ value, false };
+  }
+  static std::optional<transpiled_tuple> make_tuple(std::initializer_list<transpiled_number> elems);
+
+  template<binary_expr::op_kind Kind>
+  transpiled_number binary(transpiled_operands operands, std::size_t op_loc);
+  static transpiled_number negate(transpiled_number operand) {
+    if (!operand)
+      return std::nullopt;
+    return _make_number(-operand->value, operand->is_integer);
+  }
+  static bool less(const transpiled_number& lhs, const transpiled_number& rhs) {
+    return lhs->value < rhs->value;
+  }
+
+  /**
+   * Converts the values to the types of the parameters or variables,
+   * and makes a diagnostic at [@param{start}, @param{end}) if the value
+   * is changed.
+   */
+  static FLOAT_POINT_T to_float(const number_value& value) {
+    return value.is_integer ? static_cast<INTEGER_T>(value.value) : value.value;
+  }
+  INTEGER_T to_integer(const number_value& value, std::size_t start, std::size_t end);
+  static std::vector<FLOAT_POINT_T> to_float_tuple(transpiled_tuple value) {
+    return std::move(value.values);
+  }
+  std::vector<INTEGER_T> to_integer_tuple(const transpiled_tuple& value,
+                                          std::size_t start, std::size_t end);
+
+  /**
+   * The variables whose types are decided by the values defining them
+   * when running the program. The type of @param{var} is fixed when it
+   * is defined, and the values assigned to it later are converted to
+   * that type.
+   */
+  static void define(number_value& var, const number_value& value) {
+    var = number_value{ to_float(value), value.is_integer };
+  }
+  void assign(number_value& var, const number_value& value, std::size_t start, std::size_t end) {
+    var.value = var.is_integer ? to_integer(value, start, end) : to_float(value);
+  }
+
+  /**
+   * Keeps the points drawn during the lifetime of the object in a
+   * connected stroke, as the loops in the interpreter do.
+   */
+  class stroke_scope {
+    internal_impl& _impl;
+  public:
+    explicit stroke_scope(transpiled_runtime& rt) : _impl(rt._internal) { _impl.begin_stroke(); }
+    stroke_scope(const stroke_scope&) = delete;
+    stroke_scope& operator=(const stroke_scope&) = delete;
+    ~stroke_scope() { _impl.end_stroke(); }
+  };
+
+  /**
+   * The predefined symbols. The variables without value filters are
+   * accessed directly, and the others are assigned through the filters.
+   * The functions take the locations of the arguments, which are only
+   * used if the function makes diagnostics, and @code{success} is set
+   * to false if the function fails.
+   */
+#define PREDEFINED_VARIABLE(NAME, TYPE, VALUE)                           \
+  TYPE& var_##NAME() { return _internal._##NAME; }                      \
+  void set_##NAME(TYPE value) { _internal._##NAME = std::move(value); }
+#define PREDEFINED_VARIABLE_WITH_FILTER(NAME, TYPE, VALUE, FILTER)       \
+  const TYPE& var_##NAME() const { return _internal._##NAME; }          \
+  void set_##NAME(std::initializer_list<std::size_t> loc, TYPE value) { \
+    diag_info_pack pack{ _diag, loc, true };                            \
+    if (_internal.FILTER(pack, value))                                  \
+      _internal._##NAME = std::move(value);                             \
+  }
+#define PREDEFINED_CONSTANT(NAME, TYPE, VALUE)                           \
+  const TYPE& var_##NAME() const { return _internal._##NAME; }
+#define PREDEFINED_FUNCTION(SPELLING, FUNC_NAME, RET, ...)               \
+  template<class... Args>                                               \
+  RET FUNC_NAME(bool& success, std::initializer_list<std::size_t> loc,  \
+                Args&&... args) {                                       \
+    return _call(&internal_impl::FUNC_NAME, success, loc,               \
+                 std::forward<Args>(args)...);                          \
+  }
+#define PREDEFINED_CONST_FUNCTION(SPELLING, FUNC_NAME, RET, ...)         \
+  PREDEFINED_FUNCTION(SPELLING, FUNC_NAME, RET, __VA_ARGS__)
+#include "Predefined.h"
+private:
+  file_manager _source;
+  cmd_diag_consumer _consumer;
+  diag_engine _diag;
+  internal_impl _internal;
+  std::unordered_map<std::string, std::string> _parameters;
+
+  static bool _is_integer_value(FLOAT_POINT_T value) {
+    return value <= std::numeric_limits<INTEGER_T>::max() &&
+           value >= std::numeric_limits<INTEGER_T>::min() &&
+           value == static_cast<FLOAT_POINT_T>(static_cast<INTEGER_T>(value));
+  }
+  /**
+   * Returns the result of an operator, which is an Integer if
+   * @param{should_check} and @param{value} can be represented by one.
+   * The Integer is converted as the interpreter does, e.g. -0 is 0.
+   */
+  static number_value _make_number(FLOAT_POINT_T value, bool should_check) {
+    if (should_check && _is_integer_value(value))
+      return number_value{ static_cast<FLOAT_POINT_T>(static_cast<INTEGER_T>(value)), true };
+    return number_value{ value, false };
+  }
+
+  template<class Func, class... Args>
+  decltype(auto) _call(Func func, bool& success, std::initializer_list<std::size_t> loc,
+                       Args&&... args) {
+    if constexpr (std::is_invocable_v<Func, internal_impl&, diag_info_pack&, Args...>) {
+      diag_info_pack pack{ _diag, loc, true };
+      struct _set_success {
+        bool& success;
+        const diag_info_pack& pack;
+        ~_set_success() { success = pack.success; }
+      } _setter{ success, pack };
+      return std::invoke(func, _internal, pack, std::forward<Args>(args)...);
+    } else {
+      (void)loc;
+      return std::invoke(func, _internal, std::forward<Args>(args)...);
+    }
+  }
+
+  /**
+   * Returns the value of the parameter @param{name}, or nullptr if it
+   * is not given.
+   */
+  const std::string* _find_parameter(const char* name) const;
+  void _report_invalid_result(const char* op_name, FLOAT_POINT_T lhs, FLOAT_POINT_T rhs,
+                              std::size_t op_loc);
+};
+
+template<binary_expr::op_kind Kind>
+transpiled_number transpiled_runtime::binary(transpiled_operands operands, std::size_t op_loc) {
+  if (!operands.lhs || !operands.rhs)
+    return std::nullopt;
+  const number_value& lhs = *operands.lhs;
+  const number_value& rhs = *operands.rhs;
+  FLOAT_POINT_T value;
+  const char* op_name;
+  if constexpr (Kind == binary_expr::bo_add) {
+    value = lhs.value + rhs.value;
+    op_name = "adding";
+  } else if constexpr (Kind == binary_expr::bo_sub) {
+    value = lhs.value - rhs.value;
+    op_name = "subtracting";
+  } else if constexpr (Kind == binary_expr::bo_mul) {
+    value = lhs.value * rhs.value;
+    op_name = "multiplying";
+  } else if constexpr (Kind == binary_expr::bo_div) {
+    if (rhs.value == 0)
+      _diag.create_diag(warn_div_zero, op_loc) << diag_build_finish;
+    value = lhs.value / rhs.value;
+    op_name = "dividing";
+  } else {
+    static_assert(Kind == binary_expr::bo_pow, "unknown binary operator");
+    value = std::pow(lhs.value, rhs.value);
+    op_name = "powering";
+  }
+  if (std::isinf(value) || std::isnan(value)) {
+    _report_invalid_result(op_name, lhs.value, rhs.value, op_loc);
+    return std::nullopt;
+  }
+  // The n-th power of an Integer is an Integer if it can be represented.
+  bool should_check = Kind == binary_expr::bo_pow ? lhs.is_integer
+                                                  : lhs.is_integer && rhs.is_integer;
+  return _make_number(value, should_check);
+}
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_TRANSPILED_H
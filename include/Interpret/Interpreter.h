@@ -11,6 +11,12 @@
 #include <AST/StmtVisitor.h>
 #include <Sema/Sema.h>
 #include "InternalSupport/InternalImpl.h"
+#include "Jit.h"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
 
 INTERPRETER_NAMESPACE_BEGIN
 
@@ -24,6 +30,62 @@ public:
    * if we meet an error.
    */
   void run_stmts(const std::vector<stmt_result_t>& stmts);
+  /**
+   * Runs the statements from the @param{first}-th one, assuming the
+   * ones in front of it have run, and calls @param{after_stmt} with
+   * the index of each statement after it runs (even if it is broken).
+   * The watch mode takes the checkpoints there (see @file{Watch.h}).
+   */
+  void run_stmts(const std::vector<stmt_result_t>& stmts, std::size_t first,
+                 const std::function<void(std::size_t)>& after_stmt);
+
+  /**
+   * Runs the bodies of the loops with the native code compiled by the
+   * JIT (see @file{Jit.h}) if it is supported on this platform. The
+   * statements which cannot be compiled still run in the interpreter.
+   */
+  void enable_jit() { _jit_enabled = jit_compiler::is_supported(); }
+  /**
+   * Runs the iterations of the loops whose bodies only draw points on
+   * @param{threads} threads. The points are drawn in the order of the
+   * iterations, so the picture is the same as running serially.
+   *
+   * @code{run_stmts} also evaluates such a loop ahead on another thread
+   * when the statements in front of it cannot change the points it
+   * computes (see @file{Effects.h}), while the points are still drawn
+   * in the order of the statements.
+   */
+  void enable_parallel(std::size_t threads) { _threads = threads; }
+  /**
+   * Stops the program when it is still running at @param{deadline}.
+   * The deadline is checked between the statements and between the
+   * iterations of the loops, and the rest of the program is skipped,
+   * e.g. in the server mode (see @file{Serve.h}).
+   */
+  void set_deadline(std::chrono::steady_clock::time_point deadline) { _deadline = deadline; }
+  /**
+   * Returns true if the program is stopped at the deadline.
+   */
+  [[nodiscard]] bool is_timed_out() const { return _timed_out; }
+
+  /**
+   * The statistics of the statements run by @code{run_stmts}. A
+   * statement is overlapped if it has been evaluated ahead while the
+   * statements in front of it run. The parallelism is the time spent
+   * running the statements in order and evaluating the loops ahead,
+   * divided by the elapsed time.
+   */
+  struct schedule_stats {
+    std::size_t statements = 0;
+    std::size_t overlapped = 0;
+    double busy_seconds = 0;
+    double elapsed_seconds = 0;
+
+    [[nodiscard]] double parallelism() const {
+      return elapsed_seconds > 0 ? busy_seconds / elapsed_seconds : 1;
+    }
+  };
+  [[nodiscard]] const schedule_stats& get_schedule_stats() const { return _schedule_stats; }
 
   void visit_empty_stmt(empty_stmt*) { }
   void visit_assignment_stmt(assignment_stmt* s);
@@ -32,6 +94,27 @@ public:
 private:
   sema& action;
   internal_impl& symbol;
+  bool _jit_enabled = false;
+  std::size_t _threads = 1;
+  schedule_stats _schedule_stats;
+  std::optional<std::chrono::steady_clock::time_point> _deadline;
+  bool _timed_out = false;
+  /**
+   * The number of the checks left before the clock is read again.
+   */
+  unsigned _deadline_countdown = 0;
+  /**
+   * Returns true if the program has run past the deadline. Reading the
+   * clock costs more than a simple iteration, so it is only read once
+   * in @code{_deadline_interval} calls.
+   */
+  static constexpr unsigned _deadline_interval = 1024;
+  bool _past_deadline();
+  /**
+   * The loops being evaluated ahead by @code{run_stmts}.
+   */
+  struct _precomputed_loop;
+  std::unordered_map<const for_stmt*, std::shared_ptr<_precomputed_loop>> _precomputed;
   /**
    * Helper function used to make a diagnostic message
    */
@@ -40,6 +123,15 @@ private:
     return action.diag(message, locs...);
   }
 
+  /**
+   * Starts the evaluation of the loop @param{s} on another thread.
+   */
+  void _start_precompute(const for_stmt* s);
+  /**
+   * Waits for the evaluation started by @code{_start_precompute}.
+   */
+  void _finish_precompute(_precomputed_loop& loop);
+
   bool _assign_to_value(variable_expr* lhs, typed_value& rhs,
                         std::size_t lhs_loc,
                         std::size_t rhs_start_loc, std::size_t rhs_end_loc);
@@ -0,0 +1,90 @@
+/**
+ * This file defines a small JIT compiler, which translates numeric
+ * expressions into native x86-64 code.
+ *
+ * The compiler accepts the expression trees inferred by
+ * @code{sema::infer_type} which only consist of Integer and Double
+ * numbers and variables, the arithmetic operators and the calls to the
+ * predefined math functions. The values are computed in the SSE2
+ * registers in the same order and with the same operations as the
+ * interpreter, and whether an intermediate result is an Integer is
+ * tracked as well, so the results are exactly the same.
+ *
+ * If an operation would make a diagnostic (a division by zero, or a
+ * result which is not finite), the compiled code stops and reports a
+ * failure without storing anything, so that the caller can evaluate
+ * the expressions by the interpreter, which makes the diagnostic.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_JIT_H
+#define DRAWING_LANG_INTERPRETER_JIT_H
+
+#include <AST/Expr.h>
+#include <optional>
+#include <vector>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+/**
+ * Owns the executable memory of a compiled function.
+ */
+class jit_function {
+public:
+  jit_function() = default;
+  jit_function(const jit_function&) = delete;
+  jit_function& operator=(const jit_function&) = delete;
+  jit_function(jit_function&& other) noexcept;
+  jit_function& operator=(jit_function&& other) noexcept;
+  ~jit_function();
+
+  /**
+   * Runs the compiled code, which stores the results to @param{out}.
+   * Returns false if the values cannot be computed without a
+   * diagnostic, and nothing is stored in this case.
+   */
+  bool operator()(FLOAT_POINT_T* out) const { return _entry(out) != 0; }
+private:
+  using entry_t = int (*)(FLOAT_POINT_T*);
+
+  void* _memory = nullptr;
+  std::size_t _size = 0;
+  entry_t _entry = nullptr;
+
+  friend class jit_compiler;
+};
+
+class jit_compiler {
+public:
+  /**
+   * Returns true if the JIT can run on this platform.
+   */
+  static bool is_supported();
+
+  /**
+   * Returns true if @param{e} can be compiled, which requires @param{e}
+   * to be inferred, and all the calls in it to be bound.
+   */
+  [[nodiscard]] static bool can_compile(const expr* e);
+
+  /**
+   * Compiles a function which stores the values of @param{exprs}
+   * (converted to Double) to @code{out[0]}, @code{out[1]}, ... in order.
+   */
+  static std::optional<jit_function> compile_values(const std::vector<expr*>& exprs);
+  /**
+   * Compiles a function which assigns the value of @param{value}
+   * (converted to Double) to @param{target} directly. The argument
+   * of the function is not used.
+   */
+  static std::optional<jit_function> compile_assignment(expr* value, FLOAT_POINT_T* target);
+private:
+  /**
+   * Copies @param{code} to the executable memory.
+   */
+  static std::optional<jit_function> _load(const std::vector<unsigned char>& code);
+};
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_JIT_H
@@ -0,0 +1,144 @@
+/**
+ * This file defines the @code{render_server} class, which runs the
+ * programs sent to a Unix-domain socket (`drawing --serve <socket>`).
+ *
+ * Starting the interpreter for every small program costs more than
+ * running it, so the server keeps running, and each of its workers
+ * prepares a @code{render_context} for the next request while it waits:
+ * a symbol table with the predefined symbols exported from a new
+ * @code{internal_impl}. A request only lexes, parses and runs the
+ * program, and the context is dropped after it, so the requests never
+ * see the variables or the pictures of each other. The workers serve
+ * the requests at the same time.
+ *
+ * A client connects to the socket, writes the program, and shuts down
+ * the writing side of the connection. The server replies with a line
+ *
+ *   <status> <output size> <diagnostics size> <image size>
+ *
+ * followed by the three parts. The status is `ok`, `timeout` if the
+ * program is stopped after running for the time limit, or `error` if
+ * the program reports an error, is too large to run, or fails inside
+ * the interpreter. The output is what @code{print} and
+ * @code{emit_frame} write, the diagnostics are formatted as in the
+ * command line, and the image is the picture of the last @code{save},
+ * encoded in the format of its path (no file is written), or the final
+ * picture as a binary PPM image if the program never saves it.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_SERVE_H
+#define DRAWING_LANG_INTERPRETER_SERVE_H
+
+#include "Interpreter.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+struct render_result {
+  /**
+   * The status in the reply, which is one of `ok`, `timeout` and `error`.
+   */
+  std::string status = "ok";
+  std::string output;
+  std::string diagnostics;
+  std::string image;
+};
+
+/**
+ * The fresh interpreter state of one request, which is prepared before
+ * the program arrives.
+ */
+class render_context {
+public:
+  render_context();
+
+  /**
+   * Runs @param{program}, and stops it after @param{timeout}. The status
+   * is `error` if an error is reported and the program is not stopped.
+   * A context only runs one program.
+   */
+  render_result run(std::string_view program, std::chrono::milliseconds timeout);
+private:
+  symbol_table _table;
+  internal_impl _internal;
+};
+
+class render_server {
+public:
+  /**
+   * The programs larger than this are not run.
+   */
+  static constexpr std::size_t max_program_size = 16 << 20;
+  /**
+   * The output and the diagnostics of a program are cut at this size,
+   * e.g. when a loop reports a warning in every iteration.
+   */
+  static constexpr std::size_t max_output_size = 256 << 20;
+  /**
+   * The most pixels of the canvas of a program, since the picture is
+   * encoded in memory (and each frame of @code{emit_frame} is kept in
+   * full by the encoder) before it is cut as the output is.
+   */
+  static constexpr std::uint64_t max_canvas_area = 16 << 20;
+
+  /**
+   * Creates a server listening on @param{socket_path} with
+   * @param{workers} workers. Each program is stopped after
+   * @param{timeout}, which also limits the total time spent reading the
+   * program and writing the reply.
+   */
+  render_server(std::string socket_path, std::size_t workers, std::chrono::milliseconds timeout);
+  ~render_server();
+
+  /**
+   * Listens on the socket, replacing a stale socket file, and starts the
+   * workers. Returns false if the socket cannot be listened on, e.g.
+   * where Unix-domain sockets are not supported.
+   */
+  bool start();
+  /**
+   * Blocks until the server is stopped by another thread.
+   */
+  void wait();
+  /**
+   * Stops accepting the requests, waits for the ones being served, and
+   * removes the socket file.
+   */
+  void stop();
+private:
+  std::string _path;
+  std::size_t _workers;
+  std::chrono::milliseconds _timeout;
+  int _socket = -1;
+  std::atomic<bool> _stopping = false;
+  std::vector<std::thread> _threads;
+  /**
+   * Held while the workers are joined, since @code{stop} may be called
+   * while another thread waits for the server.
+   */
+  std::mutex _join_mutex;
+
+  void _work();
+};
+
+/**
+ * Reads a program from the connection @param{fd}, runs it in
+ * @param{context}, and writes the reply (see @file{Serve.h}). The
+ * connection is not closed. Reading the program and writing the reply
+ * must finish within @param{timeout} in total, counted from the call,
+ * besides the time the program runs. Returns false if the connection
+ * is broken or too slow, in which case nothing is replied.
+ */
+bool serve_connection(int fd, render_context& context, std::chrono::milliseconds timeout);
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_SERVE_H
@@ -0,0 +1,119 @@
+/**
+ * This file defines the @code{parameter_sweep} class, which renders a
+ * program with many sets of parameters (`drawing --sweep <file>`).
+ *
+ * Each non-empty line of the sweep file is a variant: the path of its
+ * image, followed by the assignments to the parameters, e.g.
+ *
+ *   red.png  line_color is (255, 0, 0); scale is (2, 2);
+ *   blue.png line_color is (0, 0, 255);
+ *
+ * The lines starting with a comment are skipped. As the parameters of
+ * the emitted C++ programs (see @file{CppEmitter.h}), the assignments of
+ * a variant replace the first assignment to the same variable at the
+ * top level of the program, or run in front of the program if there
+ * is no such assignment. Any variable, including the predefined ones,
+ * can be a parameter.
+ *
+ * The statements in front of the first replaced one are the same for
+ * all the variants, so they only run once. The state after them is then
+ * forked for each variant as the watch mode restores a checkpoint (see
+ * @file{Watch.h}): the runtime variables are copied, and the canvas
+ * shares its tiles until they are drawn on again. The rest of the
+ * program runs for the variants on several threads, and the picture at
+ * the end of each variant is written to its path. The pictures saved by
+ * the program itself are not written, since all the variants would
+ * write them to the same file.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_SWEEP_H
+#define DRAWING_LANG_INTERPRETER_SWEEP_H
+
+#include <Diagnostic/DiagEngine.h>
+#include <Utils/FileManager.h>
+#include "Interpreter.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+class parameter_sweep {
+public:
+  struct variant {
+    std::string image_path;
+    /**
+     * The assignments of the variant, which are parsed from the sweep
+     * file.
+     */
+    std::vector<stmt_result_t> assignments;
+  };
+
+  /**
+   * The output of @code{print} and the diagnostics of a variant, which
+   * are kept until all the variants finish so they are shown in order.
+   */
+  struct result {
+    std::string output;
+    std::string diagnostics;
+    bool written = false;
+  };
+
+  /**
+   * Parses the program in @param{program} and the variants in
+   * @param{sweep}, and reports their errors to @param{diag}. The
+   * statements of the variants which are not assignments are reported
+   * and dropped.
+   */
+  parameter_sweep(diag_engine& diag, const file_manager& program, const file_manager& sweep);
+  ~parameter_sweep();
+
+  void enable_jit() { _jit = true; }
+
+  [[nodiscard]] const std::vector<variant>& get_variants() const { return _variants; }
+  /**
+   * Returns the number of the statements which run once for all the
+   * variants.
+   */
+  [[nodiscard]] std::size_t prefix_length() const { return _prefix_length; }
+
+  /**
+   * Runs the common statements, and then the variants on
+   * @param{threads} threads. The diagnostics of the common statements
+   * are reported to the engine given to the constructor. Returns the
+   * results in the order of the variants.
+   */
+  std::vector<result> run(std::size_t threads);
+private:
+  diag_engine& _diag;
+  const file_manager& _program;
+  const file_manager& _sweep;
+  bool _jit = false;
+  /**
+   * The sweep file without the paths of the variants, which the names
+   * in the assignments of the variants refer to.
+   */
+  std::string _sweep_text;
+  std::vector<variant> _variants;
+  /**
+   * The parameters by the index of the top-level statement they
+   * replace. The ones which are not assigned at the top level are not
+   * in it, and they make the prefix empty.
+   */
+  std::map<std::size_t, std::string> _definitions;
+  std::size_t _prefix_length = 0;
+  /**
+   * The statements of the program parsed by the constructor, which run
+   * as the common prefix.
+   */
+  std::vector<stmt_result_t> _ast;
+
+  struct _fork_state;
+  result _run_variant(variant& v, const _fork_state& state) const;
+};
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_SWEEP_H
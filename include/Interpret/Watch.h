@@ -0,0 +1,146 @@
+/**
+ * This file defines the @code{watch_session} class, which runs a
+ * program again whenever its source file changes (`drawing --watch`).
+ *
+ * Rerunning the whole program after every edit wastes the time spent
+ * on the statements in front of the edited one, whose results cannot
+ * change. So the session saves checkpoints of the interpreter state at
+ * the boundaries of the top-level statements: the runtime variables in
+ * the symbol table, and the predefined variables and the canvas in
+ * @code{internal_impl} (see @code{internal_impl::snapshot}). When the
+ * file changes, the new statements are compared with the old ones by
+ * their source text, and the program restarts from the last checkpoint
+ * in front of the first changed statement.
+ *
+ * The checkpoints are copy-on-write: a checkpoint shares the values of
+ * the variables which are not assigned since the previous one, and the
+ * tiles of the canvas which are not drawn on again. At most
+ * @code{watch_session::max_checkpoints} checkpoints are kept. When there
+ * are more, every other one is dropped and the checkpoints are taken
+ * half as often, so a long program restarts a bit earlier than the
+ * changed statement instead of using more memory.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_WATCH_H
+#define DRAWING_LANG_INTERPRETER_WATCH_H
+
+#include <Diagnostic/DiagEngine.h>
+#include <Utils/FileManager.h>
+#include "Interpreter.h"
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <vector>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+class watch_session {
+public:
+  static constexpr std::size_t max_checkpoints = 64;
+
+  explicit watch_session(diag_engine& diag);
+  ~watch_session();
+
+  void enable_jit() { _jit = true; }
+  void enable_parallel(std::size_t threads) { _threads = threads; }
+
+  /**
+   * Runs the program in @param{source}, which replaces the program of
+   * the previous call. The statements in front of the first changed one
+   * are not run again if a checkpoint allows so. Returns the index of
+   * the first statement which runs.
+   */
+  std::size_t run(std::unique_ptr<file_manager> source);
+
+  [[nodiscard]] const internal_impl& get_internal() const { return _internal; }
+  [[nodiscard]] const symbol_table* get_symbol_table() const { return _table.get(); }
+  /**
+   * Returns the interpreter of the last run, or nullptr before the
+   * first run.
+   */
+  [[nodiscard]] const interpreter* get_interpreter() const { return _runner.get(); }
+  [[nodiscard]] std::size_t checkpoint_count() const { return _checkpoints.size(); }
+private:
+  diag_engine& _diag;
+  internal_impl _internal;
+  bool _jit = false;
+  std::size_t _threads = 1;
+
+  // The program of the last run. The AST and the symbol table refer to
+  // the source, so they are destroyed before it.
+  std::unique_ptr<file_manager> _source;
+  std::vector<stmt_result_t> _program;
+  std::unique_ptr<symbol_table> _table;
+  std::unique_ptr<sema> _action;
+  std::unique_ptr<interpreter> _runner;
+
+  struct _checkpoint;
+  /**
+   * The checkpoints by the index of the statement which runs after
+   * them. The first one is the state before the program runs.
+   */
+  std::map<std::size_t, std::shared_ptr<const _checkpoint>> _checkpoints;
+  /**
+   * The checkpoint restored by the last run. The names of the variables
+   * restored from it are used by the symbol table.
+   */
+  std::shared_ptr<const _checkpoint> _restored;
+  /**
+   * Takes a checkpoint after every @code{_stride} statements.
+   */
+  std::size_t _stride = 1;
+  /**
+   * The variables which may be assigned since the last checkpoint.
+   */
+  std::vector<string_ref> _dirty;
+
+  void _after_stmt(std::size_t index);
+  void _take_checkpoint(std::size_t index);
+};
+
+/**
+ * Watches a file for writes from the time the watcher is created, so
+ * the saves made while the program runs are not missed.
+ */
+class file_watcher {
+public:
+  explicit file_watcher(std::filesystem::path path);
+  file_watcher(const file_watcher&) = delete;
+  file_watcher& operator=(const file_watcher&) = delete;
+  ~file_watcher();
+
+  /**
+   * Returns false if the file cannot be watched.
+   */
+  [[nodiscard]] bool is_valid() const;
+  /**
+   * Forgets the changes seen so far. It is called before the file is
+   * read, since the content read is the latest one.
+   */
+  void drain();
+  /**
+   * Blocks until the file is written or replaced after the last call of
+   * @code{drain} or @code{wait}. Returns false if the file cannot be
+   * watched.
+   */
+  bool wait();
+private:
+  std::filesystem::path _path;
+#ifdef __linux__
+  int _fd = -1;
+
+  /**
+   * Reads the pending events without blocking, and sets @param{changed}
+   * if any of them is about the file. Returns false on errors.
+   */
+  bool _read_events(bool& changed);
+#else
+  std::filesystem::file_time_type _last;
+  bool _valid = false;
+#endif
+};
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_WATCH_H
@@ -199,10 +199,10 @@ private:
    */
   static std::pair<int, bool> get_op_prec(token_kind op, bool is_binary);
   /**
-   * Extracts the actual string in the string token,
-   * and processes the escape character.
+   * Extracts the actual string in the string token, processes the
+   * escape character and appends it to @param{result}.
    */
-  std::string extract_string_token_value(token& t);
+  void extract_string_token_value(token& t, std::string& result);
 };
 
 INTERPRETER_NAMESPACE_END
@@ -11,17 +11,70 @@
 #include <AST/Type.h>
 #include <Lex/TokenKinds.h>
 #include <Diagnostic/DiagEngine.h>
+#include <Utils/Counters.h>
+#include <Utils/BKTree.h>
 #include <functional>
+#include <initializer_list>
 #include <memory>
 #include <cassert>
 #include <utility>
 #include <unordered_map>
 #include <optional>
+#include <vector>
 
 INTERPRETER_NAMESPACE_BEGIN
 
 class expr;
 
+/**
+ * A list of source locations, which stores up to @code{inline_size}
+ * locations in itself. A @code{diag_info_pack} is made for each
+ * assignment and call, so making and copying the locations of an
+ * assignment or a call with a few arguments allocates no memory.
+ */
+class location_list {
+public:
+  static constexpr std::size_t inline_size = 8;
+
+  location_list() = default;
+  location_list(std::initializer_list<std::size_t> locs) {
+    reserve(locs.size());
+    for (std::size_t loc : locs)
+      push_back(loc);
+  }
+
+  void reserve(std::size_t size) {
+    if (size > inline_size && _heap.empty())
+      _heap.reserve(size);
+  }
+  void push_back(std::size_t loc) {
+    if (_size < inline_size && _heap.empty()) {
+      _inline[_size++] = loc;
+      return;
+    }
+    if (_heap.empty())
+      _heap.assign(_inline, _inline + _size);
+    _heap.push_back(loc);
+    ++_size;
+  }
+
+  [[nodiscard]] std::size_t size() const { return _size; }
+  [[nodiscard]] bool empty() const { return _size == 0; }
+  [[nodiscard]] const std::size_t* begin() const { return _heap.empty() ? _inline : _heap.data(); }
+  [[nodiscard]] const std::size_t* end() const { return begin() + _size; }
+  std::size_t operator[](std::size_t idx) const {
+    assert(idx < _size);
+    return begin()[idx];
+  }
+private:
+  std::size_t _inline[inline_size] = {};
+  /**
+   * Stores all the locations when there are more than @code{inline_size}.
+   */
+  std::vector<std::size_t> _heap;
+  std::size_t _size = 0;
+};
+
 /**
  * This structure used to pass the information needed
  * when making diagnostic information.
@@ -35,7 +88,7 @@ struct diag_info_pack {
    * For an assignment statement, it will contains 2 elements representing the
    * expression used to assign.
    */
-  std::vector<std::size_t> param_loc;
+  location_list param_loc;
   /**
    * Represents the result of the assignment. If the member is @code{false}, the
    * interpreter will not assign the value to the variable.
@@ -72,7 +125,21 @@ public:
   [[nodiscard]] const type& get_param_type(std::size_t idx) const
     { return _param_types[idx]; }
 
-  [[nodiscard]] virtual std::any call(diag_info_pack& pack, std::vector<std::any> args) const = 0;
+  /**
+   * Sets the counter of the calls, which is shared by all the overloads
+   * of the function.
+   */
+  void set_call_counter(counter* calls) { _calls = calls; }
+
+  [[nodiscard]] std::any call(diag_info_pack& pack, std::vector<std::any> args) const {
+    if (_calls)
+      _calls->add();
+    return _call(pack, std::move(args));
+  }
+protected:
+  [[nodiscard]] virtual std::any _call(diag_info_pack& pack, std::vector<std::any> args) const = 0;
+private:
+  counter* _calls = nullptr;
 };
 
 class variable_info {
@@ -93,6 +160,17 @@ public:
   [[nodiscard]] virtual std::any take_value() = 0;
   [[nodiscard]] virtual bool is_constant() const = 0;
   virtual void set_value(diag_info_pack& pack, std::any value) = 0;
+  /**
+   * Returns the address of the value if it can be read directly (e.g.
+   * by the code compiled by the JIT), otherwise returns nullptr.
+   */
+  [[nodiscard]] virtual const void* get_value_address() const { return nullptr; }
+  /**
+   * Returns the address of the value if a new value can be written to
+   * it directly, which means no value filter needs to check the value,
+   * otherwise returns nullptr.
+   */
+  [[nodiscard]] virtual void* get_assignable_address() { return nullptr; }
 };
 
 template<class Ret, class... Args>
@@ -116,7 +194,7 @@ private:
     } else
       return pack_value(_callee(unpack_value<Args>(args[Idx])...));
   }
-  [[nodiscard]] std::any call(diag_info_pack&, std::vector<std::any> args) const override {
+  [[nodiscard]] std::any _call(diag_info_pack&, std::vector<std::any> args) const override {
     assert(args.size() == sizeof...(Args));
     return _call_impl(std::move(args), std::make_index_sequence<sizeof...(Args)>());
   }
@@ -144,7 +222,7 @@ private:
     } else
       return pack_value(_callee(pack, unpack_value<Args>(args[Idx])...));
   }
-  [[nodiscard]] std::any call(diag_info_pack& pack, std::vector<std::any> args) const override {
+  [[nodiscard]] std::any _call(diag_info_pack& pack, std::vector<std::any> args) const override {
     assert(args.size() == sizeof...(Args));
     return _call_impl(pack, std::move(args), std::make_index_sequence<sizeof...(Args)>());
   }
@@ -187,6 +265,7 @@ public:
   }
 
   [[nodiscard]] bool is_constant() const override { return true; }
+  [[nodiscard]] const void* get_value_address() const override { return &this->_value; }
   void set_value(diag_info_pack& pack, std::any) override {
     // cannot set value to constant
     assert(pack.param_loc.size() == 2);
@@ -199,6 +278,7 @@ template<class VarTy>
 class variable_info_impl : public variable_storage<VarTy*> {
   using base_t = variable_storage<VarTy*>;
   std::function<bool(diag_info_pack&, const VarTy&)> _value_filter;
+  VarTy _scratch{};
 public:
   template<class Callable,
       std::enable_if_t<std::is_constructible_v<decltype(_value_filter), Callable&&>, int> = 0>
@@ -213,10 +293,21 @@ public:
     return get_value();
   }
   [[nodiscard]] bool is_constant() const override { return false; }
+  [[nodiscard]] const void* get_value_address() const override { return this->_value; }
+  [[nodiscard]] void* get_assignable_address() override {
+    return _value_filter ? nullptr : this->_value;
+  }
   void set_value(diag_info_pack& pack, std::any value) override {
-    auto v = unpack_value<VarTy>(std::move(value));
-    if (!_value_filter || _value_filter(pack, v))
-      *this->_value = std::move(v);
+    if (!_value_filter) {
+      unpack_value_to(value, *this->_value);
+      return;
+    }
+    // The value is checked before it is assigned. The scratch value
+    // keeps the memory of the old value after the swap, so a tuple is
+    // assigned without allocating again.
+    unpack_value_to(value, _scratch);
+    if (_value_filter(pack, _scratch))
+      std::swap(*this->_value, _scratch);
     else
       pack.success = false;
   }
@@ -243,6 +334,8 @@ public:
     return get_value();
   }
   [[nodiscard]] bool is_constant() const override { return false; }
+  [[nodiscard]] const void* get_value_address() const override { return _value.get(); }
+  [[nodiscard]] void* get_assignable_address() override { return _value.get(); }
   void set_value(diag_info_pack& pack, std::any value) override {
     //auto v = unpack_value<VarTy>(std::move(value));
     //*this->_value = std::move(v);
@@ -270,6 +363,16 @@ public:
   [[nodiscard]] bool has_function(token_kind kind, string_ref spelling) const;
   [[nodiscard]] bool has_variable(string_ref spelling) const;
   [[nodiscard]] bool has_function(string_ref spelling) const;
+  /**
+   * Returns the name of the variable which is most similar to
+   * @param{spelling}, or std::nullopt if there is no similar variable or
+   * several ones are equally similar. It is used to find the typos.
+   */
+  [[nodiscard]] std::optional<string_ref> find_similar_variable(string_ref spelling) const;
+  /**
+   * The same as @code{find_similar_variable}, but for the functions.
+   */
+  [[nodiscard]] std::optional<string_ref> find_similar_function(string_ref spelling) const;
   template<class OutIter, class Fn>
   OutIter get_var_if(OutIter out_beg, Fn f) const {
     for (const auto& [name, info] : _var_symbols) {
@@ -293,6 +396,11 @@ private:
       decltype(hash_value)*> _var_symbols;
   std::unordered_map<string_ref, std::vector<std::unique_ptr<function_info>>,
       decltype(hash_value)*> _func_symbols;
+  /**
+   * The names of the symbols, which are used to find the similar names.
+   */
+  bk_tree _var_names;
+  bk_tree _func_names;
 };
 
 template<class Ret, class... Args>
@@ -0,0 +1,163 @@
+/**
+ * This file defines the @code{interval} class and the interval
+ * version of the arithmetic operators and math functions.
+ *
+ * An interval @code{[lo, hi]} contains all the values an expression
+ * may take. All the operations round outwards, so the result always
+ * contains the exact result. If the result cannot be bounded (e.g.
+ * the function is not defined on some values of the interval), the
+ * operations return @code{std::nullopt}, which means that the value
+ * of the expression is unknown.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_INTERVAL_H
+#define DRAWING_LANG_INTERPRETER_INTERVAL_H
+
+#include <AST/Type.h>
+#include <optional>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+struct interval {
+  FLOAT_POINT_T lo, hi;
+
+  interval(FLOAT_POINT_T lo, FLOAT_POINT_T hi) : lo(lo), hi(hi) { assert(lo <= hi); }
+  explicit interval(FLOAT_POINT_T value) : lo(value), hi(value) { }
+
+  [[nodiscard]] bool contains(FLOAT_POINT_T value) const { return lo <= value && value <= hi; }
+  [[nodiscard]] bool is_finite() const { return std::isfinite(lo) && std::isfinite(hi); }
+  [[nodiscard]] FLOAT_POINT_T width() const { return hi - lo; }
+};
+
+using interval_result_t = std::optional<interval>;
+
+namespace {
+/**
+ * Moves the bounds outwards by one ulp to cover the rounding error
+ * of the operation. If the interval is not finite, it means the
+ * operation overflows and the real evaluation will fail, so we
+ * cannot bound the result.
+ */
+inline interval_result_t _widen(FLOAT_POINT_T lo, FLOAT_POINT_T hi) {
+  constexpr FLOAT_POINT_T inf = std::numeric_limits<FLOAT_POINT_T>::infinity();
+  if (!std::isfinite(lo) || !std::isfinite(hi))
+    return std::nullopt;
+  return interval(std::nextafter(lo, -inf), std::nextafter(hi, inf));
+}
+
+inline interval_result_t _hull(std::initializer_list<FLOAT_POINT_T> values) {
+  if (std::any_of(values.begin(), values.end(), [](FLOAT_POINT_T v) { return std::isnan(v); }))
+    return std::nullopt;
+  auto [min, max] = std::minmax_element(values.begin(), values.end());
+  return _widen(*min, *max);
+}
+} // namespace
+
+inline interval_result_t operator+(interval lhs, interval rhs) {
+  return _widen(lhs.lo + rhs.lo, lhs.hi + rhs.hi);
+}
+
+inline interval_result_t operator-(interval lhs, interval rhs) {
+  return _widen(lhs.lo - rhs.hi, lhs.hi - rhs.lo);
+}
+
+inline interval_result_t operator-(interval operand) {
+  return interval(-operand.hi, -operand.lo);
+}
+
+inline interval_result_t operator*(interval lhs, interval rhs) {
+  return _hull({ lhs.lo * rhs.lo, lhs.lo * rhs.hi, lhs.hi * rhs.lo, lhs.hi * rhs.hi });
+}
+
+inline interval_result_t operator/(interval lhs, interval rhs) {
+  // division by zero
+  if (rhs.contains(0))
+    return std::nullopt;
+  return _hull({ lhs.lo / rhs.lo, lhs.lo / rhs.hi, lhs.hi / rhs.lo, lhs.hi / rhs.hi });
+}
+
+inline interval_result_t interval_pow(interval base, interval exp) {
+  // integer exponent: the function is monotonic on each side of 0
+  if (exp.lo == exp.hi && std::trunc(exp.lo) == exp.lo) {
+    FLOAT_POINT_T n = exp.lo;
+    if (n < 0 && base.contains(0))
+      return std::nullopt;
+    FLOAT_POINT_T l = std::pow(base.lo, n), h = std::pow(base.hi, n);
+    bool even = std::fmod(n, 2) == 0;
+    if (even && n > 0 && base.contains(0))
+      return _hull({ 0, l, h });
+    return _hull({ l, h });
+  }
+  // For a positive base, pow(x, y) = exp(y * ln(x)) and y * ln(x) is
+  // bilinear, so the extreme values are reached on the corners.
+  // A negative base with a fraction exponent makes a NaN.
+  if (base.lo <= 0)
+    return std::nullopt;
+  return _hull({ std::pow(base.lo, exp.lo), std::pow(base.lo, exp.hi),
+                 std::pow(base.hi, exp.lo), std::pow(base.hi, exp.hi) });
+}
+
+inline interval_result_t interval_abs(interval operand) {
+  if (operand.lo >= 0)
+    return operand;
+  if (operand.hi <= 0)
+    return -operand;
+  return interval(0, std::max(-operand.lo, operand.hi));
+}
+
+/**
+ * Returns the range of sin(x) on the interval. @param{phase} is added
+ * to the operand, which is used to implement cos(x) = sin(x + PI / 2).
+ */
+inline interval_result_t interval_sin(interval operand, FLOAT_POINT_T phase = 0) {
+  constexpr FLOAT_POINT_T pi = 3.14159265358979323846;
+  if (!operand.is_finite())
+    return std::nullopt;
+  if (operand.width() >= 2 * pi)
+    return interval(-1, 1);
+  FLOAT_POINT_T lo = operand.lo + phase, hi = operand.hi + phase;
+  // Checks whether the interval contains a point x = offset + 2k * PI.
+  // The test is slightly looser than needed to cover the rounding error.
+  auto _contains_peak = [lo, hi](FLOAT_POINT_T offset) {
+    FLOAT_POINT_T k = std::ceil((lo - offset) / (2 * pi) - 1e-9);
+    return offset + 2 * k * pi <= hi + 1e-9;
+  };
+  FLOAT_POINT_T l = std::sin(lo), h = std::sin(hi);
+  FLOAT_POINT_T min = std::min(l, h), max = std::max(l, h);
+  if (_contains_peak(pi / 2))
+    max = 1;
+  if (_contains_peak(-pi / 2))
+    min = -1;
+  auto result = _widen(min, max);
+  return interval(std::max<FLOAT_POINT_T>(result->lo, -1), std::min<FLOAT_POINT_T>(result->hi, 1));
+}
+
+inline interval_result_t interval_cos(interval operand) {
+  constexpr FLOAT_POINT_T pi = 3.14159265358979323846;
+  return interval_sin(operand, pi / 2);
+}
+
+inline interval_result_t interval_tan(interval operand) {
+  constexpr FLOAT_POINT_T pi = 3.14159265358979323846;
+  if (!operand.is_finite() || operand.width() >= pi)
+    return std::nullopt;
+  // the function is monotonic if there is no asymptote in the interval
+  FLOAT_POINT_T k = std::ceil((operand.lo - pi / 2) / pi - 1e-9);
+  if (pi / 2 + k * pi <= operand.hi + 1e-9)
+    return std::nullopt;
+  return _hull({ std::tan(operand.lo), std::tan(operand.hi) });
+}
+
+inline interval_result_t interval_ln(interval operand) {
+  if (operand.lo <= 0)
+    return std::nullopt;
+  return _widen(std::log(operand.lo), std::log(operand.hi));
+}
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_INTERVAL_H
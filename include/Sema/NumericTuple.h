@@ -0,0 +1,86 @@
+/**
+ * This file defines the @code{numeric_tuple} class, the flat
+ * representation of the tuples of numbers, and the elementwise kernels
+ * on it.
+ *
+ * The value of a tuple is a @code{std::vector<std::any>}, which boxes
+ * every element. The operators on a TUPLE<Integer> or TUPLE<Double>
+ * unpack it into a contiguous array once, run a kernel over the whole
+ * array and pack the result again, instead of evaluating the elements
+ * one by one as separate values. The kernels are plain loops over the
+ * arrays, which the compiler can vectorise.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_NUMERICTUPLE_H
+#define DRAWING_LANG_INTERPRETER_NUMERICTUPLE_H
+
+#include <AST/Expr.h>
+#include <Interpret/TypedValue.h>
+#include <optional>
+#include <vector>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+class numeric_tuple {
+public:
+  numeric_tuple(std::vector<FLOAT_POINT_T> values, bool is_integer)
+    : _values(std::move(values)), _is_integer(is_integer) { }
+
+  /**
+   * Unpacks a value of type @param{t}. Returns @code{std::nullopt} if
+   * @param{t} is not a tuple of numbers.
+   */
+  static std::optional<numeric_tuple> unpack(const type& t, const std::any& value);
+  /**
+   * Packs the tuple as a TUPLE<Integer> if the elements are Integers,
+   * otherwise as a TUPLE<Double>.
+   */
+  [[nodiscard]] typed_value pack() const;
+
+  [[nodiscard]] std::size_t size() const { return _values.size(); }
+  [[nodiscard]] const FLOAT_POINT_T* data() const { return _values.data(); }
+  [[nodiscard]] FLOAT_POINT_T* data() { return _values.data(); }
+  [[nodiscard]] FLOAT_POINT_T operator[](std::size_t idx) const { return _values[idx]; }
+  [[nodiscard]] bool is_integer() const { return _is_integer; }
+  void set_integer(bool is_integer) { _is_integer = is_integer; }
+private:
+  std::vector<FLOAT_POINT_T> _values;
+  bool _is_integer;
+};
+
+/**
+ * Computes @code{values[i] OP scalar} into @param{out} for the
+ * @param{count} elements. @param{out} may be @param{values}.
+ */
+void tuple_scalar_kernel(binary_expr::op_kind kind, const FLOAT_POINT_T* values,
+                         FLOAT_POINT_T scalar, FLOAT_POINT_T* out, std::size_t count);
+
+/**
+ * Computes @code{-values[i]} into @param{out} for the @param{count}
+ * elements. @param{out} may be @param{values}.
+ */
+void tuple_negate_kernel(const FLOAT_POINT_T* values, FLOAT_POINT_T* out, std::size_t count);
+
+/**
+ * Returns the index of the first element which is infinite or NaN, or
+ * @param{count} if all the elements are finite.
+ */
+std::size_t find_invalid_element(const FLOAT_POINT_T* values, std::size_t count);
+
+/**
+ * Turns the negative zeros into positive zeros as converting them to
+ * Integers does, and returns true if all the elements can be
+ * represented by an Integer.
+ */
+bool normalize_integer_elements(FLOAT_POINT_T* values, std::size_t count);
+
+/**
+ * Compares two tuples in lexicographical order. Returns -1, 0 or 1
+ * as @code{sema::compare} does.
+ */
+int compare_tuples(const numeric_tuple& lhs, const numeric_tuple& rhs);
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_NUMERICTUPLE_H
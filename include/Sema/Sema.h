@@ -6,6 +6,8 @@
 #include <AST/Type.h>
 #include <Diagnostic/DiagEngine.h>
 #include "IdentifierInfo.h"
+#include "Interval.h"
+#include "NumericTuple.h"
 #include <Interpret/TypedValue.h>
 
 INTERPRETER_NAMESPACE_BEGIN
@@ -73,6 +75,59 @@ public:
    */
   std::optional<typed_value> evaluate(expr* e, bool simplify = false);
 
+  /**
+   * Infers the types of the values of @param{e} and its sub-expressions
+   * and caches them in the nodes. For each numeric expression, a kernel
+   * specialized for the operator and the types of the operands is
+   * selected, so that the evaluation of the expression does not check
+   * the types again. This requires the variables in the expression to be
+   * bound.
+   *
+   * The types of the variables never change after they are defined, so
+   * the inference is done only once. However, a call expression can only
+   * be inferred after it is bound to a function (in its first
+   * evaluation), and the expressions depending on it are left
+   * @code{ik_unknown}, which are inferred again in the next call.
+   */
+  expr::inferred_kind infer_type(expr* e);
+
+  /**
+   * Evaluates @param{e} with its kernel, which must have been selected
+   * by @code{infer_type}.
+   */
+  std::optional<typed_value> _evaluate_by_kernel(expr* e);
+
+  /**
+   * Evaluates the numeric expression @param{e} like @code{evaluate}, and
+   * stores the value in @param{result}. If @param{e} shares its value
+   * with the same subexpressions (see @code{expr::get_shared_node}), the
+   * value computed in the current evaluation is reused.
+   */
+  bool _evaluate_number(expr* e, number_value& result);
+
+  /**
+   * Caches @param{value} as the value of @param{e} in the current
+   * evaluation. @param{e} must share its value.
+   */
+  void _cache_number(expr* e, number_value value) {
+    e->get_shared_node()->cache_value(_evaluation, value);
+  }
+
+  /**
+   * Evaluates the range of the value of @param{e} when the variable
+   * @param{var} takes any value in @param{range} and other variables
+   * keep their current values. Only numeric expressions made up of
+   * arithmetic operators and the pure math functions (sin, cos, tan,
+   * ln and abs) are supported. The variables in the expression must
+   * have been bound.
+   *
+   * If the range cannot be bounded, or the real evaluation of the
+   * expression may fail or make a diagnostic for some values in the
+   * range, returns @code{std::nullopt}.
+   */
+  [[nodiscard]] interval_result_t
+  evaluate_interval(expr* e, const variable_info* var, interval range) const;
+
   /**
    * Checks whether the @param{value} can be represented
    * by an @code{int}.
@@ -93,6 +148,30 @@ public:
   [[nodiscard]] bool can_convert_to(const type& from, const type& to) const;
 
 private:
+  /**
+   * The id of the evaluation of the whole expression in progress, which
+   * is unique among all the @code{sema} objects, so the cached values of
+   * the previous evaluations are never used.
+   */
+  std::uint64_t _evaluation = 0;
+  /**
+   * The number of the nested calls of @code{evaluate}.
+   */
+  std::size_t _evaluation_depth = 0;
+
+  /**
+   * Finds the pure numeric subexpressions of @param{root} which appear
+   * more than once, and makes them share the value of the first one.
+   * The calls of sin and cos on the same argument are fused, so both
+   * values are computed at once. This requires @param{root} to be inferred.
+   */
+  void _share_common_subexprs(expr* root);
+
+  /**
+   * Evaluates @param{e} without looking up its shared value.
+   */
+  std::optional<typed_value> _evaluate_unshared(expr* e);
+
   [[nodiscard]] int get_match_level(const type& arg, const type& param) const;
 
   [[nodiscard]] std::vector<const function_info*>
@@ -148,7 +227,15 @@ private:
   [[nodiscard]] std::optional<typed_value>
   _binary_on_tuple_num(const type& lhs_type, std::any lhs_value,
                        const type& rhs_type, std::any rhs_value,
-                       std::size_t op_loc, std::function<_binary_op_impl_t> impl) const;
+                       std::size_t op_loc, binary_expr::op_kind kind,
+                       std::function<_binary_op_impl_t> impl) const;
+  /**
+   * Applies the operator to each element of a tuple of numbers and a
+   * number with the kernels on the flat representation.
+   */
+  [[nodiscard]] std::optional<typed_value>
+  _binary_on_numeric_tuple(const numeric_tuple& tuple, const type& other_type, std::any other,
+                           std::size_t op_loc, binary_expr::op_kind kind) const;
   using _unary_op_impl_t =
       std::optional<typed_value>(const type&, std::any, std::size_t);
   [[nodiscard]] std::optional<typed_value>
@@ -0,0 +1,59 @@
+/**
+ * This file defines the @code{bk_tree} class, which finds the words
+ * similar to a given word without comparing it with all the words.
+ *
+ * A BK-tree is built on the edit distance (see
+ * @code{string_ref::edit_distance}): each child of a node is labelled
+ * with its distance to the node, and the distances of all the words in
+ * a subtree to the node are the label of its root. By the triangle
+ * inequality, only the subtrees whose labels are close enough to the
+ * distance between the word and the node can contain a similar word,
+ * so most of the tree is skipped.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_BKTREE_H
+#define DRAWING_LANG_INTERPRETER_BKTREE_H
+
+#include "StringRef.h"
+#include <utility>
+#include <vector>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+class bk_tree {
+public:
+  /**
+   * Adds @param{word} to the tree if it is not in the tree. The tree
+   * does not copy the characters, so they must live as long as the tree.
+   */
+  void insert(string_ref word);
+  [[nodiscard]] std::size_t size() const { return _nodes.size(); }
+  [[nodiscard]] bool empty() const { return _nodes.empty(); }
+
+  /**
+   * Returns all the words closest to @param{word} whose distances to it
+   * are at most @param{max_distance}, in no particular order.
+   *
+   * A word is not considered similar if the distance is not less than
+   * its length or the length of @param{word}, e.g. "x" and "y" are not
+   * similar although their distance is 1.
+   */
+  [[nodiscard]] std::vector<string_ref> find_closest(string_ref word, unsigned max_distance) const;
+private:
+  struct _node {
+    string_ref word;
+    /**
+     * The distances to the children and their indices in @code{_nodes}.
+     */
+    std::vector<std::pair<unsigned, std::size_t>> children;
+  };
+  /**
+   * The first node is the root.
+   */
+  std::vector<_node> _nodes;
+};
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_BKTREE_H
@@ -0,0 +1,75 @@
+/**
+ * This file defines the @code{counter} and @code{counter_registry}
+ * classes, which count how much work a run does, e.g. the tokens lexed
+ * and the calls of each predefined function.
+ *
+ * The counters are grouped by the part of the interpreter which updates
+ * them, and the driver prints all of them as JSON with `--stats`.
+ * Counting is disabled by default. Then @code{counter::add} only reads
+ * a flag, and the callers skip finding the counters (e.g. by the names
+ * of the diagnostics), so the overhead is negligible.
+ *
+ * @author 19030500131 zy
+ */
+#ifndef DRAWING_LANG_INTERPRETER_COUNTERS_H
+#define DRAWING_LANG_INTERPRETER_COUNTERS_H
+
+#include "StringRef.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+class counter;
+
+class counter_registry {
+public:
+  [[nodiscard]] static bool is_enabled() { return _enabled.load(std::memory_order_relaxed); }
+  static void enable(bool enabled = true) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+  /**
+   * Returns the counter @param{name} of @param{group}, which is created
+   * the first time it is used. The counter lives until the program ends,
+   * so the reference can be saved by the caller.
+   */
+  static counter& get(string_ref group, string_ref name);
+  /**
+   * Sets all the counters to zero.
+   */
+  static void reset();
+  /**
+   * Returns a JSON object which maps each group to the object of its
+   * counters, e.g. @code{{"lexer": {"tokens": 42}}}. The groups and the
+   * counters are sorted by name, and the counters of zero are omitted.
+   */
+  [[nodiscard]] static std::string to_json();
+private:
+  inline static std::atomic<bool> _enabled{false};
+};
+
+/**
+ * A counter which can be updated by several threads at the same time.
+ */
+class counter {
+public:
+  counter() = default;
+  counter(const counter&) = delete;
+  counter& operator=(const counter&) = delete;
+
+  /**
+   * Adds @param{n} to the counter if counting is enabled.
+   */
+  void add(std::uint64_t n = 1) {
+    if (counter_registry::is_enabled())
+      _value.fetch_add(n, std::memory_order_relaxed);
+  }
+  [[nodiscard]] std::uint64_t get() const { return _value.load(std::memory_order_relaxed); }
+  void reset() { _value.store(0, std::memory_order_relaxed); }
+private:
+  std::atomic<std::uint64_t> _value{0};
+};
+
+INTERPRETER_NAMESPACE_END
+
+#endif //DRAWING_LANG_INTERPRETER_COUNTERS_H
@@ -57,6 +57,13 @@ public:
   std::size_t file_size() const { return _length; }
 
   [[nodiscard]] std::error_code from_file(const std::filesystem::path& file_path);
+  /**
+   * Copies the first @param{length} characters of @param{buf} as the
+   * contents of the file, which is named @param{file_name} in the
+   * diagnostics. This is used when the program is embedded in another
+   * file (e.g. the C++ code emitted for it).
+   */
+  void from_buffer(const char* buf, std::size_t length, const std::filesystem::path& file_name);
 protected:
   // only used for unit test
   file_manager(const char* buf, std::size_t length, _file_name_t file_name) :
@@ -5,63 +5,78 @@
  */
 #include "Diagnostic/DiagConsumer.h"
 #include <Diagnostic/DiagData.h>
+#include <filesystem>
 #include <iostream>
 
 INTERPRETER_NAMESPACE_BEGIN
 
-template<class Ty>
-void print_file_name(const Ty& str);
-
-template<>
-void print_file_name<std::string>(const std::string& str) {
-  std::cerr << str;
+namespace {
+void print_file_name(std::ostream& out, const std::string& str) {
+  out << str;
 }
-template<>
-void print_file_name<std::wstring>(const std::wstring& str) {
-  std::wcerr << str;
+#ifdef _WIN32
+// The file names are wide strings on Windows only.
+void print_file_name(std::ostream& out, const std::wstring& str) {
+  // The console shows the wide names with the wide stream.
+  if (&out == &std::cerr)
+    std::wcerr << str;
+  else
+    out << std::filesystem::path(str).string();
 }
+#endif
 
-void cmd_diag_consumer::report(const drawing::diag_data* data) {
+void print_diag(std::ostream& out, const diag_data* data) {
   if (data->has_file_name()) {
-    print_file_name(data->file_name);
-    std::cerr << ':';
+    print_file_name(out, data->file_name);
+    out << ':';
   }
   if (data->has_line())
-    std::cerr << data->line_idx + 1 << ':';
+    out << data->line_idx + 1 << ':';
   if (data->has_fix_hint())
-    std::cerr << data->fix.replace_range.first << ": ";
+    out << data->fix.replace_range.first << ": ";
   else if (data->has_column())
-    std::cerr << data->column_start_idx << ": ";
+    out << data->column_start_idx << ": ";
   switch (data->level) {
     case diag_data::ERROR:
-      std::cerr << "error: ";
+      out << "error: ";
       break;
     case diag_data::WARNING:
-      std::cerr << "warning: ";
+      out << "warning: ";
       break;
     case diag_data::NOTE:
-      std::cerr << "note: ";
+      out << "note: ";
       break;
   }
-  std::cerr << data->_result_diag_message << '\n';
+  out << data->_result_diag_message << '\n';
   if (data->has_line()) {
-    std::cerr << static_cast<std::string>(data->source_line) << '\n';
+    out << static_cast<std::string>(data->source_line) << '\n';
     if (data->has_fix_hint()) {
       auto& hint = data->fix;
-      std::cerr << std::string(hint.replace_range.first, ' ') << '^';
+      out << std::string(hint.replace_range.first, ' ') << '^';
       for (auto i = hint.replace_range.first + 1; i < hint.replace_range.second; ++i)
-        std::cerr << '~';
-      std::cerr << '\n';
-      std::cerr << std::string(hint.replace_range.first, ' ') << hint.code_to_insert;
+        out << '~';
+      out << '\n';
+      out << std::string(hint.replace_range.first, ' ') << hint.code_to_insert;
     } else if (data->has_column()) {
-      std::cerr << std::string(data->column_start_idx, ' ') << '^';
+      out << std::string(data->column_start_idx, ' ') << '^';
       if (data->is_column_range()) {
         for (auto i = data->column_start_idx + 1; i < data->column_end_idx; ++i)
-          std::cerr << '~';
+          out << '~';
       }
     }
-    std::cerr << '\n';
+    out << '\n';
   }
 }
+} // namespace
+
+void cmd_diag_consumer::report(const drawing::diag_data* data) {
+  print_diag(std::cerr, data);
+}
+
+void stream_diag_consumer::report(const drawing::diag_data* data) {
+  if (data->level == diag_data::ERROR)
+    _has_error = true;
+  print_diag(_out, data);
+}
 
 INTERPRETER_NAMESPACE_END
@@ -7,7 +7,9 @@
 #include <Diagnostic/DiagEngine.h>
 #include <Diagnostic/DiagData.h>
 #include <Utils/FileManager.h>
+#include <Utils/Counters.h>
 #include <algorithm>
+#include <cstring>
 
 INTERPRETER_NAMESPACE_BEGIN
 
@@ -21,9 +23,23 @@ std::vector<std::tuple<string_ref, decltype(diag_data::level)>> _diag_info = {
 #undef NOTE
 };
 
+/**
+ * The names of the diagnostics, which are used by the counters.
+ */
+static const char* const _diag_names[] = {
+#define ERROR(err_type, err_str) #err_type,
+#define WARNING(warning_type, warning_str) #warning_type,
+#define NOTE(note_type, note_str) #note_type,
+#include "Diagnostic/DiagTypes.h"
+#undef ERROR
+#undef WARNING
+#undef NOTE
+};
+
 void diag_engine::set_file(const file_manager *manager) {
   _file_manager = manager;
-  _generate_line_cache();
+  _lines.assign(1, 0);
+  _scanned = 0;
 }
 
 
@@ -31,29 +47,27 @@ void diag_engine::set_consumer(diag_consumer *consumer) {
   _diag_consumer = consumer;
 }
 
-void diag_engine::_generate_line_cache() {
-  if (!_file_manager)
-    return;
-  decltype(_lines) _temp_result;
-  auto beg = _file_manager->get_file_buf_begin(), end = _file_manager->get_file_buf_end();
-  for (auto ch = beg, line_beg = beg; ch != end; ++ch) {
-    if (*ch == '\n') {
-      _temp_result.push_back(static_cast<decltype(_lines)::value_type>(line_beg - beg));
-      line_beg = ch + 1;
-    }
+void diag_engine::_scan_lines(std::size_t location) const {
+  const char* beg = _file_manager->get_file_buf_begin();
+  std::size_t size = _file_manager->file_size();
+  while (_lines.back() <= location && _scanned < size) {
+    // std::memchr compares many characters at once in the C library,
+    // which is much faster than checking them one by one.
+    auto newline = static_cast<const char*>(std::memchr(beg + _scanned, '\n', size - _scanned));
+    _scanned = newline ? static_cast<std::size_t>(newline - beg) + 1 : size;
+    _lines.push_back(_scanned);
   }
-  _temp_result.push_back(_file_manager->file_size());
-  _lines = std::move(_temp_result);
 }
 
 std::optional<std::size_t>
 diag_engine::_get_line_num(std::size_t location, bool& invalid) const {
-  if (!_file_manager || _lines.size() < 2)
+  if (!_file_manager || _file_manager->file_size() == 0)
     return std::nullopt;
   if (location >= _file_manager->file_size()) {
     invalid = true;
     return std::nullopt;
   }
+  _scan_lines(location);
   auto iter = std::upper_bound(_lines.begin(), _lines.end(), location);
   return static_cast<std::size_t>(iter - _lines.begin() - 1);
 }
@@ -109,6 +123,8 @@ diag_builder diag_engine::create_diag(diag_id diag_type,
 diag_builder diag_engine::create_diag(diag_id diag_type,
                                       std::size_t start_loc,
                                       std::size_t end_loc) const {
+  if (counter_registry::is_enabled())
+    counter_registry::get("diagnostics", _diag_names[diag_type]).add();
   diag_data* result = _create_diag_impl(std::get<0>(_diag_info[diag_type]), start_loc, end_loc);
   result->level = std::get<1>(_diag_info[diag_type]);
   return static_cast<diag_builder>(result);
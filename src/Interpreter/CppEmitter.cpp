@@ -0,0 +1,844 @@
+#include <Interpret/CppEmitter.h>
+#include <Interpret/InternalSupport/InternalImpl.h>
+#include <AST/StmtVisitor.h>
+#include <cstdio>
+#include <unordered_map>
+#include <unordered_set>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+/**
+ * The kinds of the values of the emitted expressions. The numbers are
+ * represented by @code{transpiled_number}, the strings by
+ * @code{STRING_T} and the tuples by @code{std::optional<transpiled_tuple>}.
+ * For @code{vk_number} and @code{vk_tuple}, whether the value is an
+ * Integer (or a tuple of Integers) is only known at runtime.
+ */
+enum value_kind {
+  vk_integer,
+  vk_float_point,
+  vk_number,
+  vk_string,
+  vk_integer_tuple,
+  vk_float_tuple,
+  vk_tuple,
+  vk_void,
+};
+
+bool is_number(value_kind kind) { return kind <= vk_number; }
+bool is_tuple(value_kind kind) { return kind >= vk_integer_tuple && kind <= vk_tuple; }
+bool is_dynamic(value_kind kind) { return kind == vk_number || kind == vk_tuple; }
+
+/**
+ * Returns the kind of the values of type @param{t}, or
+ * @code{std::nullopt} if they cannot be emitted.
+ */
+std::optional<value_kind> get_value_kind(const type& t) {
+  switch (t.get_kind()) {
+    case type::INTEGER: return vk_integer;
+    case type::FLOAT_POINT: return vk_float_point;
+    case type::STRING: return vk_string;
+    case type::VOID: return vk_void;
+    case type::TUPLE:
+      if (t.get_sub_type().is(type::INTEGER))
+        return vk_integer_tuple;
+      if (t.get_sub_type().is(type::FLOAT_POINT))
+        return vk_float_tuple;
+      return std::nullopt;
+  }
+  return std::nullopt;
+}
+
+/**
+ * Returns the type of the values of @param{kind}. The dynamic kinds are
+ * given as Integers, and @param{as_float} gives them as Doubles.
+ */
+type get_type(value_kind kind, bool as_float = false) {
+  auto tuple_of = [](type::type_kind sub) {
+    return type(type::TUPLE, std::make_unique<type>(sub));
+  };
+  switch (kind) {
+    case vk_integer: return type(type::INTEGER);
+    case vk_float_point: return type(type::FLOAT_POINT);
+    case vk_number: return type(as_float ? type::FLOAT_POINT : type::INTEGER);
+    case vk_string: return type(type::STRING);
+    case vk_integer_tuple: return tuple_of(type::INTEGER);
+    case vk_float_tuple: return tuple_of(type::FLOAT_POINT);
+    case vk_tuple: return tuple_of(as_float ? type::FLOAT_POINT : type::INTEGER);
+    case vk_void: return type(type::VOID);
+  }
+  assert(false);
+  return type(type::VOID);
+}
+
+std::string get_cpp_type(const type& t) {
+  if (t.is(type::TUPLE))
+    return "std::vector<" + get_cpp_type(t.get_sub_type()) + ">";
+  switch (t.get_kind()) {
+#define BASIC_TYPE(NAME, TYPE, SPELLING) case type::NAME: return #NAME "_T";
+#include <Interpret/TypeDef.h>
+    default:
+      assert(false);
+      return "";
+  }
+}
+
+const char* get_op_kind_name(binary_expr::op_kind kind) {
+  switch (kind) {
+#define BIN_OP(NAME, OP, PREC, ASSOC, TOKEN) \
+    case binary_expr::bo_##NAME: return "binary_expr::bo_" #NAME;
+#include <AST/OpKindDef.h>
+    default:
+      assert(false);
+      return "";
+  }
+}
+
+/**
+ * Spells @param{str} as a C++ string literal.
+ */
+std::string quote(string_ref str) {
+  std::string result = "\"";
+  for (char c : str.str()) {
+    switch (c) {
+      case '\\': result += "\\\\"; break;
+      case '"': result += "\\\""; break;
+      case '\n': result += "\\n"; break;
+      case '\t': result += "\\t"; break;
+      case '\r': result += "\\r"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20 || c == 0x7F) {
+          char buf[8];
+          std::snprintf(buf, sizeof(buf), "\\%03o", static_cast<unsigned char>(c));
+          result += buf;
+        } else {
+          result += c;
+        }
+    }
+  }
+  return result + "\"";
+}
+
+struct emitted_expr {
+  std::string code;
+  value_kind kind;
+};
+
+/**
+ * The state shared by the emitters of the statements and expressions.
+ */
+struct emit_state {
+  sema& action;
+  /**
+   * The names of the predefined variables, constants and the member
+   * functions of @code{internal_impl} for the predefined functions.
+   */
+  std::unordered_map<const variable_info*, std::string> predefined_vars;
+  std::unordered_map<const function_info*, std::string> predefined_funcs;
+  /**
+   * The C++ names of the variables defined by the program.
+   */
+  std::unordered_map<const variable_info*, std::string> program_vars;
+  /**
+   * The variables defined by the program whose types are only known at
+   * runtime, which are saved as @code{number_value}.
+   */
+  std::unordered_set<const variable_info*> dynamic_vars;
+  std::size_t temp_count = 0;
+
+  explicit emit_state(sema& action);
+
+  /**
+   * Returns a new name for a temporary variable.
+   */
+  std::string make_temp(const char* prefix) {
+    return prefix + std::to_string(temp_count++);
+  }
+
+  /**
+   * Returns the C++ expression referring to the variable.
+   */
+  std::string get_var_ref(const variable_info* info) const {
+    if (auto iter = program_vars.find(info); iter != program_vars.end())
+      return iter->second;
+    return "rt.var_" + predefined_vars.at(info) + "()";
+  }
+
+  /**
+   * Returns the code of @param{value} converted to @param{to}. The value
+   * must have been checked to be valid if it can fail.
+   */
+  static std::string convert(const std::string& value, value_kind kind, const type& to,
+                             std::size_t start, std::size_t end);
+};
+
+emit_state::emit_state(sema& action) : action(action) {
+  symbol_table& table = action.get_symbol_table();
+  std::unordered_map<std::string, std::size_t> overload_index;
+  auto add_variable = [&](const char* name) {
+    predefined_vars[table.get_variable(name)] = name;
+  };
+  auto add_function = [&](const char* spelling, const char* func_name) {
+    // The overloads are exported in the order listed in Predefined.h.
+    std::vector<const function_info*> overloads = table.get_function(spelling);
+    predefined_funcs[overloads.at(overload_index[spelling]++)] = func_name;
+  };
+#define PREDEFINED_VARIABLE(NAME, TYPE, VALUE) add_variable(#NAME);
+#define PREDEFINED_VARIABLE_WITH_FILTER(NAME, TYPE, VALUE, FILTER) add_variable(#NAME);
+#define PREDEFINED_CONSTANT(NAME, TYPE, VALUE) add_variable(#NAME);
+#define PREDEFINED_FUNCTION(SPELLING, FUNC_NAME, RET, ...) add_function(#SPELLING, #FUNC_NAME);
+#define PREDEFINED_CONST_FUNCTION(SPELLING, FUNC_NAME, RET, ...) add_function(#SPELLING, #FUNC_NAME);
+#include <Interpret/InternalSupport/Predefined.h>
+}
+
+std::string emit_state::convert(const std::string& value, value_kind kind, const type& to,
+                                std::size_t start, std::size_t end) {
+  std::string loc = std::to_string(start) + ", " + std::to_string(end);
+  if (is_number(kind) && to.is(type::INTEGER))
+    return "rt.to_integer(*" + value + ", " + loc + ")";
+  if (is_number(kind) && to.is(type::FLOAT_POINT))
+    return "transpiled_runtime::to_float(*" + value + ")";
+  if (is_tuple(kind) && to.is(type::TUPLE) && to.get_sub_type().is(type::INTEGER))
+    return "rt.to_integer_tuple(*" + value + ", " + loc + ")";
+  if (is_tuple(kind) && to.is(type::TUPLE) && to.get_sub_type().is(type::FLOAT_POINT))
+    return "transpiled_runtime::to_float_tuple(std::move(*" + value + "))";
+  assert(kind == vk_string && to.is(type::STRING));
+  return "std::move(" + value + ")";
+}
+
+/**
+ * Emits the C++ expressions, which evaluate the expressions as the
+ * interpreter does. The variables in the expressions must have been
+ * bound.
+ */
+class expr_emitter : public stmt_visitor<expr_emitter, std::optional<emitted_expr>> {
+public:
+  using RetTy = std::optional<emitted_expr>;
+
+  explicit expr_emitter(emit_state& state) : _state(state) { }
+
+  RetTy visit_num_expr(num_expr* e) {
+    double value = e->get_value();
+    if (!e->has_float_point() && sema::check_double_to_int(value)) {
+      return emitted_expr { "transpiled_runtime::integer(" +
+                            std::to_string(static_cast<INTEGER_T>(value)) + ")", vk_integer };
+    }
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.17g", value);
+    return emitted_expr { std::string("transpiled_runtime::float_point(") + buf + ")",
+                          vk_float_point };
+  }
+
+  RetTy visit_string_expr(string_expr* e) {
+    return emitted_expr { "STRING_T(" + quote(e->get_value()) + ")", vk_string };
+  }
+
+  RetTy visit_variable_expr(variable_expr* e) {
+    assert(e->has_bind_info());
+    const variable_info& info = e->get_bind_info();
+    if (_state.dynamic_vars.count(&info))
+      return emitted_expr { "transpiled_number(" + _state.get_var_ref(&info) + ")", vk_number };
+    std::optional<value_kind> kind = get_value_kind(info.get_type());
+    if (!kind) {
+      _unsupported(e->get_start_loc(), "the variables of this type");
+      return std::nullopt;
+    }
+    std::string ref = _state.get_var_ref(&info);
+    switch (*kind) {
+      case vk_integer:
+        return emitted_expr { "transpiled_runtime::integer(" + ref + ")", *kind };
+      case vk_float_point:
+        return emitted_expr { "transpiled_runtime::float_point(" + ref + ")", *kind };
+      case vk_string:
+        return emitted_expr { "STRING_T(" + ref + ")", *kind };
+      default:
+        return emitted_expr { "transpiled_runtime::tuple(" + ref + ")", *kind };
+    }
+  }
+
+  RetTy visit_binary_expr(binary_expr* e) {
+    auto [lhs, rhs] = std::pair<RetTy, RetTy>{ visit(e->get_lhs()), visit(e->get_rhs()) };
+    if (!lhs || !rhs)
+      return std::nullopt;
+    if (!is_number(lhs->kind) || !is_number(rhs->kind)) {
+      _unsupported(e->get_op_loc(), "the operators on strings and tuples");
+      return std::nullopt;
+    }
+    // See sema::_binary_on_basic_num_type for the types of the results.
+    bool lhs_integer = lhs->kind != vk_float_point;
+    bool rhs_integer = rhs->kind != vk_float_point;
+    bool may_be_integer = e->get_op_kind() == binary_expr::bo_pow ? lhs_integer
+                                                                  : lhs_integer && rhs_integer;
+    return emitted_expr {
+      std::string("rt.binary<") + get_op_kind_name(e->get_op_kind()) + ">({ " +
+          lhs->code + ", " + rhs->code + " }, " + std::to_string(e->get_op_loc()) + ")",
+      may_be_integer ? vk_number : vk_float_point
+    };
+  }
+
+  RetTy visit_unary_expr(unary_expr* e) {
+    RetTy operand = visit(e->get_operand());
+    if (!operand)
+      return std::nullopt;
+    if (!is_number(operand->kind)) {
+      _unsupported(e->get_operator_loc(), "the operators on strings and tuples");
+      return std::nullopt;
+    }
+    if (e->get_op_kind() == unary_expr::uo_plus)
+      return operand;
+    return emitted_expr { "transpiled_runtime::negate(" + operand->code + ")",
+                          operand->kind == vk_float_point ? vk_float_point : vk_number };
+  }
+
+  RetTy visit_tuple_expr(tuple_expr* e) {
+    std::string code = "transpiled_runtime::make_tuple({ ";
+    bool all_integer = true, has_float = false, success = true;
+    for (auto iter = e->elem_begin(); iter != e->elem_end(); ++iter) {
+      RetTy elem = visit(iter->get());
+      if (!elem) {
+        success = false;
+        continue;
+      }
+      if (!is_number(elem->kind)) {
+        _unsupported((*iter)->get_start_loc(), "the tuples of strings and tuples");
+        success = false;
+        continue;
+      }
+      all_integer &= elem->kind == vk_integer;
+      has_float |= elem->kind == vk_float_point;
+      code += (iter == e->elem_begin() ? "" : ", ") + elem->code;
+    }
+    if (!success)
+      return std::nullopt;
+    return emitted_expr { code + " })",
+                          all_integer ? vk_integer_tuple : has_float ? vk_float_tuple : vk_tuple };
+  }
+
+  RetTy visit_call_expr(call_expr* e);
+private:
+  emit_state& _state;
+
+  void _unsupported(std::size_t loc, const char* what) {
+    _state.action.diag(err_emit_unsupported, loc) << what << diag_build_finish;
+  }
+
+  /**
+   * Emits the call of @param{func} with the arguments saved in
+   * @param{args}, which have been checked to be valid.
+   */
+  std::optional<std::string> _emit_call(call_expr* e, const function_info* func,
+                                        const std::vector<std::string>& args,
+                                        const std::vector<emitted_expr>& values,
+                                        value_kind result_kind);
+};
+
+expr_emitter::RetTy expr_emitter::visit_call_expr(call_expr* e) {
+  std::vector<emitted_expr> values;
+  for (auto iter = e->param_begin(); iter != e->param_end(); ++iter) {
+    RetTy value = visit(iter->get());
+    if (value)
+      values.push_back(std::move(*value));
+  }
+  if (values.size() != e->get_param_count())
+    return std::nullopt;
+  // Resolve the overloads for all the possible types of the arguments.
+  std::vector<std::size_t> dynamic_args;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    if (values[i].kind == vk_void) {
+      _unsupported(e->get_arg_expr(i)->get_start_loc(), "the Void arguments");
+      return std::nullopt;
+    }
+    if (is_dynamic(values[i].kind))
+      dynamic_args.push_back(i);
+  }
+  if (dynamic_args.size() > 8) {
+    _state.action.diag(err_emit_dynamic_call, e->get_func_name_loc())
+      << e->get_func_name() << diag_build_finish;
+    return std::nullopt;
+  }
+  std::vector<const function_info*> funcs;
+  for (std::size_t mask = 0; mask < (std::size_t(1) << dynamic_args.size()); ++mask) {
+    std::vector<type> types;
+    for (std::size_t i = 0, d = 0; i < values.size(); ++i) {
+      bool as_float = d < dynamic_args.size() && dynamic_args[d] == i && (mask >> d++ & 1);
+      types.push_back(get_type(values[i].kind, as_float));
+    }
+    std::vector<const type*> type_ptrs;
+    for (const type& t : types)
+      type_ptrs.push_back(&t);
+    const function_info* func = _state.action.overload_resolution(
+        e->get_func_name(), e->get_func_name_loc(), type_ptrs);
+    if (!func)
+      return std::nullopt;
+    funcs.push_back(func);
+  }
+  bool same_func = std::all_of(funcs.begin(), funcs.end(),
+                               [&](const function_info* f) { return f == funcs.front(); });
+  if (!same_func && dynamic_args.size() > 1) {
+    _state.action.diag(err_emit_dynamic_call, e->get_func_name_loc())
+      << e->get_func_name() << diag_build_finish;
+    return std::nullopt;
+  }
+  // Find the kind of the result.
+  std::optional<value_kind> result_kind = get_value_kind(funcs.front()->get_ret_type());
+  for (const function_info* func : funcs) {
+    std::optional<value_kind> kind = get_value_kind(func->get_ret_type());
+    if (!kind || !result_kind || *kind == vk_string) {
+      result_kind = std::nullopt;
+      break;
+    }
+    if (*kind == *result_kind)
+      continue;
+    if (is_number(*kind) && is_number(*result_kind))
+      result_kind = vk_number;
+    else if (is_tuple(*kind) && is_tuple(*result_kind))
+      result_kind = vk_tuple;
+    else
+      result_kind = std::nullopt;
+  }
+  if (!result_kind) {
+    _unsupported(e->get_func_name_loc(), "the calls with this result type");
+    return std::nullopt;
+  }
+
+  const char* failure = *result_kind == vk_void ? "false" : "std::nullopt";
+  std::string code = "[&]() -> ";
+  if (is_number(*result_kind))
+    code += "transpiled_number";
+  else if (is_tuple(*result_kind))
+    code += "std::optional<transpiled_tuple>";
+  else
+    code += "bool";
+  code += " { ";
+  std::vector<std::string> args;
+  std::string check;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    args.push_back(_state.make_temp("arg_"));
+    code += "auto " + args.back() + " = " + values[i].code + "; ";
+    if (values[i].kind != vk_string)
+      check += (check.empty() ? "!" : " || !") + args.back();
+  }
+  if (!check.empty())
+    code += "if (" + check + ") return " + failure + "; ";
+  if (same_func) {
+    auto call = _emit_call(e, funcs.front(), args, values, *result_kind);
+    if (!call)
+      return std::nullopt;
+    code += *call;
+  } else {
+    // Only one argument decides which function is called.
+    auto integer_call = _emit_call(e, funcs.front(), args, values, *result_kind);
+    auto float_call = _emit_call(e, funcs.back(), args, values, *result_kind);
+    if (!integer_call || !float_call)
+      return std::nullopt;
+    code += "if (" + args[dynamic_args.front()] + "->is_integer) { " + *integer_call +
+            "} " + *float_call;
+  }
+  return emitted_expr { code + "}()", *result_kind };
+}
+
+std::optional<std::string>
+expr_emitter::_emit_call(call_expr* e, const function_info* func,
+                         const std::vector<std::string>& args,
+                         const std::vector<emitted_expr>& values,
+                         value_kind result_kind) {
+  auto name = _state.predefined_funcs.find(func);
+  if (name == _state.predefined_funcs.end()) {
+    _unsupported(e->get_func_name_loc(), "the calls to this function");
+    return std::nullopt;
+  }
+  std::string code, loc, converted;
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    std::size_t start = e->get_arg_expr(i)->get_start_loc();
+    std::size_t end = e->get_arg_expr(i)->get_end_loc();
+    loc += (i ? ", " : "") + std::to_string(start) + ", " + std::to_string(end);
+    // Convert the arguments in order, which may make diagnostics.
+    std::string arg = _state.make_temp("converted_");
+    code += "auto " + arg + " = " +
+            emit_state::convert(args[i], values[i].kind, func->get_param_type(i), start, end) + "; ";
+    converted += ", std::move(" + arg + ")";
+  }
+  code += "bool success = true; ";
+  std::string call = "rt." + name->second + "(success, { " + loc + " }" + converted + ")";
+  if (func->get_ret_type().is(type::VOID))
+    return code + call + "; return success; ";
+  code += "auto result = " + call + "; if (!success) return std::nullopt; ";
+  switch (*get_value_kind(func->get_ret_type())) {
+    case vk_integer: return code + "return transpiled_runtime::integer(result); ";
+    case vk_float_point: return code + "return transpiled_runtime::float_point(result); ";
+    default:
+      assert(is_tuple(result_kind));
+      (void)result_kind;
+      return code + "return transpiled_runtime::tuple(result); ";
+  }
+}
+
+/**
+ * Emits the statements into the body of @code{main}.
+ */
+class stmt_emitter : public stmt_visitor<stmt_emitter, bool> {
+public:
+  explicit stmt_emitter(emit_state& state) : _state(state), action(state.action) { }
+
+  bool visit_empty_stmt(empty_stmt*) { return true; }
+  bool visit_assignment_stmt(assignment_stmt* s);
+  bool visit_expr_stmt(expr_stmt* s);
+  bool visit_for_stmt(for_stmt* s);
+
+  [[nodiscard]] std::string finish(const file_manager& source) const;
+private:
+  emit_state& _state;
+  sema& action;
+  std::string _decls, _body;
+  /**
+   * The parameters (name and type) of the program.
+   */
+  std::vector<std::pair<std::string, std::string>> _params;
+  std::size_t _indent = 1;
+  std::size_t _loop_depth = 0;
+
+  void _line(const std::string& code) {
+    _body += std::string(2 * _indent, ' ') + code + '\n';
+  }
+
+  std::optional<emitted_expr> _emit_expr(expr* e) {
+    return expr_emitter(_state).visit(e);
+  }
+
+  /**
+   * Deduces the type of the variable defined by @param{s}. Returns
+   * @code{std::nullopt} with no diagnostic if the variable is a number
+   * whose type is only known at runtime.
+   */
+  std::optional<type> _deduce_type(assignment_stmt* s, value_kind kind, bool& success);
+  /**
+   * Defines the variable @param{lhs} of type @param{t}, or a dynamic
+   * number if @param{t} is @code{nullptr}.
+   */
+  void _define_variable(variable_expr* lhs, const type* t);
+  /**
+   * Assigns @param{value} to @param{lhs} as @code{interpreter::_assign_to_value}
+   * does, where [@param{start}, @param{end}) is the location of the value.
+   * @param{define} is true if the assignment defines @param{lhs}.
+   */
+  bool _emit_assignment(variable_expr* lhs, const emitted_expr& value,
+                        std::size_t start, std::size_t end, bool define = false);
+};
+
+/**
+ * Returns true if the value of @param{e} can be computed before running
+ * the program.
+ */
+bool is_constant_expr(const expr* e) {
+  switch (e->get_stmt_kind()) {
+    case stmt::num_expr_type:
+    case stmt::string_expr_type:
+      return true;
+    case stmt::variable_expr_type:
+      return static_cast<const variable_expr*>(e)->get_bind_info().is_constant();
+    case stmt::unary_expr_type:
+      return is_constant_expr(static_cast<const unary_expr*>(e)->get_operand());
+    case stmt::binary_expr_type: {
+      auto* binary = static_cast<const binary_expr*>(e);
+      return is_constant_expr(binary->get_lhs()) && is_constant_expr(binary->get_rhs());
+    }
+    case stmt::tuple_expr_type: {
+      auto* tuple = static_cast<const tuple_expr*>(e);
+      return std::all_of(tuple->elem_begin(), tuple->elem_end(),
+                         [](const expr_result_t& elem) { return is_constant_expr(elem.get()); });
+    }
+    default:
+      return false;
+  }
+}
+
+std::optional<type> stmt_emitter::_deduce_type(assignment_stmt* s, value_kind kind,
+                                               bool& success) {
+  auto* lhs = static_cast<variable_expr*>(s->get_assignment_lhs());
+  success = false;
+  if (kind == vk_void) {
+    action.diag(err_deduced_variable_type, lhs->get_start_loc())
+      << "Void" << diag_build_finish;
+    return std::nullopt;
+  }
+  if (!is_dynamic(kind)) {
+    success = true;
+    return get_type(kind);
+  }
+  // The type of a constant is known if it is computed now.
+  if (is_constant_expr(s->get_assignment_rhs())) {
+    std::optional<typed_value> value = action.evaluate(s->get_assignment_rhs());
+    success = value.has_value();
+    if (!value)
+      return std::nullopt;
+    return value->get_type();
+  }
+  if (kind == vk_number) {
+    success = true;
+    return std::nullopt;
+  }
+  action.diag(err_emit_dynamic_type, lhs->get_start_loc())
+    << lhs->get_name() << diag_build_finish;
+  return std::nullopt;
+}
+
+void stmt_emitter::_define_variable(variable_expr* lhs, const type* t) {
+  std::string name = "v_" + lhs->get_name().str();
+  if (!t) {
+    // The variable is given a type in the symbol table, but it is only
+    // used to bind the variable.
+    variable_info* info = action.add_new_variable(typed_value(type(type::INTEGER), INTEGER_T()),
+                                                  lhs->get_name());
+    lhs->bind_to_variable(info);
+    _state.program_vars[info] = name;
+    _state.dynamic_vars.insert(info);
+    _decls += "  number_value " + name + "{ 0, true };\n";
+    return;
+  }
+  std::any init;
+  switch (t->get_kind()) {
+    case type::INTEGER: init = INTEGER_T(); break;
+    case type::FLOAT_POINT: init = FLOAT_POINT_T(); break;
+    case type::STRING: init = STRING_T(); break;
+    default: init = TUPLE_T(); break;
+  }
+  variable_info* info = action.add_new_variable(typed_value(*t, std::move(init)), lhs->get_name());
+  lhs->bind_to_variable(info);
+  _state.program_vars[info] = name;
+  _decls += "  " + get_cpp_type(*t) + " " + name + "{};\n";
+}
+
+bool stmt_emitter::_emit_assignment(variable_expr* lhs, const emitted_expr& value,
+                                    std::size_t start, std::size_t end, bool define) {
+  variable_info& info = lhs->get_bind_info();
+  const type& to = info.get_type();
+  if (info.is_constant()) {
+    action.diag(err_assign_constant, lhs->get_start_loc()) << diag_build_finish;
+    return false;
+  }
+  std::string temp = _state.make_temp("value_");
+  if (_state.dynamic_vars.count(&info)) {
+    if (!is_number(value.kind)) {
+      action.diag(err_emit_unsupported, start, end)
+        << "the assignments to the numbers of unknown types" << diag_build_finish;
+      return false;
+    }
+    _line("{");
+    ++_indent;
+    _line("auto " + temp + " = " + value.code + ";");
+    _line("if (" + temp + ")");
+    if (define) {
+      _line("  transpiled_runtime::define(" + _state.get_var_ref(&info) + ", *" + temp + ");");
+    } else {
+      _line("  rt.assign(" + _state.get_var_ref(&info) + ", *" + temp + ", " +
+            std::to_string(start) + ", " + std::to_string(end) + ");");
+    }
+    --_indent;
+    _line("}");
+    return true;
+  }
+  bool compatible = is_number(value.kind) ? to.is(type::INTEGER) || to.is(type::FLOAT_POINT)
+                  : is_tuple(value.kind) ? get_value_kind(to) && is_tuple(*get_value_kind(to))
+                  : value.kind == vk_string && to.is(type::STRING);
+  if (!compatible) {
+    action.diag(err_assign_incompatible_type, start, end)
+      << to.get_spelling() << get_type(value.kind).get_spelling() << diag_build_finish;
+    return false;
+  }
+  std::string converted = emit_state::convert(temp, value.kind, to, start, end);
+  std::string set;
+  if (auto iter = _state.program_vars.find(&info); iter != _state.program_vars.end()) {
+    set = iter->second + " = " + converted + ";";
+  } else if (info.get_assignable_address()) {
+    set = "rt.set_" + _state.predefined_vars.at(&info) + "(" + converted + ");";
+  } else {
+    // The value filter makes the diagnostics at these locations.
+    set = "rt.set_" + _state.predefined_vars.at(&info) + "({ " +
+          std::to_string(lhs->get_start_loc()) + ", " + std::to_string(start) + " }, " +
+          converted + ");";
+  }
+  _line("{");
+  ++_indent;
+  _line("auto " + temp + " = " + value.code + ";");
+  if (value.kind == vk_string) {
+    _line(set);
+  } else {
+    _line("if (" + temp + ")");
+    _line("  " + set);
+  }
+  --_indent;
+  _line("}");
+  return true;
+}
+
+bool stmt_emitter::visit_assignment_stmt(assignment_stmt* s) {
+  expr* rhs = s->get_assignment_rhs();
+  if (!action.bind_expr_variables(rhs))
+    return false;
+  std::optional<emitted_expr> value = _emit_expr(rhs);
+  if (!value)
+    return false;
+  assert(s->get_assignment_lhs()->get_stmt_kind() == stmt::variable_expr_type);
+  auto* lhs = static_cast<variable_expr*>(s->get_assignment_lhs());
+  bool define = !lhs->has_bind_info() && !action.try_bind_expr_variables(lhs);
+  if (define) {
+    bool success;
+    std::optional<type> t = _deduce_type(s, value->kind, success);
+    if (!success)
+      return false;
+    _define_variable(lhs, t ? &*t : nullptr);
+  } else if (value->kind == vk_void) {
+    action.diag(err_assign_incompatible_type, rhs->get_start_loc(), rhs->get_end_loc())
+      << lhs->get_bind_type().get_spelling() << "Void" << diag_build_finish;
+    return false;
+  }
+  if (!_emit_assignment(lhs, *value, rhs->get_start_loc(), rhs->get_end_loc(), define))
+    return false;
+  // The variables defined at the top level are the parameters.
+  const variable_info& info = lhs->get_bind_info();
+  if (define && !_loop_depth && info.get_type().is_not(type::TUPLE)) {
+    std::string name = lhs->get_name().str();
+    _line("rt.apply_parameter(" + quote(name) + ", " + _state.get_var_ref(&info) + ");");
+    _params.emplace_back(name, _state.dynamic_vars.count(&info) ? "Integer or Double"
+                                                                : info.get_type().get_spelling());
+  }
+  return true;
+}
+
+bool stmt_emitter::visit_expr_stmt(expr_stmt* s) {
+  if (!action.bind_expr_variables(s->get_expr()))
+    return false;
+  std::optional<emitted_expr> value = _emit_expr(s->get_expr());
+  if (!value)
+    return false;
+  _line("(void)" + value->code + ";");
+  return true;
+}
+
+bool stmt_emitter::visit_for_stmt(for_stmt* s) {
+  bool bind_result = action.bind_expr_variables(s->get_for_expr());
+  if (s->has_from())
+    bind_result &= action.bind_expr_variables(s->get_from_expr());
+  bind_result &= action.bind_expr_variables(s->get_to_expr());
+  if (s->has_step())
+    bind_result &= action.bind_expr_variables(s->get_step_expr());
+  if (!bind_result)
+    return false;
+  assert(s->get_for_expr()->get_stmt_kind() == stmt::variable_expr_type);
+  auto* var = static_cast<variable_expr*>(s->get_for_expr());
+  std::optional<emitted_expr> var_value = _emit_expr(var);
+  std::optional<emitted_expr> from, to, step;
+  if (s->has_from())
+    from = _emit_expr(s->get_from_expr());
+  to = _emit_expr(s->get_to_expr());
+  if (s->has_step())
+    step = _emit_expr(s->get_step_expr());
+  else
+    step = emitted_expr { "transpiled_runtime::integer(1)", vk_integer };
+  if (!var_value || (s->has_from() && !from) || !to || !step)
+    return false;
+  if (!is_number(var_value->kind) || (from && !is_number(from->kind)) ||
+      !is_number(to->kind) || !is_number(step->kind)) {
+    action.diag(err_emit_unsupported, s->get_for_loc())
+      << "the loops which are not on numbers" << diag_build_finish;
+    return false;
+  }
+
+  std::string from_name = _state.make_temp("from_"), to_name = _state.make_temp("to_");
+  std::string step_name = _state.make_temp("step_"), next_name = _state.make_temp("next_");
+  _line("{");
+  ++_indent;
+  if (from)
+    _line("transpiled_number " + from_name + " = " + from->code + ";");
+  _line("transpiled_number " + to_name + " = " + to->code + ";");
+  _line("transpiled_number " + step_name + " = " + step->code + ";");
+  _line(std::string("if (") + (from ? from_name + " && " : "") + to_name + " && " +
+        step_name + ") {");
+  ++_indent;
+  if (from && !_emit_assignment(var, { from_name, from->kind },
+                                s->get_from_expr()->get_start_loc(),
+                                s->get_from_expr()->get_end_loc()))
+    return false;
+  _line("transpiled_runtime::stroke_scope " + _state.make_temp("stroke_") + "(rt);");
+  _line("while (transpiled_runtime::less(" + var_value->code + ", " + to_name + ")) {");
+  ++_indent;
+  ++_loop_depth;
+  for (auto iter = s->body_begin(); iter != s->body_end(); ++iter) {
+    if (*iter && !visit(iter->get()))
+      return false;
+  }
+  --_loop_depth;
+  std::size_t step_loc = s->has_step() ? s->get_step_loc() : var->get_start_loc();
+  _line("transpiled_number " + next_name + " = rt.binary<binary_expr::bo_add>({ " +
+        var_value->code + ", " + step_name + " }, " + std::to_string(step_loc) + ");");
+  _line("if (!" + next_name + ")");
+  _line("  break;");
+  if (!_emit_assignment(var, { next_name, vk_number }, step_loc, step_loc + 1))
+    return false;
+  --_indent;
+  _line("}");
+  --_indent;
+  _line("}");
+  --_indent;
+  _line("}");
+  return true;
+}
+
+std::string stmt_emitter::finish(const file_manager& source) const {
+  std::string file_name = std::filesystem::path(source.get_file_name()).string();
+  std::string result =
+      "// This file is emitted by the drawing language interpreter from\n"
+      "// " + quote(file_name) + ". It links against the internal library\n"
+      "// of the interpreter (with sema, diag and utils).\n";
+  if (!_params.empty()) {
+    result += "//\n// Parameters (given as name=value):\n";
+    for (const auto& [name, spelling] : _params)
+      result += "//   " + name + ": " + spelling + "\n";
+  }
+  result += "#include <Interpret/InternalSupport/Transpiled.h>\n"
+            "\n"
+            "using namespace drawing;\n"
+            "\n"
+            "namespace {\n"
+            "const char source[] =\n";
+  // Embed the program for the diagnostics.
+  const char* line = source.get_file_buf_begin();
+  while (line != source.get_file_buf_end()) {
+    const char* next = std::find(line, source.get_file_buf_end(), '\n');
+    if (next != source.get_file_buf_end())
+      ++next;
+    result += "    " + quote(string_ref(line, next - line)) + "\n";
+    line = next;
+  }
+  result += "    ;\n"
+            "} // namespace\n"
+            "\n"
+            "int main(int argc, char* argv[]) {\n"
+            "  transpiled_runtime rt(source, sizeof(source) - 1, " + quote(file_name) + ");\n"
+            "  if (!rt.parse_parameters(argc, argv, {";
+  for (std::size_t i = 0; i < _params.size(); ++i)
+    result += (i ? ", " : " ") + quote(_params[i].first) + (i + 1 == _params.size() ? " " : "");
+  result += "}))\n"
+            "    return 1;\n" + _decls + _body +
+            "  return 0;\n"
+            "}\n";
+  return result;
+}
+} // namespace
+
+std::optional<std::string>
+cpp_emitter::emit(const std::vector<stmt_result_t>& stmts, const file_manager& source) {
+  emit_state state(action);
+  stmt_emitter emitter(state);
+  bool success = true;
+  for (const auto& s : stmts) {
+    if (!s || !emitter.visit(s.get()))
+      success = false;
+  }
+  if (!success)
+    return std::nullopt;
+  return emitter.finish(source);
+}
+
+INTERPRETER_NAMESPACE_END
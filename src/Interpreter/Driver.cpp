@@ -4,34 +4,375 @@
 #include <Sema/Sema.h>
 #include <Interpret/InternalSupport/InternalImpl.h>
 #include <Interpret/Interpreter.h>
+#include <Interpret/CppEmitter.h>
+#include <Interpret/Watch.h>
+#include <Interpret/Serve.h>
+#include <Interpret/Sweep.h>
 #include <Lex/Lexer.h>
 #include <Parse/Parser.h>
+#include <Utils/Counters.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
 
 using namespace drawing;
 
+namespace {
+/**
+ * The options given in the command line:
+ *
+ *   drawing [--record <list>] [--stats] [--jit] [--threads <n>] <file>
+ *   drawing --watch [--stats] [--jit] [--threads <n>] <file>
+ *   drawing --replay <list> <width> <height> <output> [--stats]
+ *   drawing --emit-cpp <output> <file>
+ *   drawing --serve <socket> [--workers <n>] [--timeout <ms>]
+ *   drawing --sweep <variants> [--jit] [--threads <n>] <file>
+ *
+ * @code{--record} saves the display list of the program to
+ * @code{<list>} after running it. @code{--replay} renders a saved
+ * display list on a canvas of another size without running the
+ * program, and saves the picture to @code{<output>}. @code{--stats}
+ * prints a JSON object to stderr at exit, which contains the statistics
+ * of rendering and scheduling and the counters of the work done by each
+ * part of the interpreter (see @file{Counters.h}). @code{--jit}
+ * runs the bodies of the loops with the native code (see @file{Jit.h}).
+ * @code{--threads} runs the loops which only draw points on @code{<n>}
+ * threads, and evaluates them ahead of the statements in front of them
+ * when possible.
+ * @code{--emit-cpp} translates the program into a C++ program saved to
+ * @code{<output>} instead of running it (see @file{CppEmitter.h}).
+ * @code{--watch} runs the program again whenever the file is saved,
+ * from the first statement which is changed (see @file{Watch.h}), and
+ * @code{--stats} prints the statistics after every run.
+ * @code{--serve} runs the programs sent to the Unix-domain socket
+ * @code{<socket>} on @code{<n>} workers (one per CPU by default), and
+ * returns the pictures to the clients (see @file{Serve.h}). Each
+ * program is stopped after @code{<ms>} milliseconds (10 seconds by
+ * default).
+ * @code{--sweep} renders the program once for each variant of the
+ * parameters in @code{<variants>}, running the statements shared by all
+ * the variants only once, and @code{<n>} variants at the same time
+ * (see @file{Sweep.h}).
+ */
+struct driver_options {
+  const char* input = nullptr;
+  const char* record_path = nullptr;
+  const char* replay_path = nullptr;
+  INTEGER_T replay_width = 0;
+  INTEGER_T replay_height = 0;
+  const char* output = nullptr;
+  const char* emit_path = nullptr;
+  const char* serve_path = nullptr;
+  const char* sweep_path = nullptr;
+  std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+  long timeout = 10000;
+  bool stats = false;
+  bool jit = false;
+  bool watch = false;
+  std::size_t threads = 1;
+};
+
+bool parse_size(diag_engine& diag, const char* str, INTEGER_T& result) {
+  char* end;
+  long value = std::strtol(str, &end, 10);
+  if (*end != '\0' || value <= 0 || value > std::numeric_limits<INTEGER_T>::max()) {
+    diag.create_diag(err_size_value) << str << "--replay" << diag_build_finish;
+    return false;
+  }
+  result = static_cast<INTEGER_T>(value);
+  return true;
+}
+
+bool parse_options(diag_engine& diag, int argc, char* argv[], driver_options& options) {
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--record") == 0) {
+      if (i + 1 >= argc) {
+        diag.create_diag(err_missing_option_value) << argv[i] << diag_build_finish;
+        return false;
+      }
+      options.record_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--replay") == 0) {
+      if (i + 4 >= argc) {
+        diag.create_diag(err_missing_option_value) << argv[i] << diag_build_finish;
+        return false;
+      }
+      options.replay_path = argv[++i];
+      if (!parse_size(diag, argv[++i], options.replay_width) ||
+          !parse_size(diag, argv[++i], options.replay_height))
+        return false;
+      options.output = argv[++i];
+    } else if (std::strcmp(argv[i], "--emit-cpp") == 0) {
+      if (i + 1 >= argc) {
+        diag.create_diag(err_missing_option_value) << argv[i] << diag_build_finish;
+        return false;
+      }
+      options.emit_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--serve") == 0) {
+      if (i + 1 >= argc) {
+        diag.create_diag(err_missing_option_value) << argv[i] << diag_build_finish;
+        return false;
+      }
+      options.serve_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--sweep") == 0) {
+      if (i + 1 >= argc) {
+        diag.create_diag(err_missing_option_value) << argv[i] << diag_build_finish;
+        return false;
+      }
+      options.sweep_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--workers") == 0) {
+      if (i + 1 >= argc) {
+        diag.create_diag(err_missing_option_value) << argv[i] << diag_build_finish;
+        return false;
+      }
+      char* end;
+      long value = std::strtol(argv[++i], &end, 10);
+      if (*end != '\0' || value <= 0 || value > 1024) {
+        diag.create_diag(err_param_value) << argv[i] << "--workers" << diag_build_finish;
+        return false;
+      }
+      options.workers = static_cast<std::size_t>(value);
+    } else if (std::strcmp(argv[i], "--timeout") == 0) {
+      if (i + 1 >= argc) {
+        diag.create_diag(err_missing_option_value) << argv[i] << diag_build_finish;
+        return false;
+      }
+      char* end;
+      long value = std::strtol(argv[++i], &end, 10);
+      if (*end != '\0' || value <= 0) {
+        diag.create_diag(err_param_value) << argv[i] << "--timeout" << diag_build_finish;
+        return false;
+      }
+      options.timeout = value;
+    } else if (std::strcmp(argv[i], "--threads") == 0) {
+      if (i + 1 >= argc) {
+        diag.create_diag(err_missing_option_value) << argv[i] << diag_build_finish;
+        return false;
+      }
+      char* end;
+      long value = std::strtol(argv[++i], &end, 10);
+      if (*end != '\0' || value <= 0 || value > 1024) {
+        diag.create_diag(err_param_value) << argv[i] << "--threads" << diag_build_finish;
+        return false;
+      }
+      options.threads = static_cast<std::size_t>(value);
+    } else if (std::strcmp(argv[i], "--stats") == 0) {
+      options.stats = true;
+    } else if (std::strcmp(argv[i], "--jit") == 0) {
+      options.jit = true;
+    } else if (std::strcmp(argv[i], "--watch") == 0) {
+      options.watch = true;
+    } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+      diag.create_diag(err_unknown_option) << argv[i] << diag_build_finish;
+      return false;
+    } else {
+      options.input = argv[i];
+    }
+  }
+  if (options.serve_path) {
+    // The programs come from the socket.
+    const char* conflict = options.input ? options.input
+                         : options.record_path ? "--record"
+                         : options.replay_path ? "--replay"
+                         : options.emit_path ? "--emit-cpp"
+                         : options.watch ? "--watch"
+                         : options.sweep_path ? "--sweep" : nullptr;
+    if (conflict) {
+      diag.create_diag(err_option_conflict) << "--serve" << conflict << diag_build_finish;
+      return false;
+    }
+    return true;
+  }
+  if (!options.input && !options.replay_path) {
+    diag.create_diag(drawing::err_no_input_file) << diag_build_finish;
+    return false;
+  }
+  if (options.watch) {
+    // The display list and the C++ code are made by one run.
+    const char* conflict = options.record_path ? "--record"
+                         : options.replay_path ? "--replay"
+                         : options.emit_path ? "--emit-cpp" : nullptr;
+    if (conflict) {
+      diag.create_diag(err_option_conflict) << "--watch" << conflict << diag_build_finish;
+      return false;
+    }
+  }
+  if (options.sweep_path) {
+    // Each variant has its own display list and statistics.
+    const char* conflict = options.record_path ? "--record"
+                         : options.replay_path ? "--replay"
+                         : options.emit_path ? "--emit-cpp"
+                         : options.watch ? "--watch"
+                         : options.stats ? "--stats" : nullptr;
+    if (conflict) {
+      diag.create_diag(err_option_conflict) << "--sweep" << conflict << diag_build_finish;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Prints the statistics as a JSON object. The schedule is only printed
+ * if @param{runner} is not nullptr.
+ */
+void print_stats(const internal_impl& internal, const interpreter* runner) {
+  const internal_impl::render_stats& stats = internal.get_render_stats();
+  std::cerr << "{\"render\": {\"visible_points\": " << stats.visible_points
+            << ", \"rasterized_points\": " << stats.rasterized_points
+            << ", \"overdraw_ratio\": " << stats.overdraw_ratio()
+            << ", \"touched_fraction\": " << internal.get_touched_fraction() << '}';
+  if (runner) {
+    const interpreter::schedule_stats& schedule = runner->get_schedule_stats();
+    std::cerr << ", \"schedule\": {\"statements\": " << schedule.statements
+              << ", \"overlapped\": " << schedule.overlapped
+              << ", \"parallelism\": " << schedule.parallelism() << '}';
+  }
+  std::cerr << ", \"counters\": " << counter_registry::to_json() << "}\n";
+}
+
+void run_replay(diag_engine& diag, const driver_options& options) {
+  auto list = display_list::load(options.replay_path);
+  internal_impl internal;
+  if (!list || !internal.replay(*list, cv::Size(options.replay_width, options.replay_height),
+                                options.output)) {
+    diag.create_diag(err_invalid_display_list) << options.replay_path << diag_build_finish;
+    return;
+  }
+  if (options.stats)
+    print_stats(internal, nullptr);
+}
+
+void run_watch(diag_engine& diag, const driver_options& options) {
+  watch_session session(diag);
+  if (options.jit)
+    session.enable_jit();
+  session.enable_parallel(options.threads);
+  // The file is watched from the start, so a save made while the
+  // program runs makes it run again right after.
+  file_watcher watcher(options.input);
+  if (!watcher.is_valid()) {
+    diag.create_diag(err_watch_file) << options.input << diag_build_finish;
+    return;
+  }
+  while (true) {
+    watcher.drain();
+    auto manager = std::make_unique<file_manager>();
+    if (manager->from_file(options.input)) {
+      diag.create_diag(err_open_file) << options.input << diag_build_finish;
+    } else {
+      if (options.stats)
+        counter_registry::reset();
+      session.run(std::move(manager));
+      if (options.stats)
+        print_stats(session.get_internal(), options.threads > 1 ? session.get_interpreter() : nullptr);
+    }
+    if (!watcher.wait()) {
+      diag.create_diag(err_watch_file) << options.input << diag_build_finish;
+      return;
+    }
+  }
+}
+
+void run_server(diag_engine& diag, const driver_options& options) {
+  render_server server(options.serve_path, options.workers,
+                       std::chrono::milliseconds(options.timeout));
+  if (!server.start()) {
+    diag.create_diag(err_serve_socket) << options.serve_path << diag_build_finish;
+    return;
+  }
+  server.wait();
+}
+
+void run_sweep(diag_engine& diag, const driver_options& options) {
+  file_manager program, variants;
+  if (program.from_file(options.input)) {
+    diag.create_diag(err_open_file) << options.input << diag_build_finish;
+    return;
+  }
+  if (variants.from_file(options.sweep_path)) {
+    diag.create_diag(err_open_file) << options.sweep_path << diag_build_finish;
+    return;
+  }
+  parameter_sweep sweep(diag, program, variants);
+  if (options.jit)
+    sweep.enable_jit();
+  std::vector<parameter_sweep::result> results = sweep.run(options.threads);
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    std::cout << results[i].output;
+    std::cerr << results[i].diagnostics;
+    if (!results[i].written)
+      diag.create_diag(err_write_file) << sweep.get_variants()[i].image_path << diag_build_finish;
+  }
+}
+
+void emit_cpp(diag_engine& diag, sema& action, const file_manager& source,
+              const std::vector<stmt_result_t>& ast, const char* path) {
+  cpp_emitter emitter(action);
+  std::optional<std::string> code = emitter.emit(ast, source);
+  if (!code)
+    return;
+  std::ofstream output(path);
+  if (!(output << *code))
+    diag.create_diag(err_write_file) << path << diag_build_finish;
+}
+} // namespace
+
 int main(int argc, char* argv[]) {
   diag_engine diag;
   cmd_diag_consumer consumer;
   diag.set_consumer(&consumer);
-  if (argc == 1) {
-    diag.create_diag(drawing::err_no_input_file) << diag_build_finish;
+  driver_options options;
+  if (!parse_options(diag, argc, argv, options))
+    return 0;
+  if (options.stats)
+    counter_registry::enable();
+  if (options.replay_path) {
+    run_replay(diag, options);
+    return 0;
+  }
+  if (options.watch) {
+    run_watch(diag, options);
+    return 0;
+  }
+  if (options.serve_path) {
+    run_server(diag, options);
+    return 0;
+  }
+  if (options.sweep_path) {
+    run_sweep(diag, options);
     return 0;
   }
   file_manager manager;
-  auto file_open_result = manager.from_file(argv[1]);
+  auto file_open_result = manager.from_file(options.input);
   if (file_open_result) {
-    diag.create_diag(drawing::err_open_file) << argv[1] << diag_build_finish;
+    diag.create_diag(drawing::err_open_file) << options.input << diag_build_finish;
     return 0;
   }
   diag.set_file(&manager);
   symbol_table table;
   internal_impl internal;
   internal.export_all_symbols(table);
+  if (options.record_path)
+    internal.start_recording();
   sema action(diag, table);
   lexer l(&manager, diag);
   parser p(l);
   auto ast = p.parse_program();
+  if (options.emit_path) {
+    emit_cpp(diag, action, manager, ast, options.emit_path);
+    return 0;
+  }
   interpreter runner(action, internal);
+  if (options.jit)
+    runner.enable_jit();
+  runner.enable_parallel(options.threads);
   runner.run_stmts(std::move(ast));
+  if (options.record_path && !internal.get_display_list()->save(options.record_path))
+    diag.create_diag(err_write_file) << options.record_path << diag_build_finish;
+  if (options.stats)
+    print_stats(internal, options.threads > 1 ? &runner : nullptr);
   return 0;
 }
@@ -0,0 +1,114 @@
+#include <Interpret/Effects.h>
+#include <AST/StmtVisitor.h>
+#include <algorithm>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+class effect_collector : public stmt_visitor<effect_collector> {
+public:
+  explicit effect_collector(stmt_effects& result) : _result(result) { }
+
+  void visit_assignment_stmt(assignment_stmt* s) {
+    visit(s->get_assignment_rhs());
+    _add_write(s->get_assignment_lhs());
+  }
+
+  void visit_for_stmt(for_stmt* s) {
+    // Without a from clause, the loop starts from the current value.
+    if (s->has_from())
+      visit(s->get_from_expr());
+    else
+      visit(s->get_for_expr());
+    visit(s->get_to_expr());
+    if (s->has_step())
+      visit(s->get_step_expr());
+    _add_write(s->get_for_expr());
+    for (auto iter = s->body_begin(); iter != s->body_end(); ++iter) {
+      if (*iter)
+        visit(iter->get());
+    }
+  }
+
+  void visit_expr_stmt(expr_stmt* s) {
+    visit(s->get_expr());
+  }
+
+  void visit_binary_expr(binary_expr* e) {
+    visit(e->get_lhs());
+    visit(e->get_rhs());
+  }
+
+  void visit_unary_expr(unary_expr* e) {
+    visit(e->get_operand());
+  }
+
+  void visit_variable_expr(variable_expr* e) {
+    _result.add_read(e->get_name());
+  }
+
+  void visit_tuple_expr(tuple_expr* e) {
+    for (auto iter = e->elem_begin(); iter != e->elem_end(); ++iter)
+      visit(iter->get());
+  }
+
+  void visit_call_expr(call_expr* e) {
+    for (auto iter = e->param_begin(); iter != e->param_end(); ++iter)
+      visit(iter->get());
+    string_ref name = e->get_func_name();
+    if (name == "draw")
+      _result._draws = true;
+    else if (name == "print" || name == "save" || name == "emit_frame" || name == "clear")
+      _result._io = true;
+  }
+private:
+  stmt_effects& _result;
+
+  void _add_write(expr* e) {
+    if (e->get_stmt_kind() == stmt::variable_expr_type)
+      _result.add_write(static_cast<variable_expr*>(e)->get_name());
+  }
+};
+
+bool stmt_effects::reads(string_ref name) const {
+  return std::find(_reads.begin(), _reads.end(), name) != _reads.end();
+}
+
+bool stmt_effects::writes(string_ref name) const {
+  return std::find(_writes.begin(), _writes.end(), name) != _writes.end();
+}
+
+bool stmt_effects::depends_on(const stmt_effects& earlier) const {
+  return std::any_of(earlier._writes.begin(), earlier._writes.end(), [this](string_ref name) {
+    return reads(name) || (_draws && is_drawing_state(name));
+  });
+}
+
+bool stmt_effects::is_drawing_state(string_ref name) {
+  // `background_size`, `background_color` and `color_depth` are used
+  // when the canvas is created by the first point.
+  static constexpr const char* names[] = {
+    "origin", "rot", "scale", "background_size", "background_color", "color_depth",
+    "line_width", "line_color", "line_mode",
+  };
+  return std::any_of(std::begin(names), std::end(names), [name](const char* state) {
+    return name == state;
+  });
+}
+
+void stmt_effects::add(stmt* s) {
+  assert(s);
+  effect_collector collector(*this);
+  collector.visit(s);
+}
+
+void stmt_effects::add_read(string_ref name) {
+  if (!reads(name))
+    _reads.push_back(name);
+}
+
+void stmt_effects::add_write(string_ref name) {
+  if (!writes(name))
+    _writes.push_back(name);
+}
+
+INTERPRETER_NAMESPACE_END
@@ -0,0 +1,747 @@
+#include <Interpret/InternalSupport/Canvas.h>
+#include <Utils/Counters.h>
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+
+#ifdef DRAWING_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+// OpenCV
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+/**
+ * Counts the pixels of the canvas of @param{size} in the rectangle from
+ * @param{min} to @param{max}, which bounds the pixels a primitive may
+ * change.
+ */
+void count_pixels(cv::Size size, cv::Point min, cv::Point max) {
+  static counter& pixels = counter_registry::get("internal", "pixels_touched");
+  int width = std::min(max.x + 1, size.width) - std::max(min.x, 0);
+  int height = std::min(max.y + 1, size.height) - std::max(min.y, 0);
+  if (width > 0 && height > 0)
+    pixels.add(static_cast<std::uint64_t>(width) * static_cast<std::uint64_t>(height));
+}
+
+void count_bytes(std::uintmax_t bytes) {
+  static counter& encoded = counter_registry::get("internal", "bytes_encoded");
+  encoded.add(bytes);
+}
+
+void count_frame() {
+  static counter& frames = counter_registry::get("internal", "frames_emitted");
+  frames.add();
+}
+
+/**
+ * The base class of the encoders which accept the image row by row.
+ * The rows are given in BGR or BGRA order, as OpenCV does.
+ */
+class row_writer {
+public:
+  virtual ~row_writer() = default;
+  virtual bool begin(std::ostream& out, cv::Size size, int channels) = 0;
+  virtual bool write_row(std::ostream& out, const uchar* row) = 0;
+  virtual bool finish(std::ostream& out) = 0;
+};
+
+/**
+ * Writes binary PPM (P6) files, which have no alpha channel.
+ */
+class ppm_writer : public row_writer {
+public:
+  bool begin(std::ostream& out, cv::Size size, int channels) override {
+    out << "P6\n" << size.width << ' ' << size.height << "\n255\n";
+    _rgb.resize(3 * static_cast<std::size_t>(size.width));
+    _channels = static_cast<std::size_t>(channels);
+    return static_cast<bool>(out);
+  }
+
+  bool write_row(std::ostream& out, const uchar* row) override {
+    for (std::size_t i = 0; i < _rgb.size(); i += 3, row += _channels) {
+      _rgb[i] = row[2];
+      _rgb[i + 1] = row[1];
+      _rgb[i + 2] = row[0];
+    }
+    out.write(reinterpret_cast<const char*>(_rgb.data()), static_cast<std::streamsize>(_rgb.size()));
+    return static_cast<bool>(out);
+  }
+
+  bool finish(std::ostream& out) override {
+    out.flush();
+    return static_cast<bool>(out);
+  }
+private:
+  std::vector<uchar> _rgb;
+  std::size_t _channels = 3;
+};
+
+#ifdef DRAWING_HAS_ZLIB
+/**
+ * Writes 8-bit RGB or RGBA PNG files. The compressed data is split
+ * into IDAT chunks whenever the output buffer is full.
+ */
+class png_writer : public row_writer {
+public:
+  ~png_writer() override {
+    if (_initialized)
+      deflateEnd(&_stream);
+  }
+
+  bool begin(std::ostream& out, cv::Size size, int channels) override {
+    static const uchar signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    out.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+    uchar header[13] = { };
+    _put_u32(header, static_cast<std::uint32_t>(size.width));
+    _put_u32(header + 4, static_cast<std::uint32_t>(size.height));
+    header[8] = 8;  // bit depth
+    header[9] = channels == 4 ? 6 : 2;  // color type: RGBA or RGB
+    _write_chunk(out, "IHDR", header, sizeof(header));
+    if (deflateInit(&_stream, 1) != Z_OK)
+      return false;
+    _initialized = true;
+    // every row starts with the filter type (0: None)
+    _channels = static_cast<std::size_t>(channels);
+    _row.resize(1 + _channels * static_cast<std::size_t>(size.width));
+    _buffer.resize(1 << 16);
+    return static_cast<bool>(out);
+  }
+
+  bool write_row(std::ostream& out, const uchar* row) override {
+    _row[0] = 0;
+    for (std::size_t i = 1; i < _row.size(); i += _channels, row += _channels) {
+      _row[i] = row[2];
+      _row[i + 1] = row[1];
+      _row[i + 2] = row[0];
+      if (_channels == 4)
+        _row[i + 3] = row[3];
+    }
+    _stream.next_in = _row.data();
+    _stream.avail_in = static_cast<uInt>(_row.size());
+    return _deflate(out, Z_NO_FLUSH);
+  }
+
+  bool finish(std::ostream& out) override {
+    _stream.next_in = nullptr;
+    _stream.avail_in = 0;
+    if (!_deflate(out, Z_FINISH))
+      return false;
+    _write_chunk(out, "IEND", nullptr, 0);
+    out.flush();
+    return static_cast<bool>(out);
+  }
+private:
+  z_stream _stream = { };
+  bool _initialized = false;
+  std::size_t _channels = 3;
+  std::vector<uchar> _row;
+  std::vector<uchar> _buffer;
+
+  static void _put_u32(uchar* dst, std::uint32_t value) {
+    dst[0] = static_cast<uchar>(value >> 24);
+    dst[1] = static_cast<uchar>(value >> 16);
+    dst[2] = static_cast<uchar>(value >> 8);
+    dst[3] = static_cast<uchar>(value);
+  }
+
+  static void _write_chunk(std::ostream& out, const char* type, const uchar* data, std::size_t size) {
+    uchar u32[4];
+    _put_u32(u32, static_cast<std::uint32_t>(size));
+    out.write(reinterpret_cast<const char*>(u32), 4);
+    out.write(type, 4);
+    uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+    if (size) {
+      out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+      crc = crc32(crc, data, static_cast<uInt>(size));
+    }
+    _put_u32(u32, static_cast<std::uint32_t>(crc));
+    out.write(reinterpret_cast<const char*>(u32), 4);
+  }
+
+  bool _deflate(std::ostream& out, int flush) {
+    int result;
+    do {
+      _stream.next_out = _buffer.data();
+      _stream.avail_out = static_cast<uInt>(_buffer.size());
+      result = deflate(&_stream, flush);
+      if (result == Z_STREAM_ERROR)
+        return false;
+      std::size_t produced = _buffer.size() - _stream.avail_out;
+      if (produced)
+        _write_chunk(out, "IDAT", _buffer.data(), produced);
+    } while (_stream.avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+    return static_cast<bool>(out);
+  }
+};
+#endif
+
+/**
+ * Returns the encoder which can write the file band by band,
+ * or nullptr if the format is not supported.
+ */
+std::unique_ptr<row_writer> get_row_writer(const std::string& path) {
+  std::string::size_type dot = path.find_last_of('.');
+  if (dot == std::string::npos)
+    return nullptr;
+  std::string ext = path.substr(dot + 1);
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  if (ext == "ppm" || ext == "pnm")
+    return std::make_unique<ppm_writer>();
+#ifdef DRAWING_HAS_ZLIB
+  if (ext == "png")
+    return std::make_unique<png_writer>();
+#endif
+  return nullptr;
+}
+
+/**
+ * Writes @param{image} with @param{writer} band by band, so the whole
+ * image never exists in the memory.
+ */
+bool write_bands(const canvas& image, row_writer& writer, std::ostream& out, bool flip) {
+  cv::Size size = image.size();
+  if (!writer.begin(out, size, image.channels()))
+    return false;
+  int bands = (size.height + canvas::tile_size - 1) / canvas::tile_size;
+  for (int band = 0; band < bands; ++band) {
+    int tile_y = flip ? bands - 1 - band : band;
+    int begin = tile_y * canvas::tile_size, end = std::min(begin + canvas::tile_size, size.height);
+    cv::Mat rows = image.render_rows(begin, end);
+    for (int i = 0; i < rows.rows; ++i) {
+      if (!writer.write_row(out, rows.ptr(flip ? rows.rows - 1 - i : i)))
+        return false;
+    }
+  }
+  return writer.finish(out);
+}
+
+/**
+ * Returns @param{x} / 255 rounded to the nearest integer, where
+ * @param{x} is a product of two 8-bit values.
+ */
+inline int div255(int x) {
+  return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+#if CV_SIMD128
+inline cv::v_uint16x8 v_div255(const cv::v_uint16x8& x) {
+  cv::v_uint16x8 t = x + cv::v_setall_u16(128);
+  return (t + (t >> 8)) >> 8;
+}
+#endif
+
+/**
+ * Composites the color @param{src} (premultiplied BGRA in [0, 1]) over
+ * @param{count} 8-bit pixels of @param{Channels} channels at @param{dst}
+ * by source-over, where the color covers the pixel x by
+ * @param{coverage}[x] / 255. The BGR pixels are opaque.
+ *
+ * The pixels are blended in 8-bit fixed point, 16 pixels at a time: the
+ * channels are split into planes, so that each lane of a plane meets the
+ * coverage of its own pixel.
+ */
+template<int Channels>
+void composite_row(uchar* dst, const uchar* coverage, int count, const float* src) {
+  int color[Channels];
+  for (int c = 0; c < Channels; ++c)
+    color[c] = static_cast<int>(std::lround(src[c] * 255));
+  int alpha = static_cast<int>(std::lround(src[3] * 255));
+  int x = 0;
+#if CV_SIMD128
+  cv::v_uint16x8 alpha_vec = cv::v_setall_u16(static_cast<ushort>(alpha));
+  cv::v_uint16x8 full = cv::v_setall_u16(255);
+  for (; x + 16 <= count; x += 16) {
+    cv::v_uint16x8 k0, k1;
+    cv::v_expand(cv::v_load(coverage + x), k0, k1);
+    cv::v_uint16x8 keep0 = full - v_div255(alpha_vec * k0);
+    cv::v_uint16x8 keep1 = full - v_div255(alpha_vec * k1);
+    uchar* pixels = dst + Channels * x;
+    cv::v_uint8x16 planes[4];
+    if constexpr (Channels == 4)
+      cv::v_load_deinterleave(pixels, planes[0], planes[1], planes[2], planes[3]);
+    else
+      cv::v_load_deinterleave(pixels, planes[0], planes[1], planes[2]);
+    for (int c = 0; c < Channels; ++c) {
+      cv::v_uint16x8 color_vec = cv::v_setall_u16(static_cast<ushort>(color[c]));
+      cv::v_uint16x8 p0, p1;
+      cv::v_expand(planes[c], p0, p1);
+      p0 = v_div255(color_vec * k0) + v_div255(p0 * keep0);
+      p1 = v_div255(color_vec * k1) + v_div255(p1 * keep1);
+      planes[c] = cv::v_pack(p0, p1);
+    }
+    if constexpr (Channels == 4)
+      cv::v_store_interleave(pixels, planes[0], planes[1], planes[2], planes[3]);
+    else
+      cv::v_store_interleave(pixels, planes[0], planes[1], planes[2]);
+  }
+#endif
+  for (; x < count; ++x) {
+    int k = coverage[x];
+    if (!k)
+      continue;
+    int keep = 255 - div255(alpha * k);
+    uchar* pixel = dst + Channels * x;
+    for (int c = 0; c < Channels; ++c)
+      pixel[c] = static_cast<uchar>(div255(color[c] * k) + div255(pixel[c] * keep));
+  }
+}
+
+/**
+ * Composites the color as above over floating-point BGRA pixels. Each
+ * pixel is blended as a vector of 4 floats.
+ */
+void composite_row(float* dst, const uchar* coverage, int count, const float* src) {
+#if CV_SIMD128
+  cv::v_float32x4 color = cv::v_load(src);
+  for (int x = 0; x < count; ++x) {
+    if (!coverage[x])
+      continue;
+    float k = coverage[x] * (1.f / 255);
+    cv::v_float32x4 pixel = cv::v_load(dst + 4 * x);
+    cv::v_store(dst + 4 * x, cv::v_muladd(color, cv::v_setall_f32(k),
+                                          pixel * cv::v_setall_f32(1 - src[3] * k)));
+  }
+#else
+  for (int x = 0; x < count; ++x, dst += 4) {
+    if (!coverage[x])
+      continue;
+    float k = coverage[x] * (1.f / 255);
+    float keep = 1 - src[3] * k;
+    for (int c = 0; c < 4; ++c)
+      dst[c] = src[c] * k + dst[c] * keep;
+  }
+#endif
+}
+
+int get_tile_type(canvas::pixel_format format) {
+  switch (format) {
+  case canvas::pixel_format::bgr:
+    return CV_8UC3;
+  case canvas::pixel_format::bgra:
+    return CV_8UC4;
+  case canvas::pixel_format::bgra_float:
+    return CV_32FC4;
+  }
+  return CV_8UC3;
+}
+} // namespace
+
+canvas::canvas(cv::Size size, cv::Scalar background, pixel_format format)
+    : _size(size), _format(format), _background(background),
+      _tile_cols((size.width + tile_size - 1) / tile_size),
+      _tile_rows((size.height + tile_size - 1) / tile_size),
+      _tiles(static_cast<std::size_t>(_tile_cols) * _tile_rows),
+      _tile_state(_tiles.size()),
+      _stamps(_tiles.size()) {
+  if (_format != pixel_format::bgr) {
+    // premultiplies the alpha
+    double alpha = background[3] / 255;
+    double scale = _format == pixel_format::bgra_float ? alpha / 255 : alpha;
+    for (int c = 0; c < 3; ++c)
+      _background.val[c] = background[c] * scale;
+    _background.val[3] = _format == pixel_format::bgra_float ? alpha : background[3];
+    if (_format == pixel_format::bgra) {
+      for (double& value : _background.val)
+        value = std::round(value);
+    }
+  }
+  cv::Mat pixel(cv::Size(1, 1), get_tile_type(_format));
+  pixel.setTo(_background);
+  _convert_pixels(pixel.ptr(0), _background_pixel, 1);
+}
+
+cv::Rect canvas::_get_tile_rect(int tile_x, int tile_y) const {
+  int x = tile_x * tile_size, y = tile_y * tile_size;
+  return cv::Rect(x, y, std::min(tile_size, _size.width - x), std::min(tile_size, _size.height - y));
+}
+
+cv::Mat& canvas::_touch_tile(int tile_x, int tile_y) {
+  std::size_t index = static_cast<std::size_t>(tile_y) * _tile_cols + tile_x;
+  _mark_dirty(index);
+  std::shared_ptr<cv::Mat>& tile = _tiles[index];
+  if (!tile) {
+    cv::Rect rect = _get_tile_rect(tile_x, tile_y);
+    tile = std::make_shared<cv::Mat>(cv::Size(rect.width, rect.height), get_tile_type(_format));
+    tile->setTo(_background);
+    _drawn_tiles.push_back(index);
+    if (!(_tile_state[index] & _touched_bit)) {
+      _tile_state[index] |= _touched_bit;
+      _touched_area += static_cast<std::uint64_t>(rect.width) * static_cast<std::uint64_t>(rect.height);
+    }
+  } else if (tile.use_count() > 1) {
+    // The tile is shared with a copy of the canvas.
+    tile = std::make_shared<cv::Mat>(tile->clone());
+  }
+  return *tile;
+}
+
+void canvas::_mark_dirty(std::size_t tile) {
+  if (_tile_state[tile] & _dirty_bit)
+    return;
+  _tile_state[tile] |= _dirty_bit;
+  _dirty_tiles.push_back(tile);
+}
+
+double canvas::touched_fraction() const {
+  if (empty())
+    return 0;
+  return static_cast<double>(_touched_area) /
+         (static_cast<double>(_size.width) * static_cast<double>(_size.height));
+}
+
+std::vector<std::size_t> canvas::take_dirty_tiles() {
+  std::vector<std::size_t> result;
+  if (_all_dirty) {
+    result.resize(_tiles.size());
+    for (std::size_t i = 0; i < result.size(); ++i)
+      result[i] = i;
+    _all_dirty = false;
+  } else {
+    result = _dirty_tiles;
+  }
+  for (std::size_t tile : _dirty_tiles)
+    _tile_state[tile] &= static_cast<std::uint8_t>(~_dirty_bit);
+  _dirty_tiles.clear();
+  return result;
+}
+
+void canvas::clear() {
+  for (std::size_t tile : _drawn_tiles) {
+    _tiles[tile].reset();
+    _mark_dirty(tile);
+  }
+  _drawn_tiles.clear();
+  // The stamps refer to the primitives which have been cleared.
+  clear_stamps();
+}
+
+cv::Rect canvas::_get_tile_range(cv::Point min, cv::Point max) const {
+  // floor division, since the coordinates may be negative
+  auto _tile_of = [](int v) { return v >= 0 ? v / tile_size : -((-v + tile_size - 1) / tile_size); };
+  int x0 = std::max(_tile_of(min.x), 0), x1 = std::min(_tile_of(max.x) + 1, _tile_cols);
+  int y0 = std::max(_tile_of(min.y), 0), y1 = std::min(_tile_of(max.y) + 1, _tile_rows);
+  if (x0 >= x1 || y0 >= y1)
+    return cv::Rect();
+  return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+template<class Draw>
+void canvas::_draw_on_tile(int tile_x, int tile_y, cv::Rect box, const cv::Scalar& color, Draw&& draw) {
+  cv::Mat& tile = _touch_tile(tile_x, tile_y);
+  if (_format == pixel_format::bgr && color[3] >= 255) {
+    // OpenCV blends the opaque color by the coverage itself.
+    draw(tile, color);
+    return;
+  }
+  cv::Mat& coverage_mask = _coverage.mask;
+  if (coverage_mask.empty())
+    coverage_mask = cv::Mat(cv::Size(tile_size, tile_size), CV_8UC1, cv::Scalar(0));
+  draw(coverage_mask, cv::Scalar(255));
+  cv::Rect rect = _get_tile_rect(tile_x, tile_y);
+  // the box in the tile, and the part of it in the canvas
+  int x0 = std::max(box.x - rect.x, 0), x1 = std::min(box.x + box.width - rect.x, tile_size);
+  int y0 = std::max(box.y - rect.y, 0), y1 = std::min(box.y + box.height - rect.y, tile_size);
+  if (x0 >= x1 || y0 >= y1)
+    return;
+  float alpha = static_cast<float>(color[3] / 255);
+  float src[4] = { static_cast<float>(color[0] / 255) * alpha, static_cast<float>(color[1] / 255) * alpha,
+                   static_cast<float>(color[2] / 255) * alpha, alpha };
+  int width = std::min(x1, rect.width) - x0;
+  for (int y = y0; y < y1; ++y) {
+    uchar* coverage = coverage_mask.ptr(y) + x0;
+    if (y < rect.height && width > 0) {
+      if (_format == pixel_format::bgra_float)
+        composite_row(tile.ptr<float>(y) + 4 * x0, coverage, width, src);
+      else if (_format == pixel_format::bgra)
+        composite_row<4>(tile.ptr(y) + 4 * x0, coverage, width, src);
+      else
+        composite_row<3>(tile.ptr(y) + 3 * x0, coverage, width, src);
+    }
+    std::memset(coverage, 0, static_cast<std::size_t>(x1 - x0));
+  }
+}
+
+void canvas::circle(cv::Point center, int radius, const cv::Scalar& color, int shift) {
+  // leave a margin for anti-aliasing
+  int r = (radius >> shift) + 2;
+  cv::Point c(center.x >> shift, center.y >> shift);
+  cv::Rect range = _get_tile_range(cv::Point(c.x - r, c.y - r), cv::Point(c.x + r, c.y + r));
+  if (counter_registry::is_enabled())
+    count_pixels(_size, cv::Point(c.x - r, c.y - r), cv::Point(c.x + r, c.y + r));
+  for (int ty = range.y; ty < range.y + range.height; ++ty) {
+    for (int tx = range.x; tx < range.x + range.width; ++tx) {
+      cv::Rect rect = _get_tile_rect(tx, ty);
+      cv::Point offset(rect.x << shift, rect.y << shift);
+      _draw_on_tile(tx, ty, cv::Rect(c.x - r, c.y - r, 2 * r + 1, 2 * r + 1), color,
+                    [&](cv::Mat& image, const cv::Scalar& value) {
+        cv::circle(image, center - offset, radius, value, cv::FILLED, cv::LINE_AA, shift);
+      });
+    }
+  }
+}
+
+void canvas::polylines(const std::vector<cv::Point>& points, const cv::Scalar& color,
+                       int thickness, int shift) {
+  if (points.size() < 2)
+    return;
+  // Every tile draws the runs of the adjacent segments which overlap
+  // it. A segment only draws the cap at its end except the first
+  // one of a run, so the joins are the same as drawing the whole
+  // polyline at once. All the runs of a tile are drawn at once as well,
+  // so a translucent polyline which leaves the tile and crosses itself
+  // when it comes back covers the crossing only once, as it does
+  // wherever else it crosses itself.
+  struct tile_runs_t {
+    std::vector<std::vector<cv::Point>> runs;
+    std::size_t last_segment = 0;
+  };
+  std::unordered_map<std::size_t, tile_runs_t> tiles;
+  int margin = thickness / 2 + 2;
+  for (std::size_t i = 1; i < points.size(); ++i) {
+    cv::Point a(points[i - 1].x >> shift, points[i - 1].y >> shift);
+    cv::Point b(points[i].x >> shift, points[i].y >> shift);
+    cv::Point min(std::min(a.x, b.x) - margin, std::min(a.y, b.y) - margin);
+    cv::Point max(std::max(a.x, b.x) + margin, std::max(a.y, b.y) + margin);
+    cv::Rect range = _get_tile_range(min, max);
+    if (counter_registry::is_enabled())
+      count_pixels(_size, min, max);
+    for (int ty = range.y; ty < range.y + range.height; ++ty) {
+      for (int tx = range.x; tx < range.x + range.width; ++tx) {
+        tile_runs_t& tile = tiles[static_cast<std::size_t>(ty) * _tile_cols + tx];
+        if (tile.runs.empty() || tile.last_segment + 1 != i)
+          tile.runs.push_back({ points[i - 1] });
+        tile.runs.back().push_back(points[i]);
+        tile.last_segment = i;
+      }
+    }
+  }
+  for (auto& [index, tile] : tiles) {
+    int tx = static_cast<int>(index % _tile_cols), ty = static_cast<int>(index / _tile_cols);
+    cv::Rect rect = _get_tile_rect(tx, ty);
+    cv::Point offset(rect.x << shift, rect.y << shift);
+    cv::Point min = tile.runs.front().front(), max = min;
+    for (auto& run : tile.runs) {
+      for (auto& p : run) {
+        min = cv::Point(std::min(min.x, p.x), std::min(min.y, p.y));
+        max = cv::Point(std::max(max.x, p.x), std::max(max.y, p.y));
+        p -= offset;
+      }
+    }
+    cv::Rect box((min.x >> shift) - margin, (min.y >> shift) - margin,
+                 (max.x >> shift) - (min.x >> shift) + 2 * margin + 1,
+                 (max.y >> shift) - (min.y >> shift) + 2 * margin + 1);
+    _draw_on_tile(tx, ty, box, color, [&](cv::Mat& image, const cv::Scalar& value) {
+      cv::polylines(image, tile.runs, /* isClosed = */false, value, thickness, cv::LINE_AA, shift);
+    });
+  }
+}
+
+bool canvas::stamp(cv::Point p) {
+  assert(contains(p));
+  std::size_t tile = static_cast<std::size_t>(p.y / tile_size) * _tile_cols + p.x / tile_size;
+  std::vector<std::uint64_t>& bits = _stamps[tile];
+  if (bits.empty()) {
+    bits.resize(tile_size * tile_size / 64);
+    _stamped_tiles.push_back(tile);
+  }
+  std::size_t index = static_cast<std::size_t>(p.y % tile_size) * tile_size + p.x % tile_size;
+  std::uint64_t mask = std::uint64_t(1) << (index % 64);
+  if (bits[index / 64] & mask)
+    return false;
+  bits[index / 64] |= mask;
+  return true;
+}
+
+void canvas::clear_stamps() {
+  for (std::size_t tile : _stamped_tiles)
+    _stamps[tile].clear();
+  _stamped_tiles.clear();
+}
+
+void canvas::_convert_pixels(const uchar* src, uchar* dst, int count) const {
+  switch (_format) {
+  case pixel_format::bgr:
+    std::memcpy(dst, src, 3 * static_cast<std::size_t>(count));
+    break;
+  case pixel_format::bgra:
+    for (int x = 0; x < count; ++x, src += 4, dst += 4) {
+      int alpha = src[3];
+      for (int c = 0; c < 3; ++c)
+        dst[c] = alpha ? static_cast<uchar>(std::min(255, (src[c] * 255 + alpha / 2) / alpha)) : 0;
+      dst[3] = static_cast<uchar>(alpha);
+    }
+    break;
+  case pixel_format::bgra_float: {
+    const auto* pixels = reinterpret_cast<const float*>(src);
+    for (int x = 0; x < count; ++x, pixels += 4, dst += 4) {
+      float alpha = std::clamp(pixels[3], 0.f, 1.f);
+      for (int c = 0; c < 3; ++c) {
+        float value = alpha > 0 ? pixels[c] / alpha * 255 + 0.5f : 0;
+        dst[c] = static_cast<uchar>(std::clamp(value, 0.f, 255.f));
+      }
+      dst[3] = static_cast<uchar>(alpha * 255 + 0.5f);
+    }
+    break;
+  }
+  }
+}
+
+void canvas::_copy_row(int y, uchar* row, const uchar* background) const {
+  int tile_y = y / tile_size;
+  std::size_t channels = static_cast<std::size_t>(this->channels());
+  for (int tile_x = 0; tile_x < _tile_cols; ++tile_x) {
+    const auto& tile = _tiles[static_cast<std::size_t>(tile_y) * _tile_cols + tile_x];
+    cv::Rect rect = _get_tile_rect(tile_x, tile_y);
+    std::size_t offset = channels * static_cast<std::size_t>(rect.x);
+    if (!tile)
+      std::memcpy(row + offset, background + offset, channels * static_cast<std::size_t>(rect.width));
+    else
+      _convert_pixels(tile->ptr(y - rect.y), row + offset, rect.width);
+  }
+}
+
+void canvas::_copy_tile_rgb(std::size_t tile, uchar* image, bool flip) const {
+  const auto& mat = _tiles[tile];
+  cv::Rect rect = _get_tile_rect(static_cast<int>(tile % _tile_cols), static_cast<int>(tile / _tile_cols));
+  int channels = this->channels();
+  std::vector<uchar> pixels;
+  if (mat && _format != pixel_format::bgr)
+    pixels.resize(4 * static_cast<std::size_t>(rect.width));
+  std::size_t stride = 3 * static_cast<std::size_t>(_size.width);
+  for (int y = rect.y; y < rect.y + rect.height; ++y) {
+    uchar* dst = image + stride * static_cast<std::size_t>(flip ? _size.height - 1 - y : y) +
+                 3 * static_cast<std::size_t>(rect.x);
+    if (!mat) {
+      for (int x = 0; x < rect.width; ++x, dst += 3) {
+        dst[0] = _background_pixel[2];
+        dst[1] = _background_pixel[1];
+        dst[2] = _background_pixel[0];
+      }
+      continue;
+    }
+    const uchar* src = mat->ptr(y - rect.y);
+    if (!pixels.empty()) {
+      _convert_pixels(src, pixels.data(), rect.width);
+      src = pixels.data();
+    }
+    // The alpha is dropped.
+    for (int x = 0; x < rect.width; ++x, src += channels, dst += 3) {
+      dst[0] = src[2];
+      dst[1] = src[1];
+      dst[2] = src[0];
+    }
+  }
+}
+
+cv::Mat canvas::render_rows(int begin, int end) const {
+  assert(0 <= begin && begin <= end && end <= _size.height);
+  std::size_t channels = static_cast<std::size_t>(this->channels());
+  std::vector<uchar> background(channels * static_cast<std::size_t>(_size.width));
+  for (std::size_t i = 0; i < background.size(); i += channels)
+    std::memcpy(&background[i], _background_pixel, channels);
+  cv::Mat result(cv::Size(_size.width, end - begin), channels == 4 ? CV_8UC4 : CV_8UC3);
+  for (int y = begin; y < end; ++y)
+    _copy_row(y, result.ptr(y - begin), background.data());
+  return result;
+}
+
+bool canvas::write(const std::string& path, bool flip) const {
+  std::unique_ptr<row_writer> writer = get_row_writer(path);
+  if (!writer) {
+    // The encoder needs the whole image.
+    cv::Mat image = render_rows(0, _size.height);
+    if (flip)
+      cv::flip(image, image, 0);
+    if (!cv::imwrite(path, image))
+      return false;
+    if (counter_registry::is_enabled()) {
+      std::error_code ec;
+      std::uintmax_t size = std::filesystem::file_size(path, ec);
+      if (!ec)
+        count_bytes(size);
+    }
+    return true;
+  }
+  std::ofstream out(path, std::ios::binary);
+  if (!out || !write_bands(*this, *writer, out, flip))
+    return false;
+  if (counter_registry::is_enabled())
+    count_bytes(static_cast<std::uintmax_t>(out.tellp()));
+  return true;
+}
+
+bool canvas::encode(const std::string& path, std::string& result, bool flip) const {
+  std::unique_ptr<row_writer> writer = get_row_writer(path);
+  if (!writer) {
+    std::string::size_type dot = path.find_last_of('.');
+    if (dot == std::string::npos)
+      return false;
+    cv::Mat image = render_rows(0, _size.height);
+    if (flip)
+      cv::flip(image, image, 0);
+    std::vector<uchar> buf;
+    if (!cv::imencode(path.substr(dot), image, buf))
+      return false;
+    result.assign(buf.begin(), buf.end());
+  } else {
+    std::ostringstream out;
+    if (!write_bands(*this, *writer, out, flip))
+      return false;
+    result = out.str();
+  }
+  if (counter_registry::is_enabled())
+    count_bytes(result.size());
+  return true;
+}
+
+bool canvas::write_frame(std::ostream& out, bool flip) const {
+  ppm_writer writer;
+  if (!write_bands(*this, writer, out, flip))
+    return false;
+  if (counter_registry::is_enabled())
+    count_frame();
+  return true;
+}
+
+bool frame_encoder::write(canvas& image, std::ostream& out, bool flip) {
+  std::vector<std::size_t> dirty = image.take_dirty_tiles();
+  if (_frame.empty() || _size != image.size() || _flip != flip) {
+    std::string header = "P6\n" + std::to_string(image.size().width) + ' ' +
+                         std::to_string(image.size().height) + "\n255\n";
+    _size = image.size();
+    _flip = flip;
+    _header_size = header.size();
+    _frame.assign(header.begin(), header.end());
+    _frame.resize(_header_size + 3 * static_cast<std::size_t>(_size.width) * _size.height);
+    dirty.resize(image._tiles.size());
+    for (std::size_t i = 0; i < dirty.size(); ++i)
+      dirty[i] = i;
+  }
+  for (std::size_t tile : dirty)
+    image._copy_tile_rgb(tile, _frame.data() + _header_size, flip);
+  out.write(reinterpret_cast<const char*>(_frame.data()), static_cast<std::streamsize>(_frame.size()));
+  if (!out)
+    return false;
+  if (counter_registry::is_enabled()) {
+    static counter& tiles = counter_registry::get("internal", "tiles_encoded");
+    tiles.add(dirty.size());
+    count_frame();
+  }
+  return true;
+}
+
+INTERPRETER_NAMESPACE_END
@@ -0,0 +1,68 @@
+#include <Interpret/InternalSupport/DisplayList.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+/**
+ * The header of the display list files. The last byte is the version
+ * of the format, which must be changed whenever the format changes.
+ */
+constexpr char file_magic[8] = { 'D', 'R', 'A', 'W', 'L', 'I', 'S', 2 };
+} // namespace
+
+void display_list::record_canvas(cv::Size size, const std::array<INTEGER_T, 4>& color,
+                                 canvas::pixel_format format) {
+  _put(_op::canvas);
+  _put(static_cast<std::int32_t>(size.width));
+  _put(static_cast<std::int32_t>(size.height));
+  _put(color);
+  _put(format);
+}
+
+void display_list::record_state(const draw_state& state) {
+  if (_last_state && *_last_state == state)
+    return;
+  _put(_op::state);
+  // Clear the padding of the structure, so that the same states are
+  // always saved as the same bytes.
+  draw_state copy;
+  std::memset(&copy, 0, sizeof(copy));
+  copy.origin = state.origin;
+  copy.scale = state.scale;
+  copy.rot = state.rot;
+  copy.line_width = state.line_width;
+  copy.line_color = state.line_color;
+  copy.line_mode = state.line_mode;
+  _put(copy);
+  _last_state = state;
+}
+
+void display_list::record_point(cv::Point2d p, std::size_t site) {
+  _put(_op::point);
+  _put(static_cast<std::uint32_t>(site));
+  _put(p.x);
+  _put(p.y);
+}
+
+bool display_list::save(const std::string& path) const {
+  std::ofstream out(path, std::ios::binary);
+  out.write(file_magic, sizeof(file_magic));
+  out.write(reinterpret_cast<const char*>(_buffer.data()), static_cast<std::streamsize>(_buffer.size()));
+  return static_cast<bool>(out);
+}
+
+std::optional<display_list> display_list::load(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  char magic[sizeof(file_magic)];
+  if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), file_magic))
+    return std::nullopt;
+  display_list result;
+  result._buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return result;
+}
+
+INTERPRETER_NAMESPACE_END
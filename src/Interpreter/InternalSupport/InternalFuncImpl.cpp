@@ -1,45 +1,41 @@
 #include <Interpret/InternalSupport/InternalImpl.h>
 #include <Sema/IdentifierInfo.h>
 #include <iostream>
-#include <random>
 #include <algorithm>
 
-// opencv
-#include <opencv2/imgcodecs.hpp>
-
 INTERPRETER_NAMESPACE_BEGIN
 
 VOID_T
 internal_impl::_internal_print_integer(INTEGER_T arg1) const {
-  std::cout << "print: " << arg1 << '\n';
+  *_output << "print: " << arg1 << '\n';
 }
 
 VOID_T
 internal_impl::_internal_print_double(FLOAT_POINT_T arg1) const {
-  std::cout << "print: " << arg1 << '\n';
+  *_output << "print: " << arg1 << '\n';
 }
 
 VOID_T
 internal_impl::_internal_print_string(STRING_T arg1) const {
-  std::cout << "print: " << arg1 << '\n';
+  *_output << "print: " << arg1 << '\n';
 }
 
 VOID_T
 internal_impl::_internal_print_integer_tuple(std::vector<INTEGER_T> arg1) const {
-  std::cout << "print: (";
+  *_output << "print: (";
   for (std::size_t i = 0; i < arg1.size(); ++i) {
-    std::cout << (i ? ", " : "") << arg1[i];
+    *_output << (i ? ", " : "") << arg1[i];
   }
-  std::cout << ")\n";
+  *_output << ")\n";
 }
 
 VOID_T
 internal_impl::_internal_print_float_tuple(std::vector<FLOAT_POINT_T> arg1) const {
-  std::cout << "print: (";
+  *_output << "print: (";
   for (std::size_t i = 0; i < arg1.size(); ++i) {
-    std::cout << (i ? ", " : "") << arg1[i];
+    *_output << (i ? ", " : "") << arg1[i];
   }
-  std::cout << ")\n";
+  *_output << ")\n";
 }
 
 std::vector<INTEGER_T>
@@ -82,12 +78,12 @@ internal_impl::_internal_abs_integer(DIAG d, INTEGER_T arg1) const {
     d.success = false;
     return 0;
   }
-  return -arg1;
+  return arg1 < 0 ? -arg1 : arg1;
 }
 
 FLOAT_POINT_T
 internal_impl::_internal_abs_float(FLOAT_POINT_T arg1) const {
-  return -arg1;
+  return std::abs(arg1);
 }
 
 FLOAT_POINT_T
@@ -122,38 +118,119 @@ internal_impl::_internal_ln_float(DIAG d, FLOAT_POINT_T arg1) const {
   return result;
 }
 
+internal_impl::native_math_func_t
+internal_impl::get_native_math_function(string_ref name) {
+  if (name == "abs")
+    return [](FLOAT_POINT_T x) -> FLOAT_POINT_T { return std::abs(x); };
+  if (name == "cos")
+    return [](FLOAT_POINT_T x) -> FLOAT_POINT_T { return std::cos(x); };
+  if (name == "sin")
+    return [](FLOAT_POINT_T x) -> FLOAT_POINT_T { return std::sin(x); };
+  if (name == "tan")
+    return [](FLOAT_POINT_T x) -> FLOAT_POINT_T { return std::tan(x); };
+  if (name == "ln")
+    return [](FLOAT_POINT_T x) -> FLOAT_POINT_T { return std::log(x); };
+  return nullptr;
+}
 
 INTEGER_T
-internal_impl::_internal_rand_integer(INTEGER_T arg1, INTEGER_T arg2) const {
-  std::random_device r;
-  std::default_random_engine e(r());
-  std::uniform_int_distribution<INTEGER_T> uniform(arg1, arg2);
-  return uniform(e);
+internal_impl::_internal_rand_integer(INTEGER_T arg1, INTEGER_T arg2) {
+  return _random.next_integer(arg1, arg2);
+}
+
+FLOAT_POINT_T
+internal_impl::_internal_rand_float(FLOAT_POINT_T arg1, FLOAT_POINT_T arg2) {
+  return arg1 + (arg2 - arg1) * _random.next_uniform();
+}
+
+FLOAT_POINT_T
+internal_impl::_internal_rand_normal(FLOAT_POINT_T arg1, FLOAT_POINT_T arg2) {
+  return arg1 + arg2 * _random.next_normal();
+}
+
+std::vector<FLOAT_POINT_T>
+internal_impl::_internal_rand_floats(DIAG d, INTEGER_T arg1) {
+  if (arg1 < 0 || arg1 > max_random_count) {
+    d.engine.create_diag(err_param_value, d.param_loc[0], d.param_loc[1])
+        << arg1 << "rand_floats" << diag_build_finish;
+    d.success = false;
+    return {};
+  }
+  std::vector<FLOAT_POINT_T> result(static_cast<std::size_t>(arg1));
+  _random.next_uniforms(result.data(), result.size());
+  return result;
+}
+
+std::vector<FLOAT_POINT_T>
+internal_impl::_internal_rand_normals(DIAG d, INTEGER_T arg1) {
+  if (arg1 < 0 || arg1 > max_random_count) {
+    d.engine.create_diag(err_param_value, d.param_loc[0], d.param_loc[1])
+        << arg1 << "rand_normals" << diag_build_finish;
+    d.success = false;
+    return {};
+  }
+  std::vector<FLOAT_POINT_T> result(static_cast<std::size_t>(arg1));
+  _random.next_normals(result.data(), result.size());
+  return result;
 }
 
 VOID_T
 internal_impl::_internal_draw_xy(DIAG d, FLOAT_POINT_T arg1, FLOAT_POINT_T arg2) {
-  _draw_point(cv::Point2f(arg1, arg2));
+  // The location of the first argument identifies the call.
+  _draw_point(cv::Point2d(arg1, arg2), d.param_loc[0]);
 }
 
 VOID_T
 internal_impl::_internal_overload_integer(INTEGER_T arg1, INTEGER_T arg2) const {
-  std::cout << "call overload function for integer\n";
+  *_output << "call overload function for integer\n";
 }
 
 VOID_T
 internal_impl::_internal_overload_float(FLOAT_POINT_T arg1, FLOAT_POINT_T arg2) const {
-  std::cout << "call overload function for float_point\n";
+  *_output << "call overload function for float_point\n";
 }
 
 VOID_T
 internal_impl::_internal_save_img(STRING_T path) {
-  if (!_have_drawn) {
-    _create_map();
+  _finish_picture();
+  if (_saved_image)
+    _draw_map.encode(path, *_saved_image, /* flip = */true);
+  else
+    _draw_map.write(path, /* flip = */true);
+}
+
+VOID_T
+internal_impl::_internal_emit_frame_stdout(DIAG d) {
+  if (!_emit_frame(*_output)) {
+    d.engine.create_diag(err_emit_frame) << "stdout" << diag_build_finish;
+    d.success = false;
   }
-  cv::Mat dst;
-  cv::flip(_draw_map, dst, 0);
-  cv::imwrite(path, dst);
+}
+
+VOID_T
+internal_impl::_internal_emit_frame(DIAG d, STRING_T path) {
+  // The captured frames never go to the files.
+  if (_saved_image) {
+    _internal_emit_frame_stdout(d);
+    return;
+  }
+  if (!_frame_file || _frame_path != path) {
+    _frame_file = std::make_unique<std::ofstream>(path, std::ios::binary);
+    _frame_path = std::move(path);
+  }
+  if (!*_frame_file || !_emit_frame(*_frame_file)) {
+    d.engine.create_diag(err_emit_frame, d.param_loc[0], d.param_loc[1])
+      << _frame_path << diag_build_finish;
+    d.success = false;
+    _frame_file.reset();
+  }
+}
+
+VOID_T
+internal_impl::_internal_clear() {
+  if (_display_list)
+    _display_list->record_clear();
+  _clear_map();
 }
 
 INTERPRETER_NAMESPACE_END
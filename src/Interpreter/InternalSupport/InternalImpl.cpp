@@ -1,10 +1,9 @@
 #include <Interpret/InternalSupport/InternalImpl.h>
 #include <Sema/IdentifierInfo.h>
+#include <Utils/Counters.h>
+#include <algorithm>
 #include <cmath>
 
-// OpenCV
-#include <opencv2/imgproc.hpp>
-
 INTERPRETER_NAMESPACE_BEGIN
 
 void internal_impl::export_all_symbols(symbol_table& table) {
@@ -26,6 +25,66 @@ void internal_impl::export_all_symbols(symbol_table& table) {
 #include "Interpret/InternalSupport/Predefined.h"
 }
 
+bool internal_impl::is_predefined_variable(string_ref name) {
+#define PREDEFINED_VARIABLE(NAME, TYPE, VALUE) \
+  if (name == #NAME)                           \
+    return true;
+#define PREDEFINED_VARIABLE_WITH_FILTER(NAME, TYPE, VALUE, VALUE_FILTER) \
+  if (name == #NAME)                                                     \
+    return true;
+#define PREDEFINED_CONSTANT(NAME, TYPE, VALUE) \
+  if (name == #NAME)                           \
+    return true;
+#include "Interpret/InternalSupport/Predefined.h"
+  return false;
+}
+
+struct internal_impl::snapshot {
+#define PREDEFINED_VARIABLE_WITH_FILTER(NAME, TYPE, VALUE, FILTER) TYPE _##NAME;
+#define PREDEFINED_VARIABLE(NAME, TYPE, VALUE) TYPE _##NAME;
+#include "Interpret/InternalSupport/Predefined.h"
+  bool _have_drawn;
+  philox_random _random;
+  canvas _draw_map;
+  cv::Point2d _resolution;
+  FLOAT_POINT_T _line_scale;
+  render_stats _render_stats;
+  int _stamp_radius;
+  cv::Scalar _stamp_color;
+  std::size_t _stroke_depth;
+  std::vector<_stroke_t> _strokes;
+  std::unordered_map<std::size_t, std::size_t> _stroke_index;
+};
+
+std::shared_ptr<const internal_impl::snapshot> internal_impl::take_snapshot() const {
+  return std::make_shared<const snapshot>(snapshot{
+#define PREDEFINED_VARIABLE_WITH_FILTER(NAME, TYPE, VALUE, FILTER) _##NAME,
+#define PREDEFINED_VARIABLE(NAME, TYPE, VALUE) _##NAME,
+#include "Interpret/InternalSupport/Predefined.h"
+    _have_drawn, _random, _draw_map, _resolution, _line_scale, _render_stats,
+    _stamp_radius, _stamp_color, _stroke_depth, _strokes, _stroke_index
+  });
+}
+
+void internal_impl::restore(const snapshot& s) {
+#define PREDEFINED_VARIABLE_WITH_FILTER(NAME, TYPE, VALUE, FILTER) _##NAME = s._##NAME;
+#define PREDEFINED_VARIABLE(NAME, TYPE, VALUE) _##NAME = s._##NAME;
+#include "Interpret/InternalSupport/Predefined.h"
+  _have_drawn = s._have_drawn;
+  _random = s._random;
+  _draw_map = s._draw_map;
+  // The last frame is not the one of the restored canvas.
+  _frame_encoder.reset();
+  _resolution = s._resolution;
+  _line_scale = s._line_scale;
+  _render_stats = s._render_stats;
+  _stamp_radius = s._stamp_radius;
+  _stamp_color = s._stamp_color;
+  _stroke_depth = s._stroke_depth;
+  _strokes = s._strokes;
+  _stroke_index = s._stroke_index;
+}
+
 bool internal_impl::_origin_value_filter(diag_info_pack& pack,
                                          const std::vector<INTEGER_T>& value) const {
   assert(pack.param_loc.size() == 2);
@@ -62,6 +121,12 @@ bool internal_impl::_background_size_value_filter(diag_info_pack& pack,
         << "background_size" << diag_build_finish;
     return false;
   }
+  if (_max_canvas_area &&
+      static_cast<std::uint64_t>(value[0]) > _max_canvas_area / static_cast<std::uint64_t>(value[1])) {
+    pack.engine.create_diag(err_canvas_area, pack.param_loc[1])
+        << std::to_string(_max_canvas_area) << diag_build_finish;
+    return false;
+  }
   if (_have_drawn) {
     pack.engine.create_diag(warn_set_after_drawing, pack.param_loc[0])
         << "background_size" << diag_build_finish;
@@ -102,6 +167,21 @@ bool internal_impl::_background_color_value_filter(diag_info_pack& pack,
   return true;
 }
 
+bool internal_impl::_color_depth_value_filter(diag_info_pack& pack,
+                                              const INTEGER_T& value) const {
+  if (value != 8 && value != 32) {
+    pack.engine.create_diag(err_color_depth, pack.param_loc[1])
+      << value << diag_build_finish;
+    return false;
+  }
+  if (_have_drawn) {
+    pack.engine.create_diag(warn_set_after_drawing, pack.param_loc[0])
+        << "color_depth" << diag_build_finish;
+    return false;
+  }
+  return true;
+}
+
 bool internal_impl::_line_color_value_filter(diag_info_pack& pack,
                                              const std::vector<INTEGER_T>& value) const {
   if (value.size() != 3 && value.size() != 4) {
@@ -119,10 +199,77 @@ bool internal_impl::_line_color_value_filter(diag_info_pack& pack,
   return true;
 }
 
+bool internal_impl::_line_mode_value_filter(diag_info_pack& pack,
+                                            const INTEGER_T& value) const {
+  if (value != 0 && value != 1) {
+    pack.engine.create_diag(err_line_mode, pack.param_loc[1])
+      << value << diag_build_finish;
+    return false;
+  }
+  return true;
+}
+
+bool internal_impl::_seed_value_filter(diag_info_pack&, const INTEGER_T& value) const {
+  // The same seed always makes the same numbers.
+  _random.reseed(static_cast<std::uint64_t>(static_cast<std::int64_t>(value)));
+  return true;
+}
+
 void internal_impl::_create_map() {
-  _draw_map = cv::Mat(cv::Size(_background_size[0], _background_size[1]), CV_8UC3);
-  _draw_map.setTo(cv::Scalar(_background_color[2], _background_color[1], _background_color[0]));
+  canvas::pixel_format format = canvas::pixel_format::bgr;
+  if (_color_depth == 32)
+    format = canvas::pixel_format::bgra_float;
+  else if (_background_color.size() == 4)
+    format = canvas::pixel_format::bgra;
+  INTEGER_T alpha = _background_color.size() == 4 ? _background_color[3] : 255;
+  _draw_map = canvas(cv::Size(_background_size[0], _background_size[1]),
+                     cv::Scalar(_background_color[2], _background_color[1], _background_color[0], alpha),
+                     format);
   _have_drawn = true;
+  if (_display_list) {
+    _display_list->record_canvas(_draw_map.size(),
+                                 { _background_color[0], _background_color[1], _background_color[2], alpha },
+                                 format);
+  }
+}
+
+void internal_impl::_clear_map() {
+  // The pending strokes would be drawn on the old picture.
+  _strokes.clear();
+  _stroke_index.clear();
+  _draw_map.clear();
+}
+
+bool internal_impl::_emit_frame(std::ostream& out) {
+  _finish_picture();
+  if (!_frame_encoder.write(_draw_map, out, /* flip = */true))
+    return false;
+  out.flush();
+  return static_cast<bool>(out);
+}
+
+void internal_impl::capture_output(std::ostream& output, std::string& image) {
+  _output = &output;
+  _saved_image = &image;
+}
+
+bool internal_impl::encode_picture(const std::string& path, std::string& result) {
+  _finish_picture();
+  return _draw_map.encode(path, result, /* flip = */true);
+}
+
+bool internal_impl::write_picture(const std::string& path) {
+  _finish_picture();
+  return _draw_map.write(path, /* flip = */true);
+}
+
+void internal_impl::_finish_picture() {
+  if (!_have_drawn) {
+    _create_map();
+  }
+  if (_display_list)
+    _display_list->record_flush();
+  _flush_all_strokes();
 }
 
 cv::Point2d internal_impl::_transform(cv::Point2d input) const {
@@ -137,20 +284,275 @@ cv::Point2d internal_impl::_transform(cv::Point2d input) const {
   x = x_temp;
   x += _origin[0];
   y += _origin[1];
+  x *= _resolution.x;
+  y *= _resolution.y;
   if (std::isinf(x) || x > std::numeric_limits<INTEGER_T>::max()) {
 
   }
   return {x, y};
 }
 
-void internal_impl::_draw_point(cv::Point2d p) {
-  if (_draw_map.rows == 0 || _draw_map.cols == 0)
+cv::Size internal_impl::_get_canvas_size() const {
+  if (_have_drawn)
+    return _draw_map.size();
+  return cv::Size(_background_size[0], _background_size[1]);
+}
+
+bool internal_impl::is_off_canvas(interval x, interval y) const {
+  // the same steps as _transform
+  interval_result_t scaled_x = x * interval(_scale[0]);
+  interval_result_t scaled_y = y * interval(_scale[1]);
+  if (!scaled_x || !scaled_y)
+    return false;
+  interval cos(std::cos(_rot)), sin(std::sin(_rot));
+  interval_result_t x_cos = *scaled_x * cos, y_sin = *scaled_y * sin;
+  interval_result_t y_cos = *scaled_y * cos, x_sin = *scaled_x * sin;
+  if (!x_cos || !y_sin || !y_cos || !x_sin)
+    return false;
+  interval_result_t real_x = *x_cos + *y_sin, real_y = *y_cos - *x_sin;
+  if (!real_x || !real_y)
+    return false;
+  real_x = *real_x + interval(_origin[0]);
+  real_y = *real_y + interval(_origin[1]);
+  if (!real_x || !real_y)
+    return false;
+  real_x = *real_x * interval(_resolution.x);
+  real_y = *real_y * interval(_resolution.y);
+  if (!real_x || !real_y)
+    return false;
+  // The points are rounded to the nearest pixel, so we
+  // leave a margin of one pixel around the canvas.
+  cv::Size size = _get_canvas_size();
+  return real_x->hi < -1 || real_x->lo > size.width + 1 ||
+         real_y->hi < -1 || real_y->lo > size.height + 1;
+}
+
+cv::Scalar internal_impl::_get_line_color() const {
+  return cv::Scalar(_line_color[2], _line_color[1], _line_color[0],
+                    _line_color.size() == 4 ? _line_color[3] : 255);
+}
+
+int internal_impl::_get_point_radius(INTEGER_T width) const {
+  return static_cast<int>(std::lround(width * _line_scale * (1 << _stroke_shift)));
+}
+
+int internal_impl::_get_line_thickness(INTEGER_T width) const {
+  // the diameter of the points
+  return std::max(1, static_cast<int>(std::lround(2 * width * _line_scale)));
+}
+
+void internal_impl::_draw_point(cv::Point2d p, std::size_t site) {
+  if (counter_registry::is_enabled()) {
+    static counter& points = counter_registry::get("internal", "points_drawn");
+    points.add();
+  }
+  if (_draw_map.empty())
     _create_map();
-  cv::Point real = _transform(p);
-  if (real.x >= _draw_map.cols || real.x < 0 || real.y >= _draw_map.rows || real.y < 0)
+  if (_display_list) {
+    _display_list->record_state(_get_draw_state());
+    _display_list->record_point(p, site);
+  }
+  cv::Point2d real = _transform(p);
+  cv::Point pixel = real;
+  if (!_draw_map.contains(pixel)) {
+    // Never connect a visible point with an invisible one, otherwise
+    // curves like tan(t) will get a vertical line at the asymptote.
+    if (auto iter = _stroke_index.find(site); iter != _stroke_index.end())
+      _flush_stroke(_strokes[iter->second]);
+    return;
+  }
+  ++_render_stats.visible_points;
+  if (!_line_mode || !_stroke_depth) {
+    // The points are drawn at the center of the pixels, so drawing the
+    // same opaque disc on a pixel again changes nothing but the
+    // anti-aliased edge. Each pixel is only drawn once until the line
+    // state changes. The translucent discs add up, so they are always
+    // drawn.
+    int radius = _get_point_radius(_line_width);
+    cv::Scalar color = _get_line_color();
+    if (radius != _stamp_radius || color != _stamp_color) {
+      _draw_map.clear_stamps();
+      _stamp_radius = radius;
+      _stamp_color = color;
+    }
+    if (color[3] >= 255 && !_draw_map.stamp(pixel))
+      return;
+    ++_render_stats.rasterized_points;
+    _draw_map.circle(cv::Point(pixel.x << _stroke_shift, pixel.y << _stroke_shift),
+                     radius, color, _stroke_shift);
+    return;
+  }
+  auto [entry, added] = _stroke_index.try_emplace(site, _strokes.size());
+  if (added)
+    _strokes.emplace_back();
+  _stroke_t& stroke = _strokes[entry->second];
+  cv::Scalar color = _get_line_color();
+  // The line state has changed since the stroke began.
+  if (!stroke.points.empty() && (stroke.color != color || stroke.width != _line_width))
+    _flush_stroke(stroke);
+  if (stroke.points.empty()) {
+    stroke.color = color;
+    stroke.width = _line_width;
+  }
+  constexpr double factor = 1 << _stroke_shift;
+  cv::Point vertex(static_cast<int>(std::lround(real.x * factor)),
+                   static_cast<int>(std::lround(real.y * factor)));
+  // drops the segments of zero length
+  if (!stroke.points.empty() && stroke.points.back() == vertex)
     return;
-  cv::circle(_draw_map, real, _line_width,
-             cv::Scalar(_line_color[2], _line_color[1], _line_color[0]), cv::FILLED, cv::LINE_AA);
+  ++_render_stats.rasterized_points;
+  stroke.points.push_back(vertex);
+}
+
+void internal_impl::_flush_stroke(_stroke_t& s) {
+  if (s.points.empty())
+    return;
+  // The stroke may cover the stamped pixels, which have to be drawn
+  // again by the following discs.
+  _draw_map.clear_stamps();
+  _stamp_radius = -1;
+  _stamp_color = cv::Scalar(-1, -1, -1, -1);
+  if (s.points.size() == 1) {
+    // A single point has nothing to connect with, so we draw it
+    // as a disc (which is what the point mode does).
+    _draw_map.circle(s.points.front(), _get_point_radius(s.width), s.color, _stroke_shift);
+  } else {
+    // The thick lines drawn by OpenCV have round caps, so every two
+    // adjacent segments are joined by a round join. The diameter of
+    // the line is the same as that of the discs in point mode.
+    _draw_map.polylines(s.points, s.color, _get_line_thickness(s.width), _stroke_shift);
+  }
+  s.points.clear();
+}
+
+void internal_impl::_flush_all_strokes() {
+  for (_stroke_t& stroke : _strokes)
+    _flush_stroke(stroke);
+  _strokes.clear();
+  _stroke_index.clear();
+}
+
+void internal_impl::begin_stroke() {
+  if (_display_list)
+    _display_list->record_begin_stroke();
+  _flush_all_strokes();
+  ++_stroke_depth;
+}
+
+void internal_impl::end_stroke() {
+  if (_display_list)
+    _display_list->record_end_stroke();
+  _flush_all_strokes();
+  assert(_stroke_depth);
+  --_stroke_depth;
+}
+
+void internal_impl::skip_points() {
+  if (_draw_map.empty())
+    _create_map();
+  if (_display_list)
+    _display_list->record_skip_points();
+  _flush_all_strokes();
+}
+
+void internal_impl::start_recording() {
+  if (!_display_list)
+    _display_list.emplace();
+}
+
+FLOAT_POINT_T internal_impl::render_stats::overdraw_ratio() const {
+  return rasterized_points ? static_cast<FLOAT_POINT_T>(visible_points) / rasterized_points : 0;
+}
+
+const display_list* internal_impl::get_display_list() const {
+  return _display_list ? &*_display_list : nullptr;
+}
+
+display_list::draw_state internal_impl::_get_draw_state() const {
+  return { { _origin[0], _origin[1] }, { _scale[0], _scale[1] }, _rot, _line_width,
+           { _line_color[0], _line_color[1], _line_color[2], _line_color.size() == 4 ? _line_color[3] : 255 },
+           _line_mode };
+}
+
+/**
+ * Feeds the records of a display list to @code{internal_impl}
+ * as if they were made by a program.
+ */
+struct internal_impl::_replayer {
+  internal_impl& impl;
+  cv::Size size;
+  bool valid = true;
+
+  void on_canvas(cv::Size original, const std::array<INTEGER_T, 4>& color, canvas::pixel_format format) {
+    if (original.width <= 0 || original.height <= 0 || !impl._draw_map.empty()) {
+      valid = false;
+      return;
+    }
+    impl._resolution = cv::Point2d(static_cast<FLOAT_POINT_T>(size.width) / original.width,
+                                   static_cast<FLOAT_POINT_T>(size.height) / original.height);
+    impl._line_scale = std::sqrt(impl._resolution.x * impl._resolution.y);
+    impl._background_size = { size.width, size.height };
+    impl._background_color = { color[0], color[1], color[2] };
+    if (format != canvas::pixel_format::bgr)
+      impl._background_color.push_back(color[3]);
+    impl._color_depth = format == canvas::pixel_format::bgra_float ? 32 : 8;
+    impl._create_map();
+  }
+
+  void on_state(const display_list::draw_state& state) {
+    impl._origin = { state.origin[0], state.origin[1] };
+    impl._scale = { state.scale[0], state.scale[1] };
+    impl._rot = state.rot;
+    impl._line_width = state.line_width;
+    impl._line_color = { state.line_color[0], state.line_color[1], state.line_color[2],
+                         state.line_color[3] };
+    impl._line_mode = state.line_mode;
+  }
+
+  void on_point(cv::Point2d p, std::size_t site) {
+    if (impl._draw_map.empty()) {
+      valid = false;
+      return;
+    }
+    impl._draw_point(p, site);
+  }
+
+  void on_begin_stroke() { impl.begin_stroke(); }
+
+  void on_end_stroke() {
+    if (!impl._stroke_depth) {
+      valid = false;
+      return;
+    }
+    impl.end_stroke();
+  }
+
+  void on_skip_points() {
+    if (impl._draw_map.empty()) {
+      valid = false;
+      return;
+    }
+    impl.skip_points();
+  }
+
+  void on_flush() { impl._flush_all_strokes(); }
+
+  void on_clear() { impl._clear_map(); }
+};
+
+bool internal_impl::replay(const display_list& list, cv::Size size, const std::string& path) {
+  assert(!_have_drawn && "replay on a used canvas");
+  _replayer replayer{ *this, size };
+  if (!list.replay(replayer) || !replayer.valid)
+    return false;
+  // the canvas may be never created if nothing is drawn
+  if (_draw_map.empty()) {
+    _background_size = { size.width, size.height };
+    _create_map();
+  }
+  _flush_all_strokes();
+  _draw_map.write(path, /* flip = */true);
+  return true;
 }
 
 INTERPRETER_NAMESPACE_END
@@ -0,0 +1,116 @@
+#include <Interpret/InternalSupport/Random.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+void philox_random::reseed(std::uint64_t seed) {
+  _key = { static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32) };
+  _position = 0;
+  _cached_block = ~std::uint64_t(0);
+}
+
+philox_random::block_t philox_random::philox(block_t counter, key_t key) {
+  constexpr std::uint32_t m0 = 0xD2511F53, m1 = 0xCD9E8D57;
+  constexpr std::uint32_t w0 = 0x9E3779B9, w1 = 0xBB67AE85;
+  for (int round = 0; round < 10; ++round) {
+    if (round != 0) {
+      key[0] += w0;
+      key[1] += w1;
+    }
+    std::uint64_t p0 = static_cast<std::uint64_t>(m0) * counter[0];
+    std::uint64_t p1 = static_cast<std::uint64_t>(m1) * counter[2];
+    counter = { static_cast<std::uint32_t>(p1 >> 32) ^ counter[1] ^ key[0],
+                static_cast<std::uint32_t>(p1),
+                static_cast<std::uint32_t>(p0 >> 32) ^ counter[3] ^ key[1],
+                static_cast<std::uint32_t>(p0) };
+  }
+  return counter;
+}
+
+philox_random::block_t philox_random::_block(std::uint64_t block) const {
+  return philox({ static_cast<std::uint32_t>(block), static_cast<std::uint32_t>(block >> 32), 0, 0 },
+                _key);
+}
+
+FLOAT_POINT_T philox_random::_to_uniform(std::uint32_t high, std::uint32_t low) {
+  std::uint64_t bits = (static_cast<std::uint64_t>(high) << 32) | low;
+  return static_cast<FLOAT_POINT_T>(bits >> 11) * 0x1.0p-53;
+}
+
+FLOAT_POINT_T philox_random::_to_normal(FLOAT_POINT_T u1, FLOAT_POINT_T u2) {
+  // 1 - u1 is in (0, 1], so the logarithm is finite.
+  constexpr FLOAT_POINT_T two_pi = 6.283185307179586476925;
+  return std::sqrt(-2 * std::log(1 - u1)) * std::cos(two_pi * u2);
+}
+
+FLOAT_POINT_T philox_random::uniform_at(std::uint64_t index) const {
+  block_t block = _block(index / 2);
+  std::size_t half = index % 2;
+  return _to_uniform(block[2 * half], block[2 * half + 1]);
+}
+
+void philox_random::fill_uniform(std::uint64_t index, FLOAT_POINT_T* out, std::size_t count) const {
+  for (std::size_t i = 0; i < count;) {
+    std::uint64_t position = index + i;
+    block_t block = _block(position / 2);
+    for (std::size_t half = position % 2; half < 2 && i < count; ++half, ++i)
+      out[i] = _to_uniform(block[2 * half], block[2 * half + 1]);
+  }
+}
+
+std::uint64_t philox_random::_next_bits() {
+  std::uint64_t block = _position / 2;
+  if (block != _cached_block) {
+    _cache = _block(block);
+    _cached_block = block;
+  }
+  std::size_t half = _position++ % 2;
+  return (static_cast<std::uint64_t>(_cache[2 * half]) << 32) | _cache[2 * half + 1];
+}
+
+FLOAT_POINT_T philox_random::next_uniform() {
+  std::uint64_t bits = _next_bits();
+  return _to_uniform(static_cast<std::uint32_t>(bits >> 32), static_cast<std::uint32_t>(bits));
+}
+
+FLOAT_POINT_T philox_random::next_normal() {
+  FLOAT_POINT_T u1 = next_uniform();
+  return _to_normal(u1, next_uniform());
+}
+
+INTEGER_T philox_random::next_integer(INTEGER_T low, INTEGER_T high) {
+  if (low > high)
+    std::swap(low, high);
+  auto span = static_cast<std::uint64_t>(static_cast<std::int64_t>(high) - low) + 1;
+  // Reject the numbers in the last incomplete range of the 64-bit
+  // numbers, so that every integer has the same probability.
+  constexpr std::uint64_t max = std::numeric_limits<std::uint64_t>::max();
+  std::uint64_t rest = (max % span + 1) % span;
+  while (true) {
+    std::uint64_t bits = _next_bits();
+    if (bits <= max - rest)
+      return static_cast<INTEGER_T>(low + static_cast<std::int64_t>(bits % span));
+  }
+}
+
+void philox_random::next_uniforms(FLOAT_POINT_T* out, std::size_t count) {
+  fill_uniform(_position, out, count);
+  _position += count;
+}
+
+void philox_random::next_normals(FLOAT_POINT_T* out, std::size_t count) {
+  // The uniform numbers are made in batches, so that each block of the
+  // generator is computed once.
+  constexpr std::size_t batch = 256;
+  FLOAT_POINT_T uniforms[2 * batch];
+  for (std::size_t i = 0; i < count; i += batch) {
+    std::size_t n = std::min(batch, count - i);
+    next_uniforms(uniforms, 2 * n);
+    for (std::size_t j = 0; j < n; ++j)
+      out[i + j] = _to_normal(uniforms[2 * j], uniforms[2 * j + 1]);
+  }
+}
+
+INTERPRETER_NAMESPACE_END
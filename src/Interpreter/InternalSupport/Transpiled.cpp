@@ -0,0 +1,137 @@
+#include <Interpret/InternalSupport/Transpiled.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+transpiled_runtime::transpiled_runtime(const char* source, std::size_t length,
+                                       const char* file_name) {
+  _source.from_buffer(source, length, file_name);
+  _diag.set_consumer(&_consumer);
+  _diag.set_file(&_source);
+}
+
+bool transpiled_runtime::parse_parameters(int argc, char* argv[],
+                                          std::initializer_list<const char*> names) {
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--help") == 0) {
+      std::cout << "usage: " << argv[0] << " [name=value]...\n"
+                << "parameters:\n";
+      for (const char* name : names)
+        std::cout << "  " << name << '\n';
+      return false;
+    }
+    const char* eq = std::strchr(argv[i], '=');
+    std::string name = eq ? std::string(argv[i], eq - argv[i]) : std::string(argv[i]);
+    auto known = std::find_if(names.begin(), names.end(),
+                              [&name](const char* n) { return name == n; });
+    if (!eq || known == names.end()) {
+      _diag.create_diag(err_unknown_parameter) << name << diag_build_finish;
+      return false;
+    }
+    _parameters[name] = eq + 1;
+  }
+  return true;
+}
+
+const std::string* transpiled_runtime::_find_parameter(const char* name) const {
+  auto iter = _parameters.find(name);
+  return iter == _parameters.end() ? nullptr : &iter->second;
+}
+
+void transpiled_runtime::apply_parameter(const char* name, INTEGER_T& value) {
+  const std::string* str = _find_parameter(name);
+  if (!str)
+    return;
+  char* end;
+  errno = 0;
+  long result = std::strtol(str->c_str(), &end, 10);
+  if (str->empty() || *end != '\0' || errno == ERANGE ||
+      result > std::numeric_limits<INTEGER_T>::max() ||
+      result < std::numeric_limits<INTEGER_T>::min()) {
+    _diag.create_diag(err_param_value) << *str << name << diag_build_finish;
+    return;
+  }
+  value = static_cast<INTEGER_T>(result);
+}
+
+void transpiled_runtime::apply_parameter(const char* name, FLOAT_POINT_T& value) {
+  const std::string* str = _find_parameter(name);
+  if (!str)
+    return;
+  char* end;
+  FLOAT_POINT_T result = std::strtod(str->c_str(), &end);
+  if (str->empty() || *end != '\0' || !std::isfinite(result)) {
+    _diag.create_diag(err_param_value) << *str << name << diag_build_finish;
+    return;
+  }
+  value = result;
+}
+
+void transpiled_runtime::apply_parameter(const char* name, STRING_T& value) {
+  if (const std::string* str = _find_parameter(name))
+    value = *str;
+}
+
+void transpiled_runtime::apply_parameter(const char* name, number_value& value) {
+  if (value.is_integer) {
+    auto result = static_cast<INTEGER_T>(value.value);
+    apply_parameter(name, result);
+    value.value = result;
+  } else {
+    apply_parameter(name, value.value);
+  }
+}
+
+std::optional<transpiled_tuple>
+transpiled_runtime::make_tuple(std::initializer_list<transpiled_number> elems) {
+  transpiled_tuple result{ {}, true };
+  result.values.reserve(elems.size());
+  for (const transpiled_number& elem : elems) {
+    if (!elem)
+      return std::nullopt;
+    result.values.push_back(to_float(*elem));
+    result.is_integer &= elem->is_integer;
+  }
+  return result;
+}
+
+INTEGER_T transpiled_runtime::to_integer(const number_value& value,
+                                         std::size_t start, std::size_t end) {
+  auto result = static_cast<INTEGER_T>(value.value);
+  if (!value.is_integer) {
+    _diag.create_diag(warn_narrow_conversion, start, end)
+      << "Double" << "Integer" << std::to_string(value.value) << std::to_string(result)
+      << diag_build_finish;
+  }
+  return result;
+}
+
+std::vector<INTEGER_T> transpiled_runtime::to_integer_tuple(const transpiled_tuple& value,
+                                                            std::size_t start,
+                                                            std::size_t end) {
+  std::vector<INTEGER_T> result(value.values.begin(), value.values.end());
+  if (!value.is_integer) {
+    std::string from = "(", to = "(";
+    for (std::size_t i = 0; i < result.size(); ++i) {
+      from += (i ? ", " : "") + std::to_string(value.values[i]);
+      to += (i ? ", " : "") + std::to_string(result[i]);
+    }
+    _diag.create_diag(warn_narrow_conversion, start, end)
+      << "TUPLE<Double>" << "TUPLE<Integer>" << from + ")" << to + ")" << diag_build_finish;
+  }
+  return result;
+}
+
+void transpiled_runtime::_report_invalid_result(const char* op_name,
+                                                FLOAT_POINT_T lhs, FLOAT_POINT_T rhs,
+                                                std::size_t op_loc) {
+  _diag.create_diag(err_invalid_binary_result, op_loc)
+    << op_name << lhs << rhs << diag_build_finish;
+}
+
+INTERPRETER_NAMESPACE_END
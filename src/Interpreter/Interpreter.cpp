@@ -1,13 +1,1006 @@
 #include <Interpret/Interpreter.h>
+#include <Interpret/Effects.h>
+#include <Utils/Counters.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
 
 INTERPRETER_NAMESPACE_BEGIN
 
+namespace {
+/**
+ * Keeps the points drawn during the lifetime of the object in
+ * a connected stroke (see @code{internal_impl::begin_stroke}).
+ */
+class stroke_scope {
+  internal_impl& _impl;
+public:
+  explicit stroke_scope(internal_impl& impl) : _impl(impl) { _impl.begin_stroke(); }
+  stroke_scope(const stroke_scope&) = delete;
+  stroke_scope& operator=(const stroke_scope&) = delete;
+  ~stroke_scope() { _impl.end_stroke(); }
+};
+
+/**
+ * Skips the iterations of a loop which only draw points off the canvas.
+ *
+ * If the body of a loop only consists of draw calls, we can bound the
+ * arguments of the calls over a chunk of iterations by interval
+ * arithmetic. If all the points drawn by the chunk are proved to be off
+ * the canvas, the body of these iterations has no effect and can be
+ * skipped. The size of the chunk grows while the chunks are skipped,
+ * so a long invisible part of a curve is skipped in a few steps.
+ */
+class draw_culler {
+public:
+  draw_culler(sema& action, internal_impl& impl, const for_stmt* s,
+              const variable_expr* var, const typed_value& to, const typed_value& step);
+
+  enum decision {
+    run_body,
+    skip_body,
+    /**
+     * The body is skipped, and the points skipped from this iteration
+     * break the pending strokes (see @code{internal_impl::skip_points}).
+     */
+    skip_and_break
+  };
+  /**
+   * Decides whether the body of the current iteration can be skipped.
+   * The caller calls @code{internal_impl::skip_points} for
+   * @code{skip_and_break}.
+   */
+  decision next_iteration();
+  /**
+   * Returns @code{true} if the body of the current iteration can be skipped.
+   */
+  bool skip_iteration() {
+    decision result = next_iteration();
+    if (result == skip_and_break)
+      _impl.skip_points();
+    return result != run_body;
+  }
+private:
+  static constexpr std::size_t _min_chunk = 16;
+  static constexpr std::size_t _max_chunk = 1u << 16;
+  static constexpr std::size_t _max_backoff = 1024;
+
+  sema& _action;
+  internal_impl& _impl;
+  const variable_expr* _var;
+  /**
+   * The arguments of all the draw calls in the body.
+   */
+  std::vector<std::pair<expr*, expr*>> _points;
+  bool _enabled = false;
+  FLOAT_POINT_T _to = 0, _step = 0;
+  std::size_t _chunk = _min_chunk, _backoff = _min_chunk;
+  std::size_t _skip_count = 0, _run_count = 0;
+
+  static std::optional<FLOAT_POINT_T> _get_num_value(const type& t, std::any v);
+  /**
+   * Counts the points of the skipped iteration as culled.
+   */
+  void _count_culled() const {
+    if (counter_registry::is_enabled()) {
+      static counter& culled = counter_registry::get("internal", "points_culled");
+      culled.add(_points.size());
+    }
+  }
+};
+
+draw_culler::draw_culler(sema& action, internal_impl& impl, const for_stmt* s,
+                         const variable_expr* var, const typed_value& to, const typed_value& step)
+  : _action(action), _impl(impl), _var(var) {
+  auto _to_value = _get_num_value(to.get_type(), to.get_value());
+  auto _step_value = _get_num_value(step.get_type(), step.get_value());
+  if (!_to_value || !_step_value || !_get_num_value(var->get_bind_type(), var->get_bind_value()))
+    return;
+  _to = *_to_value;
+  _step = *_step_value;
+  if (!(_step > 0) || !std::isfinite(_step) || std::isnan(_to))
+    return;
+  // The value of an Integer variable is truncated after adding a fraction,
+  // so we cannot bound the values of the variable by the step.
+  if (var->get_bind_type().is(type::INTEGER) && std::trunc(_step) != _step)
+    return;
+  for (auto iter = s->body_begin(); iter != s->body_end(); ++iter) {
+    const stmt* body = iter->get();
+    if (!body || body->get_stmt_kind() == stmt::empty_stmt_type)
+      continue;
+    if (body->get_stmt_kind() != stmt::expr_stmt_type)
+      return;
+    expr* e = static_cast<const expr_stmt*>(body)->get_expr();
+    if (e->get_stmt_kind() != stmt::call_expr_type)
+      return;
+    auto* call = static_cast<call_expr*>(e);
+    if (call->get_func_name() != "draw" || call->get_param_count() != 2)
+      return;
+    if (!action.try_bind_expr_variables(call->get_arg_expr(0)) ||
+        !action.try_bind_expr_variables(call->get_arg_expr(1)))
+      return;
+    _points.emplace_back(call->get_arg_expr(0), call->get_arg_expr(1));
+  }
+  _enabled = !_points.empty();
+}
+
+draw_culler::decision draw_culler::next_iteration() {
+  if (!_enabled)
+    return run_body;
+  if (_skip_count) {
+    --_skip_count;
+    _count_culled();
+    return skip_body;
+  }
+  if (_run_count) {
+    --_run_count;
+    return run_body;
+  }
+  // The values of the variable in the next chunk are in [cur, last].
+  // Leave a little room for the error accumulated by the additions.
+  FLOAT_POINT_T cur = *_get_num_value(_var->get_bind_type(), _var->get_bind_value());
+  FLOAT_POINT_T last = std::min(cur + static_cast<FLOAT_POINT_T>(_chunk - 1) * _step * (1 + 1e-9), _to);
+  interval range(cur, std::max(cur, last));
+  bool invisible = std::all_of(_points.begin(), _points.end(), [this, range](auto& point) {
+    auto x = _action.evaluate_interval(point.first, &_var->get_bind_info(), range);
+    if (!x)
+      return false;
+    auto y = _action.evaluate_interval(point.second, &_var->get_bind_info(), range);
+    return y && _impl.is_off_canvas(*x, *y);
+  });
+  if (invisible) {
+    _skip_count = _chunk - 1;
+    _chunk = std::min(_chunk * 2, _max_chunk);
+    _backoff = _min_chunk;
+    _count_culled();
+    return skip_and_break;
+  }
+  // The curve is (maybe) visible now. Check less frequently if it
+  // stays visible to keep the overhead low.
+  _chunk = _min_chunk;
+  _run_count = _backoff - 1;
+  _backoff = std::min(_backoff * 2, _max_backoff);
+  return run_body;
+}
+
+std::optional<FLOAT_POINT_T> draw_culler::_get_num_value(const type& t, std::any v) {
+  if (t.is(type::INTEGER))
+    return unpack_value<INTEGER_T>(std::move(v));
+  if (t.is(type::FLOAT_POINT))
+    return unpack_value<FLOAT_POINT_T>(std::move(v));
+  return std::nullopt;
+}
+
+/**
+ * Compares and steps the variable of a for statement natively, instead
+ * of going through @code{sema::compare}, @code{sema::_add_unchecked} and
+ * the assignment with @code{std::any} in each iteration.
+ *
+ * The variable is read from its storage in each iteration, since the
+ * body and the parallel loop may write it, and the new value is written
+ * to the storage directly, so the variable must have no value filter.
+ * The values are the same as the generic path computes. If adding the
+ * step would make a narrowing conversion or an invalid result, the
+ * generic path takes the step and makes the diagnostic.
+ */
+class loop_counter {
+public:
+  loop_counter(variable_expr* var, const typed_value& to, const typed_value& step);
+
+  explicit operator bool() const { return _address; }
+
+  /**
+   * Compares the variable with the value of 'to' like @code{sema::compare}.
+   */
+  [[nodiscard]] int compare_to() const {
+    FLOAT_POINT_T value = _get();
+    if (value < _to)
+      return -1;
+    return value == _to ? 0 : 1;
+  }
+
+  /**
+   * Adds the step to the variable. Returns false if the generic path
+   * must do it.
+   */
+  bool step();
+private:
+  void* _address = nullptr;
+  bool _is_integer = false;
+  FLOAT_POINT_T _to = 0;
+  FLOAT_POINT_T _step = 0;
+
+  [[nodiscard]] FLOAT_POINT_T _get() const {
+    if (_is_integer)
+      return *static_cast<const INTEGER_T*>(_address);
+    return *static_cast<const FLOAT_POINT_T*>(_address);
+  }
+};
+
+loop_counter::loop_counter(variable_expr* var, const typed_value& to, const typed_value& step) {
+  if (!var->has_bind_info())
+    return;
+  const type& var_type = var->get_bind_type();
+  if (var_type.is_not(type::INTEGER) && var_type.is_not(type::FLOAT_POINT))
+    return;
+  _is_integer = var_type.is(type::INTEGER);
+  if (to.get_type().is(type::INTEGER))
+    _to = unpack_value<INTEGER_T>(to.get_value());
+  else if (to.get_type().is(type::FLOAT_POINT))
+    _to = unpack_value<FLOAT_POINT_T>(to.get_value());
+  else
+    return;
+  // Adding a Double to an Integer variable makes a narrowing conversion.
+  if (step.get_type().is(type::INTEGER))
+    _step = unpack_value<INTEGER_T>(step.get_value());
+  else if (step.get_type().is(type::FLOAT_POINT) && !_is_integer)
+    _step = unpack_value<FLOAT_POINT_T>(step.get_value());
+  else
+    return;
+  _address = var->get_bind_info().get_assignable_address();
+}
+
+bool loop_counter::step() {
+  FLOAT_POINT_T next = _get() + _step;
+  if (_is_integer) {
+    if (!sema::check_double_to_int(next))
+      return false;
+    *static_cast<INTEGER_T*>(_address) = static_cast<INTEGER_T>(next);
+  } else {
+    if (!std::isfinite(next))
+      return false;
+    *static_cast<FLOAT_POINT_T*>(_address) = next;
+  }
+  return true;
+}
+
+/**
+ * Runs the body of a loop with the code compiled by the JIT.
+ *
+ * The body is compiled after it has run once in the interpreter, so that
+ * all the names and calls in it have been bound and inferred. Two kinds
+ * of statements are compiled: the assignments of numeric expressions to
+ * Double variables, and the calls whose parameters are all Double (e.g.
+ * @code{draw}), for which only the arguments are computed by the native
+ * code. The other statements, and the statements whose compiled code
+ * fails (which means a diagnostic should be made) run in the interpreter.
+ */
+class jit_loop_body {
+public:
+  jit_loop_body(sema& action, const for_stmt* s);
+
+  void run(interpreter& runner);
+private:
+  struct _compiled_stmt {
+    stmt* s;
+    std::optional<jit_function> code;
+    /**
+     * The called function if the statement is a call.
+     */
+    const function_info* func = nullptr;
+    location_list param_loc;
+  };
+
+  sema& _action;
+  std::vector<_compiled_stmt> _body;
+  std::vector<FLOAT_POINT_T> _args;
+
+  void _compile_call(_compiled_stmt& result, call_expr* e);
+  void _compile_assignment(_compiled_stmt& result, assignment_stmt* s);
+};
+
+jit_loop_body::jit_loop_body(sema& action, const for_stmt* s) : _action(action) {
+  for (auto iter = s->body_begin(); iter != s->body_end(); ++iter) {
+    _compiled_stmt result{ iter->get() };
+    if (!result.s || result.s->get_stmt_kind() == stmt::empty_stmt_type)
+      continue;
+    if (result.s->get_stmt_kind() == stmt::expr_stmt_type) {
+      expr* e = static_cast<expr_stmt*>(result.s)->get_expr();
+      if (e->get_stmt_kind() == stmt::call_expr_type)
+        _compile_call(result, static_cast<call_expr*>(e));
+    } else if (result.s->get_stmt_kind() == stmt::assignment_stmt_type) {
+      _compile_assignment(result, static_cast<assignment_stmt*>(result.s));
+    }
+    _body.push_back(std::move(result));
+  }
+}
+
+void jit_loop_body::_compile_call(_compiled_stmt& result, call_expr* e) {
+  if (!e->has_bind_info())
+    return;
+  const function_info& func = e->get_bind_func();
+  std::vector<expr*> args;
+  for (std::size_t i = 0; i < e->get_param_count(); ++i) {
+    if (func.get_param_type(i).is_not(type::FLOAT_POINT))
+      return;
+    args.push_back(e->get_arg_expr(i));
+    // The arguments have been inferred when the call is evaluated.
+    _action.infer_type(args.back());
+  }
+  result.code = jit_compiler::compile_values(args);
+  if (!result.code)
+    return;
+  result.func = &func;
+  for (expr* arg : args) {
+    result.param_loc.push_back(arg->get_start_loc());
+    result.param_loc.push_back(arg->get_end_loc());
+  }
+  _args.resize(std::max(_args.size(), args.size()));
+}
+
+void jit_loop_body::_compile_assignment(_compiled_stmt& result, assignment_stmt* s) {
+  auto* lhs = static_cast<variable_expr*>(s->get_assignment_lhs());
+  if (!lhs->has_bind_info() || lhs->get_bind_type().is_not(type::FLOAT_POINT))
+    return;
+  void* target = lhs->get_bind_info().get_assignable_address();
+  if (!target)
+    return;
+  _action.infer_type(s->get_assignment_rhs());
+  result.code = jit_compiler::compile_assignment(s->get_assignment_rhs(),
+                                                 static_cast<FLOAT_POINT_T*>(target));
+}
+
+void jit_loop_body::run(interpreter& runner) {
+  for (_compiled_stmt& compiled : _body) {
+    if (!compiled.code || !(*compiled.code)(_args.data())) {
+      runner.visit(compiled.s);
+      continue;
+    }
+    if (!compiled.func)
+      continue;
+    std::vector<std::any> arguments(_args.begin(), _args.begin() + compiled.func->get_param_count());
+    diag_info_pack pack { _action.get_diag_engine(), compiled.param_loc, true };
+    (void)compiled.func->call(pack, std::move(arguments));
+  }
+}
+
+/**
+ * Runs the iterations of a loop on several threads.
+ *
+ * If the body of a loop only consists of draw calls whose arguments are
+ * numeric expressions, the iterations are independent: nothing is
+ * assigned, and the only effect of an iteration is drawing its points.
+ * The values of the loop variable of a chunk of iterations are computed
+ * first, then the chunk is partitioned across the threads, each of which
+ * evaluates the arguments of the iterations in its part into its own
+ * part of a buffer. The points are drawn by the calling thread in the
+ * order of the iterations, so the picture is the same as the one drawn
+ * serially.
+ *
+ * The arguments are compiled into postfix programs which do not touch
+ * the state of @code{sema}, so that they can run on any thread. The
+ * variables other than the loop variable are not assigned in the loop,
+ * so their values are read when the programs are compiled. The
+ * operations are the same as the kernels selected by
+ * @code{sema::infer_type}. If an iteration would make a diagnostic, it
+ * runs in the interpreter in its turn, which makes the diagnostic.
+ */
+class parallel_loop {
+public:
+  parallel_loop(sema& action, internal_impl& impl, const for_stmt* s, variable_expr* var,
+                const typed_value& to, const typed_value& step, std::size_t threads);
+
+  /**
+   * Makes the loop of @param{s} before the statement runs, so that its
+   * first iterations can be evaluated ahead (see @code{precompute}).
+   * The names are bound without diagnostics, and the values of the
+   * expressions of the loop are computed as the interpreter will do
+   * when it runs @param{s}. The value of the loop variable in the first
+   * iteration is stored to @param{from}. Returns @code{nullptr} if the
+   * loop cannot run in parallel or its expressions cannot be computed
+   * without the interpreter.
+   */
+  static std::unique_ptr<parallel_loop> prepare(sema& action, internal_impl& impl,
+                                                const for_stmt* s, std::size_t threads,
+                                                FLOAT_POINT_T& from);
+
+  /**
+   * Evaluates the points of the first iterations starting from
+   * @param{from}, which are used by @code{run} later. This only
+   * reads the compiled programs, so it can run on another thread while
+   * the interpreter runs other statements.
+   */
+  void precompute(FLOAT_POINT_T from);
+
+  /**
+   * Runs a chunk of iterations from the current value of the loop
+   * variable, and leaves the variable at the value of the first
+   * iteration which is not run. @param{culler} decides whether the body
+   * of each iteration is skipped as the interpreter does. Returns
+   * @code{false} if no iteration is run, which means the next iteration
+   * must run in the interpreter.
+   */
+  bool run(interpreter& runner, draw_culler& culler);
+private:
+  static constexpr std::size_t _chunk = 4096;
+  static constexpr std::size_t _ahead = 1u << 18;
+
+  struct _op {
+    enum op_kind { push_value, push_var, binary, negate, call } kind;
+    number_value value{};
+    binary_expr::op_kind binary_kind = binary_expr::bo_add;
+    internal_impl::native_math_func_t func = nullptr;
+  };
+  using _program = std::vector<_op>;
+  struct _draw_call {
+    const function_info* func;
+    location_list param_loc;
+    _program x, y;
+  };
+  enum _state : unsigned char { _pending, _ready, _failed };
+
+  sema& _action;
+  internal_impl& _impl;
+  const for_stmt* _stmt;
+  variable_info* _var = nullptr;
+  bool _var_is_integer = false;
+  std::vector<_draw_call> _calls;
+  bool _enabled = false;
+  std::size_t _threads;
+  FLOAT_POINT_T _to = 0, _step = 0;
+  /**
+   * The values of the variable, the decisions of the culler, the states
+   * and the points of the iterations in the current chunk.
+   */
+  std::vector<FLOAT_POINT_T> _values;
+  std::vector<draw_culler::decision> _decisions;
+  std::vector<_state> _states;
+  std::vector<cv::Point2d> _points;
+  /**
+   * The iterations evaluated by @code{precompute}, and the number of
+   * iterations which have been run.
+   */
+  std::vector<FLOAT_POINT_T> _ahead_values;
+  std::vector<_state> _ahead_states;
+  std::vector<cv::Point2d> _ahead_points;
+  std::size_t _index = 0;
+
+  parallel_loop(sema& action, internal_impl& impl, const for_stmt* s, std::size_t threads)
+    : _action(action), _impl(impl), _stmt(s), _threads(threads) { }
+
+  void _init(variable_expr* var, const typed_value& to, const typed_value& step);
+  /**
+   * Finds the function called by @param{call}. If the call has not been
+   * bound, which happens before its first evaluation, it is the only
+   * overload of the name.
+   */
+  [[nodiscard]] const function_info* _resolve(call_expr* call) const;
+  bool _compile(expr* e, _program& program);
+  bool _evaluate(const _program& program, FLOAT_POINT_T var,
+                 std::vector<number_value>& stack, FLOAT_POINT_T& result) const;
+  /**
+   * Computes the value of @param{e}, which is not in the body, with the
+   * current values of the variables.
+   */
+  std::optional<number_value> _evaluate_expr(expr* e);
+  /**
+   * Evaluates the points of the iteration where the variable is
+   * @param{value} into @param{points}.
+   */
+  _state _evaluate_points(FLOAT_POINT_T value, cv::Point2d* points,
+                          std::vector<number_value>& stack) const;
+  /**
+   * Evaluates the pending iterations in [begin, end) whose bodies run.
+   */
+  void _evaluate_range(std::size_t begin, std::size_t end);
+  void _set_var(FLOAT_POINT_T value);
+};
+
+parallel_loop::parallel_loop(sema& action, internal_impl& impl, const for_stmt* s,
+                             variable_expr* var, const typed_value& to, const typed_value& step,
+                             std::size_t threads)
+  : parallel_loop(action, impl, s, threads) {
+  _init(var, to, step);
+}
+
+std::unique_ptr<parallel_loop>
+parallel_loop::prepare(sema& action, internal_impl& impl, const for_stmt* s, std::size_t threads,
+                       FLOAT_POINT_T& from) {
+  auto* var = static_cast<variable_expr*>(s->get_for_expr());
+  bool bind_result = action.try_bind_expr_variables(var);
+  if (s->has_from())
+    bind_result &= action.try_bind_expr_variables(s->get_from_expr());
+  bind_result &= action.try_bind_expr_variables(s->get_to_expr());
+  if (s->has_step())
+    bind_result &= action.try_bind_expr_variables(s->get_step_expr());
+  for (auto iter = s->body_begin(); iter != s->body_end(); ++iter) {
+    const stmt* body = iter->get();
+    if (body && body->get_stmt_kind() == stmt::expr_stmt_type)
+      bind_result &= action.try_bind_expr_variables(static_cast<const expr_stmt*>(body)->get_expr());
+  }
+  if (!bind_result)
+    return nullptr;
+  std::unique_ptr<parallel_loop> result(new parallel_loop(action, impl, s, threads));
+  result->_var = &var->get_bind_info();
+  const type& var_type = result->_var->get_type();
+  if (var_type.is_not(type::INTEGER) && var_type.is_not(type::FLOAT_POINT))
+    return nullptr;
+  result->_var_is_integer = var_type.is(type::INTEGER);
+  std::optional<number_value> from_value = result->_evaluate_expr(s->has_from() ? s->get_from_expr()
+                                                                                : var);
+  std::optional<number_value> to_value = result->_evaluate_expr(s->get_to_expr());
+  std::optional<number_value> step_value = number_value{ 1, true };
+  if (s->has_step())
+    step_value = result->_evaluate_expr(s->get_step_expr());
+  // Assigning a Double to an Integer variable makes a narrowing conversion.
+  if (!from_value || !to_value || !step_value ||
+      (result->_var_is_integer && !from_value->is_integer))
+    return nullptr;
+  auto pack = [](const number_value& value) {
+    return value.is_integer ? typed_value(type(type::INTEGER), static_cast<INTEGER_T>(value.value))
+                            : typed_value(type(type::FLOAT_POINT), value.value);
+  };
+  result->_init(var, pack(*to_value), pack(*step_value));
+  if (!result->_enabled)
+    return nullptr;
+  from = from_value->value;
+  return result;
+}
+
+void parallel_loop::_init(variable_expr* var, const typed_value& to, const typed_value& step) {
+  if (!var->has_bind_info())
+    return;
+  _var = &var->get_bind_info();
+  const type& var_type = _var->get_type();
+  // The values written to the variable are not checked, so it must
+  // have no value filter. The transformation of the points depends on
+  // `rot`, so it cannot change during the loop either.
+  if (var_type.is_not(type::INTEGER) && var_type.is_not(type::FLOAT_POINT))
+    return;
+  if (!_var->get_assignable_address() || _var == _action.get_symbol_table().get_variable("rot"))
+    return;
+  _var_is_integer = var_type.is(type::INTEGER);
+  if (to.get_type().is(type::INTEGER))
+    _to = unpack_value<INTEGER_T>(to.get_value());
+  else if (to.get_type().is(type::FLOAT_POINT))
+    _to = unpack_value<FLOAT_POINT_T>(to.get_value());
+  else
+    return;
+  // Adding a Double to an Integer variable makes a narrowing conversion.
+  if (step.get_type().is(type::INTEGER))
+    _step = unpack_value<INTEGER_T>(step.get_value());
+  else if (step.get_type().is(type::FLOAT_POINT) && !_var_is_integer)
+    _step = unpack_value<FLOAT_POINT_T>(step.get_value());
+  else
+    return;
+  for (auto iter = _stmt->body_begin(); iter != _stmt->body_end(); ++iter) {
+    const stmt* body = iter->get();
+    if (!body || body->get_stmt_kind() == stmt::empty_stmt_type)
+      continue;
+    if (body->get_stmt_kind() != stmt::expr_stmt_type)
+      return;
+    expr* e = static_cast<const expr_stmt*>(body)->get_expr();
+    if (e->get_stmt_kind() != stmt::call_expr_type)
+      return;
+    auto* call = static_cast<call_expr*>(e);
+    if (call->get_func_name() != "draw" || call->get_param_count() != 2)
+      return;
+    const function_info* func = _resolve(call);
+    if (!func)
+      return;
+    _draw_call result{ func };
+    if (!_compile(call->get_arg_expr(0), result.x) || !_compile(call->get_arg_expr(1), result.y))
+      return;
+    for (std::size_t i = 0; i < 2; ++i) {
+      result.param_loc.push_back(call->get_arg_expr(i)->get_start_loc());
+      result.param_loc.push_back(call->get_arg_expr(i)->get_end_loc());
+    }
+    _calls.push_back(std::move(result));
+  }
+  _enabled = !_calls.empty();
+}
+
+const function_info* parallel_loop::_resolve(call_expr* call) const {
+  if (call->has_bind_info())
+    return &call->get_bind_func();
+  std::vector<const function_info*> funcs =
+      _action.get_symbol_table().get_function(call->get_func_name());
+  if (funcs.size() != 1 || funcs.front()->get_param_count() != call->get_param_count())
+    return nullptr;
+  return funcs.front();
+}
+
+bool parallel_loop::_compile(expr* e, _program& program) {
+  // The operators always make numbers from numbers, so only the types
+  // of the leaves are checked.
+  expr::inferred_kind kind = expr::ik_unknown;
+  if (e->get_stmt_kind() == stmt::num_expr_type || e->get_stmt_kind() == stmt::variable_expr_type) {
+    kind = _action.infer_type(e);
+    if (kind != expr::ik_integer && kind != expr::ik_float_point && kind != expr::ik_number)
+      return false;
+  }
+  switch (e->get_stmt_kind()) {
+    case stmt::num_expr_type:
+      program.push_back({ _op::push_value,
+                          { static_cast<num_expr*>(e)->get_value(), kind == expr::ik_integer } });
+      return true;
+    case stmt::variable_expr_type: {
+      auto* var = static_cast<variable_expr*>(e);
+      if (!var->has_bind_info())
+        return false;
+      if (&var->get_bind_info() == _var) {
+        program.push_back({ _op::push_var });
+        return true;
+      }
+      const variable_info& info = var->get_bind_info();
+      if (info.get_type().is(type::INTEGER))
+        program.push_back({ _op::push_value, { static_cast<FLOAT_POINT_T>(
+                                                   unpack_value<INTEGER_T>(info.get_value())), true } });
+      else
+        program.push_back({ _op::push_value, { unpack_value<FLOAT_POINT_T>(info.get_value()), false } });
+      return true;
+    }
+    case stmt::binary_expr_type: {
+      auto* binary = static_cast<binary_expr*>(e);
+      if (!_compile(binary->get_lhs(), program) || !_compile(binary->get_rhs(), program))
+        return false;
+      _op op{ _op::binary };
+      op.binary_kind = binary->get_op_kind();
+      program.push_back(op);
+      return true;
+    }
+    case stmt::unary_expr_type: {
+      auto* unary = static_cast<unary_expr*>(e);
+      if (!_compile(unary->get_operand(), program))
+        return false;
+      if (unary->get_op_kind() == unary_expr::uo_minus)
+        program.push_back({ _op::negate });
+      return true;
+    }
+    case stmt::call_expr_type: {
+      // Only the math functions on Doubles are pure.
+      auto* call = static_cast<call_expr*>(e);
+      if (call->get_param_count() != 1)
+        return false;
+      const function_info* info = _resolve(call);
+      if (!info || info->get_param_type(0).is_not(type::FLOAT_POINT) ||
+          info->get_ret_type().is_not(type::FLOAT_POINT))
+        return false;
+      _op op{ _op::call };
+      op.func = internal_impl::get_native_math_function(call->get_func_name());
+      if (!op.func || !_compile(call->get_arg_expr(0), program))
+        return false;
+      program.push_back(op);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+bool parallel_loop::_evaluate(const _program& program, FLOAT_POINT_T var,
+                              std::vector<number_value>& stack, FLOAT_POINT_T& result) const {
+  stack.clear();
+  for (const _op& op : program) {
+    switch (op.kind) {
+      case _op::push_value:
+        stack.push_back(op.value);
+        break;
+      case _op::push_var:
+        stack.push_back({ var, _var_is_integer });
+        break;
+      case _op::binary: {
+        number_value rhs = stack.back();
+        stack.pop_back();
+        number_value& lhs = stack.back();
+        FLOAT_POINT_T value;
+        switch (op.binary_kind) {
+          case binary_expr::bo_add: value = lhs.value + rhs.value; break;
+          case binary_expr::bo_sub: value = lhs.value - rhs.value; break;
+          case binary_expr::bo_mul: value = lhs.value * rhs.value; break;
+          case binary_expr::bo_div:
+            // A division by zero makes a warning.
+            if (rhs.value == 0)
+              return false;
+            value = lhs.value / rhs.value;
+            break;
+          default:
+            assert(op.binary_kind == binary_expr::bo_pow);
+            value = std::pow(lhs.value, rhs.value);
+        }
+        if (!std::isfinite(value))
+          return false;
+        bool should_check = op.binary_kind == binary_expr::bo_pow ? lhs.is_integer
+                                                                  : lhs.is_integer && rhs.is_integer;
+        lhs = { value, should_check && sema::check_double_to_int(value) };
+        // The Integers are converted as the interpreter does, so -0 is
+        // 0 in the next operation.
+        if (lhs.is_integer)
+          lhs.value = static_cast<INTEGER_T>(lhs.value);
+        break;
+      }
+      case _op::negate: {
+        number_value& operand = stack.back();
+        operand.value = -operand.value;
+        operand.is_integer = operand.is_integer && sema::check_double_to_int(operand.value);
+        if (operand.is_integer)
+          operand.value = static_cast<INTEGER_T>(operand.value);
+        break;
+      }
+      case _op::call: {
+        // The argument is converted to a Double as an Integer value,
+        // which has no negative zero.
+        number_value& arg = stack.back();
+        FLOAT_POINT_T value = arg.is_integer ? static_cast<INTEGER_T>(arg.value) : arg.value;
+        value = op.func(value);
+        if (!std::isfinite(value))
+          return false;
+        arg = { value, false };
+        break;
+      }
+    }
+  }
+  const number_value& value = stack.back();
+  result = value.is_integer ? static_cast<INTEGER_T>(value.value) : value.value;
+  return true;
+}
+
+std::optional<number_value> parallel_loop::_evaluate_expr(expr* e) {
+  // The kind decides whether the value is an Integer as the kernels do.
+  expr::inferred_kind kind = _action.infer_type(e);
+  if (kind != expr::ik_integer && kind != expr::ik_float_point)
+    return std::nullopt;
+  _program program;
+  if (!_compile(e, program))
+    return std::nullopt;
+  const void* address = _var->get_value_address();
+  FLOAT_POINT_T value = _var_is_integer ? *static_cast<const INTEGER_T*>(address)
+                                        : *static_cast<const FLOAT_POINT_T*>(address);
+  std::vector<number_value> stack;
+  FLOAT_POINT_T result;
+  if (!_evaluate(program, value, stack, result))
+    return std::nullopt;
+  return number_value{ result, kind == expr::ik_integer };
+}
+
+parallel_loop::_state parallel_loop::_evaluate_points(FLOAT_POINT_T value, cv::Point2d* points,
+                                                      std::vector<number_value>& stack) const {
+  for (std::size_t j = 0; j < _calls.size(); ++j) {
+    if (!_evaluate(_calls[j].x, value, stack, points[j].x) ||
+        !_evaluate(_calls[j].y, value, stack, points[j].y))
+      return _failed;
+  }
+  return _ready;
+}
+
+void parallel_loop::_evaluate_range(std::size_t begin, std::size_t end) {
+  std::vector<number_value> stack;
+  for (std::size_t i = begin; i < end; ++i) {
+    if (_decisions[i] == draw_culler::run_body && _states[i] == _pending)
+      _states[i] = _evaluate_points(_values[i], &_points[i * _calls.size()], stack);
+  }
+}
+
+void parallel_loop::precompute(FLOAT_POINT_T from) {
+  std::vector<number_value> stack;
+  FLOAT_POINT_T value = from;
+  while (_ahead_values.size() < _ahead && value < _to) {
+    FLOAT_POINT_T next = value + _step;
+    if (_var_is_integer ? !sema::check_double_to_int(next) : !std::isfinite(next))
+      break;
+    _ahead_values.push_back(value);
+    _ahead_points.resize(_ahead_points.size() + _calls.size());
+    _ahead_states.push_back(_evaluate_points(
+        value, &_ahead_points[_ahead_points.size() - _calls.size()], stack));
+    value = next;
+  }
+}
+
+void parallel_loop::_set_var(FLOAT_POINT_T value) {
+  void* address = _var->get_assignable_address();
+  if (_var_is_integer)
+    *static_cast<INTEGER_T*>(address) = static_cast<INTEGER_T>(value);
+  else
+    *static_cast<FLOAT_POINT_T*>(address) = value;
+}
+
+bool parallel_loop::run(interpreter& runner, draw_culler& culler) {
+  if (!_enabled)
+    return false;
+  const void* address = _var->get_value_address();
+  FLOAT_POINT_T value = _var_is_integer ? *static_cast<const INTEGER_T*>(address)
+                                        : *static_cast<const FLOAT_POINT_T*>(address);
+  // Compute the values of the variable as the interpreter does, and
+  // stop before an iteration whose step makes a diagnostic. The culler
+  // reads the value of the variable.
+  _values.clear();
+  _decisions.clear();
+  while (_values.size() < _chunk * _threads && value < _to) {
+    FLOAT_POINT_T next = value + _step;
+    if (_var_is_integer ? !sema::check_double_to_int(next) : !std::isfinite(next))
+      break;
+    _set_var(value);
+    _values.push_back(value);
+    _decisions.push_back(culler.next_iteration());
+    value = next;
+  }
+  std::size_t count = _values.size();
+  if (count == 0)
+    return false;
+  _points.resize(count * _calls.size());
+  _states.assign(count, _pending);
+  // The iterations evaluated ahead are used if the values of the
+  // variable are the same.
+  for (std::size_t i = 0; i < count && _index + i < _ahead_values.size(); ++i) {
+    if (_ahead_values[_index + i] != _values[i])
+      break;
+    _states[i] = _ahead_states[_index + i];
+    std::copy_n(_ahead_points.begin() + static_cast<std::ptrdiff_t>((_index + i) * _calls.size()),
+                _calls.size(), _points.begin() + static_cast<std::ptrdiff_t>(i * _calls.size()));
+  }
+  _index += count;
+  std::size_t threads = std::min(_threads, count);
+  std::vector<std::thread> workers;
+  for (std::size_t i = 1; i < threads; ++i) {
+    workers.emplace_back([this, count, threads, i] {
+      _evaluate_range(count * i / threads, count * (i + 1) / threads);
+    });
+  }
+  _evaluate_range(0, count / threads);
+  for (std::thread& worker : workers)
+    worker.join();
+  for (std::size_t i = 0; i < count; ++i) {
+    if (_decisions[i] == draw_culler::skip_and_break)
+      _impl.skip_points();
+    if (_decisions[i] != draw_culler::run_body)
+      continue;
+    if (_states[i] == _failed) {
+      // The iteration makes a diagnostic, so the interpreter runs it.
+      _set_var(_values[i]);
+      for (auto iter = _stmt->body_begin(); iter != _stmt->body_end(); ++iter)
+        runner.visit(iter->get());
+      continue;
+    }
+    for (std::size_t j = 0; j < _calls.size(); ++j) {
+      const cv::Point2d& point = _points[i * _calls.size() + j];
+      std::vector<std::any> arguments{ point.x, point.y };
+      diag_info_pack pack { _action.get_diag_engine(), _calls[j].param_loc, true };
+      (void)_calls[j].func->call(pack, std::move(arguments));
+    }
+  }
+  _set_var(value);
+  return true;
+}
+
+/**
+ * Returns the effects of computing the points of the loop @param{s}
+ * without drawing them. The loop variable is assigned by the loop
+ * itself, so its value is only read if there is no from clause.
+ */
+stmt_effects evaluation_effects(for_stmt* s) {
+  stmt_effects body;
+  for (auto iter = s->body_begin(); iter != s->body_end(); ++iter) {
+    stmt* part = iter->get();
+    if (!part)
+      continue;
+    if (part->get_stmt_kind() == stmt::expr_stmt_type &&
+        static_cast<expr_stmt*>(part)->get_expr()->get_stmt_kind() == stmt::call_expr_type) {
+      auto* call = static_cast<call_expr*>(static_cast<expr_stmt*>(part)->get_expr());
+      for (auto arg = call->param_begin(); arg != call->param_end(); ++arg)
+        body.add(arg->get());
+    } else
+      body.add(part);
+  }
+  stmt_effects result;
+  string_ref var = static_cast<variable_expr*>(s->get_for_expr())->get_name();
+  for (string_ref name : body.get_reads()) {
+    if (name != var)
+      result.add_read(name);
+  }
+  if (s->has_from())
+    result.add(s->get_from_expr());
+  else
+    result.add_read(var);
+  result.add(s->get_to_expr());
+  if (s->has_step())
+    result.add(s->get_step_expr());
+  return result;
+}
+} // namespace
+
+struct interpreter::_precomputed_loop {
+  std::unique_ptr<parallel_loop> loop;
+  std::thread worker;
+  double busy_seconds = 0;
+};
 
 void interpreter::run_stmts(const std::vector<stmt_result_t>& stmts) {
-  for (auto& stmt : stmts) {
-    if (stmt)
-      visit(stmt.get());
+  run_stmts(stmts, 0, nullptr);
+}
+
+void interpreter::run_stmts(const std::vector<stmt_result_t>& stmts, std::size_t first,
+                            const std::function<void(std::size_t)>& after_stmt) {
+  auto start = std::chrono::steady_clock::now();
+  // The loops which can be evaluated ahead, with the index of the first
+  // statement which can run at the same time, i.e. the one after the
+  // last statement whose effects the evaluation depends on.
+  std::vector<std::pair<std::size_t, std::size_t>> candidates;
+  if (_threads > 1) {
+    std::vector<stmt_effects> effects(stmts.size());
+    for (std::size_t i = first; i < stmts.size(); ++i) {
+      if (!stmts[i])
+        continue;
+      effects[i].add(stmts[i].get());
+      if (stmts[i]->get_stmt_kind() != stmt::for_stmt_type)
+        continue;
+      stmt_effects evaluation = evaluation_effects(static_cast<for_stmt*>(stmts[i].get()));
+      std::size_t ready = first;
+      for (std::size_t k = first; k < i; ++k) {
+        if (evaluation.depends_on(effects[k]))
+          ready = k + 1;
+      }
+      if (ready < i)
+        candidates.emplace_back(i, ready);
+    }
   }
+  for (std::size_t i = first; i < stmts.size() && !_past_deadline(); ++i) {
+    // Start the loops whose inputs are ready, keeping one thread for
+    // the statements run in order.
+    for (auto iter = candidates.begin();
+         iter != candidates.end() && _precomputed.size() + 1 < _threads;) {
+      if (iter->first <= i) {
+        iter = candidates.erase(iter);
+      } else if (iter->second <= i) {
+        _start_precompute(static_cast<const for_stmt*>(stmts[iter->first].get()));
+        iter = candidates.erase(iter);
+      } else
+        ++iter;
+    }
+    if (stmts[i]) {
+      visit(stmts[i].get());
+      ++_schedule_stats.statements;
+      // The loop may stop before its first iteration.
+      if (stmts[i]->get_stmt_kind() == stmt::for_stmt_type) {
+        auto precomputed = _precomputed.find(static_cast<const for_stmt*>(stmts[i].get()));
+        if (precomputed != _precomputed.end()) {
+          _finish_precompute(*precomputed->second);
+          _precomputed.erase(precomputed);
+        }
+      }
+    }
+    if (after_stmt)
+      after_stmt(i);
+  }
+  // The loops evaluated ahead do not run if the program is stopped.
+  for (auto& [loop, precomputed] : _precomputed)
+    _finish_precompute(*precomputed);
+  _precomputed.clear();
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  _schedule_stats.elapsed_seconds += elapsed;
+  _schedule_stats.busy_seconds += elapsed;
+}
+
+bool interpreter::_past_deadline() {
+  if (!_deadline || _timed_out)
+    return _timed_out;
+  if (_deadline_countdown-- != 0)
+    return false;
+  _deadline_countdown = _deadline_interval - 1;
+  _timed_out = std::chrono::steady_clock::now() >= *_deadline;
+  return _timed_out;
+}
+
+void interpreter::_start_precompute(const for_stmt* s) {
+  FLOAT_POINT_T from;
+  std::unique_ptr<parallel_loop> loop = parallel_loop::prepare(action, symbol, s, _threads, from);
+  if (!loop)
+    return;
+  auto result = std::make_shared<_precomputed_loop>();
+  result->loop = std::move(loop);
+  result->worker = std::thread([loop = result.get(), from] {
+    auto start = std::chrono::steady_clock::now();
+    loop->loop->precompute(from);
+    loop->busy_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  });
+  _precomputed.emplace(s, std::move(result));
+  ++_schedule_stats.overlapped;
+}
+
+void interpreter::_finish_precompute(_precomputed_loop& loop) {
+  loop.worker.join();
+  _schedule_stats.busy_seconds += loop.busy_seconds;
 }
 
 bool interpreter::_assign_to_value(variable_expr* lhs, typed_value& rhs,
@@ -22,18 +1015,29 @@ bool interpreter::_assign_to_value(variable_expr* lhs, typed_value& rhs,
           << to.get_spelling() << from.get_spelling() << diag_build_finish;
       return false;
     }
-    std::string _origin_value = rhs.get_value_spelling();
-    std::string _origin_type = rhs.get_type().get_spelling();
+    // The original value is only spelled if the conversion narrows it.
     bool narrow = false;
-    typed_value convert_result = action.convert_to(std::move(rhs), to, narrow);
-    _rhs_value = convert_result.take_value();
+    typed_value convert_result = action.convert_to(rhs, to, narrow);
     if (narrow) {
       diag(warn_narrow_conversion, rhs_start_loc, rhs_end_loc)
-          << _origin_type << convert_result.get_type().get_spelling()
-          << _origin_value << convert_result.get_value_spelling() << diag_build_finish;
+          << rhs.get_type().get_spelling() << convert_result.get_type().get_spelling()
+          << rhs.get_value_spelling() << convert_result.get_value_spelling() << diag_build_finish;
     }
+    _rhs_value = convert_result.take_value();
   } else
     _rhs_value = rhs.take_value();
+  // The numbers are stored directly if no value filter checks them.
+  if (void* address = lhs->get_bind_info().get_assignable_address()) {
+    const type& var_type = lhs->get_bind_type();
+    if (var_type.is(type::INTEGER)) {
+      *static_cast<INTEGER_T*>(address) = std::any_cast<INTEGER_T>(_rhs_value);
+      return true;
+    }
+    if (var_type.is(type::FLOAT_POINT)) {
+      *static_cast<FLOAT_POINT_T*>(address) = std::any_cast<FLOAT_POINT_T>(_rhs_value);
+      return true;
+    }
+  }
   // We don't need to check constant here.
   // because if we try to assign to a constant value, the default value
   // filter of it will report a diagnostic message.
@@ -122,12 +1126,25 @@ void interpreter::visit_for_stmt(for_stmt* s) {
       return;
   }
 
+  // The points drawn by the loop are connected in line mode.
+  stroke_scope _stroke(symbol);
+  draw_culler _culler(action, symbol, s, for_variable, *to_tv, *step_tv);
+  std::optional<jit_loop_body> _jit_body;
+  std::unique_ptr<parallel_loop> _parallel;
+  // The loop evaluated ahead by `run_stmts` runs from the first iteration.
+  if (auto precomputed = _precomputed.find(s); precomputed != _precomputed.end()) {
+    _finish_precompute(*precomputed->second);
+    _parallel = std::move(precomputed->second->loop);
+    _precomputed.erase(precomputed);
+  }
+  loop_counter _counter(for_variable, *to_tv, *step_tv);
   // 3. Compare the variable with the value of 'to'.
   while (true) {
-    int compare_result = action.compare(for_variable->get_bind_type(),
-                                        for_variable->get_bind_value(),
-                                        to_tv->get_type(), to_tv->get_value(),
-                                        s->get_to_loc());
+    int compare_result = _counter ? _counter.compare_to()
+                                  : action.compare(for_variable->get_bind_type(),
+                                                   for_variable->get_bind_value(),
+                                                   to_tv->get_type(), to_tv->get_value(),
+                                                   s->get_to_loc());
     // This is an invalid comparison, make a diag.
     if (compare_result == -2) {
       diag(err_invalid_compare_type, s->get_to_loc())
@@ -136,13 +1153,28 @@ void interpreter::visit_for_stmt(for_stmt* s) {
       return;
     }
     // stop loop
-    if (compare_result >= 0)
+    if (compare_result >= 0 || _past_deadline())
       break;
     // 4. If current value is less than 'to', run the body.
-    for (auto iter = s->body_begin(); iter != s->body_end(); ++iter) {
-      visit(iter->get());
+    if (_parallel && _parallel->run(*this, _culler))
+      continue;
+    if (!_culler.skip_iteration()) {
+      if (_jit_body) {
+        _jit_body->run(*this);
+      } else {
+        for (auto iter = s->body_begin(); iter != s->body_end(); ++iter) {
+          visit(iter->get());
+        }
+        if (_jit_enabled)
+          _jit_body.emplace(action, s);
+      }
+      if (_threads > 1 && !_parallel)
+        _parallel = std::make_unique<parallel_loop>(action, symbol, s, for_variable,
+                                                    *to_tv, *step_tv, _threads);
     }
     // 5. add the current value with the 'step' value, and goto 3.
+    if (_counter && _counter.step())
+      continue;
     const type& lhs_type = for_variable->get_bind_type();
     const type& rhs_type = step_tv->get_type();
     std::size_t step_diag_report_loc = s->has_step() ? s->get_step_loc()
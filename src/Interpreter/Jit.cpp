@@ -0,0 +1,427 @@
+#include <Interpret/Jit.h>
+#include <Interpret/InternalSupport/InternalImpl.h>
+#include <Sema/IdentifierInfo.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define DRAWING_HAS_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+INTERPRETER_NAMESPACE_BEGIN
+
+jit_function::jit_function(jit_function&& other) noexcept
+  : _memory(other._memory), _size(other._size), _entry(other._entry) {
+  other._memory = nullptr;
+  other._size = 0;
+  other._entry = nullptr;
+}
+
+jit_function& jit_function::operator=(jit_function&& other) noexcept {
+  std::swap(_memory, other._memory);
+  std::swap(_size, other._size);
+  std::swap(_entry, other._entry);
+  return *this;
+}
+
+jit_function::~jit_function() {
+#ifdef DRAWING_HAS_JIT
+  if (_memory)
+    munmap(_memory, _size);
+#endif
+}
+
+namespace {
+/**
+ * Whether a value is an Integer, which decides whether the result of
+ * the next arithmetic operator is checked and converted to an Integer
+ * (see @code{sema::_binary_on_basic_num_type}). If it is only known at
+ * runtime, it is stored in @code{r12d}.
+ */
+enum class int_flag { no, yes, dynamic };
+
+FLOAT_POINT_T _pow(FLOAT_POINT_T x, FLOAT_POINT_T y) {
+  return std::pow(x, y);
+}
+
+std::uint64_t _bits_of(FLOAT_POINT_T value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+internal_impl::native_math_func_t _get_math_function(const call_expr* e) {
+  if (!e->has_bind_info() || e->get_param_count() != 1)
+    return nullptr;
+  const function_info& info = e->get_bind_func();
+  if (info.get_param_type(0).is_not(type::FLOAT_POINT) || info.get_ret_type().is_not(type::FLOAT_POINT))
+    return nullptr;
+  return internal_impl::get_native_math_function(e->get_func_name());
+}
+
+/**
+ * Generates the code of a function with the signature
+ *
+ *   int f(FLOAT_POINT_T* out)
+ *
+ * The value of each expression is computed in @code{xmm0}. The left
+ * operand of a binary operator is spilled to a stack slot while the
+ * right operand is computed, since the calls may clobber all the xmm
+ * registers. @code{rbx} holds @code{out} and @code{r12d} holds the
+ * dynamic integer flag, which are both preserved by the calls.
+ *
+ * Stack frame:
+ *   [rbp - 8]            saved rbx
+ *   [rbp - 16]           saved r12
+ *   [rbp - 32 - 16 * k]  the value of slot k
+ *   [rbp - 24 - 16 * k]  the integer flag of slot k
+ */
+class jit_codegen {
+public:
+  jit_codegen() {
+    _emit({ 0x55 });                          // push rbp
+    _emit({ 0x48, 0x89, 0xE5 });              // mov rbp, rsp
+    _emit({ 0x53 });                          // push rbx
+    _emit({ 0x41, 0x54 });                    // push r12
+    _emit({ 0x48, 0x81, 0xEC });              // sub rsp, imm32
+    _frame_size_pos = _code.size();
+    _emit_imm32(0);
+    _emit({ 0x48, 0x89, 0xFB });              // mov rbx, rdi
+  }
+
+  void store_to_out(const expr* e, std::size_t index) {
+    _normalize_integer(_gen(e));
+    _emit({ 0xF2, 0x0F, 0x11, 0x83 });        // movsd [rbx + disp32], xmm0
+    _emit_imm32(static_cast<std::int32_t>(index * sizeof(FLOAT_POINT_T)));
+  }
+
+  void store_to_address(const expr* e, FLOAT_POINT_T* target) {
+    _normalize_integer(_gen(e));
+    _mov_rax(reinterpret_cast<std::uintptr_t>(target));
+    _emit({ 0xF2, 0x0F, 0x11, 0x00 });        // movsd [rax], xmm0
+  }
+
+  /**
+   * Emits the epilogue and returns the machine code of the function.
+   */
+  const std::vector<unsigned char>& finish();
+private:
+  std::vector<unsigned char> _code;
+  std::size_t _frame_size_pos;
+  /**
+   * The positions of the rel32 operands of the jumps to the failure exit.
+   */
+  std::vector<std::size_t> _fail_jumps;
+  std::size_t _depth = 0, _max_depth = 0;
+
+  void _emit(std::initializer_list<unsigned char> bytes) {
+    _code.insert(_code.end(), bytes);
+  }
+
+  void _emit_imm32(std::int32_t value) {
+    unsigned char bytes[4];
+    std::memcpy(bytes, &value, sizeof(bytes));
+    _code.insert(_code.end(), bytes, bytes + 4);
+  }
+
+  void _mov_rax(std::uint64_t value) {
+    _emit({ 0x48, 0xB8 });                    // mov rax, imm64
+    unsigned char bytes[8];
+    std::memcpy(bytes, &value, sizeof(bytes));
+    _code.insert(_code.end(), bytes, bytes + 8);
+  }
+
+  void _jump_to_fail(std::initializer_list<unsigned char> opcode) {
+    _emit(opcode);
+    _fail_jumps.push_back(_code.size());
+    _emit_imm32(0);
+  }
+
+  void _call(std::uintptr_t func) {
+    _mov_rax(func);
+    _emit({ 0xFF, 0xD0 });                    // call rax
+  }
+
+  static std::int32_t _slot_value(std::size_t slot) {
+    return -32 - 16 * static_cast<std::int32_t>(slot);
+  }
+
+  static std::int32_t _slot_flag(std::size_t slot) {
+    return -24 - 16 * static_cast<std::int32_t>(slot);
+  }
+
+  /**
+   * Fails if xmm0 is not finite.
+   */
+  void _check_finite() {
+    _emit({ 0x66, 0x0F, 0x28, 0xC8 });        // movapd xmm1, xmm0
+    _mov_rax(0x7FFFFFFFFFFFFFFFull);
+    _emit({ 0x66, 0x48, 0x0F, 0x6E, 0xD0 });  // movq xmm2, rax
+    _emit({ 0x66, 0x0F, 0x54, 0xCA });        // andpd xmm1, xmm2
+    _mov_rax(_bits_of(std::numeric_limits<FLOAT_POINT_T>::max()));
+    _emit({ 0x66, 0x48, 0x0F, 0x6E, 0xD0 });  // movq xmm2, rax
+    _emit({ 0x66, 0x0F, 0x2E, 0xD1 });        // ucomisd xmm2, xmm1
+    _jump_to_fail({ 0x0F, 0x82 });            // jb fail (also for NaN)
+  }
+
+  /**
+   * Checks whether xmm0 is an Integer, which requires the operands to be
+   * Integers (which is given in r12d if @param{dynamic}) and the value to
+   * be representable by an Integer. The result is saved in r12d.
+   */
+  void _check_integer(bool dynamic) {
+    _emit({ 0xF2, 0x0F, 0x2C, 0xC0 });        // cvttsd2si eax, xmm0
+    _emit({ 0xF2, 0x0F, 0x2A, 0xD0 });        // cvtsi2sd xmm2, eax
+    _emit({ 0x66, 0x0F, 0x2E, 0xC2 });        // ucomisd xmm0, xmm2
+    _emit({ 0x0F, 0x94, 0xC0 });              // sete al
+    _emit({ 0x0F, 0x9B, 0xC1 });              // setnp cl
+    _emit({ 0x20, 0xC8 });                    // and al, cl
+    if (dynamic)
+      _emit({ 0x44, 0x20, 0xE0 });            // and al, r12b
+    _emit({ 0x44, 0x0F, 0xB6, 0xE0 });        // movzx r12d, al
+  }
+
+  /**
+   * Converts an Integer in @code{xmm0} to @code{INTEGER_T} and back, as
+   * the interpreter does when it leaves an arithmetic expression, which
+   * turns -0 into 0.
+   */
+  void _normalize_integer(int_flag flag) {
+    if (flag == int_flag::no)
+      return;
+    if (flag == int_flag::dynamic) {
+      _emit({ 0x45, 0x85, 0xE4 });            // test r12d, r12d
+      _emit({ 0x74, 0x08 });                  // jz +8
+    }
+    _emit({ 0xF2, 0x0F, 0x2C, 0xC0 });        // cvttsd2si eax, xmm0
+    _emit({ 0xF2, 0x0F, 0x2A, 0xC0 });        // cvtsi2sd xmm0, eax
+  }
+
+  int_flag _gen(const expr* e);
+  int_flag _gen_binary(const binary_expr* e);
+  int_flag _gen_unary(const unary_expr* e);
+};
+
+int_flag jit_codegen::_gen(const expr* e) {
+  switch (e->get_stmt_kind()) {
+    case stmt::num_expr_type: {
+      auto* num = static_cast<const num_expr*>(e);
+      _mov_rax(_bits_of(num->get_value()));
+      _emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC0 }); // movq xmm0, rax
+      return e->get_inferred_kind() == expr::ik_integer ? int_flag::yes : int_flag::no;
+    }
+    case stmt::variable_expr_type: {
+      const variable_info& info = static_cast<const variable_expr*>(e)->get_bind_info();
+      _mov_rax(reinterpret_cast<std::uintptr_t>(info.get_value_address()));
+      if (info.get_type().is(type::INTEGER)) {
+        _emit({ 0xF2, 0x0F, 0x2A, 0x00 });    // cvtsi2sd xmm0, dword [rax]
+        return int_flag::yes;
+      }
+      _emit({ 0xF2, 0x0F, 0x10, 0x00 });      // movsd xmm0, [rax]
+      return int_flag::no;
+    }
+    case stmt::binary_expr_type:
+      return _gen_binary(static_cast<const binary_expr*>(e));
+    case stmt::unary_expr_type:
+      return _gen_unary(static_cast<const unary_expr*>(e));
+    case stmt::call_expr_type: {
+      auto* call = static_cast<const call_expr*>(e);
+      _normalize_integer(_gen(call->get_arg_expr(0)));
+      _call(reinterpret_cast<std::uintptr_t>(_get_math_function(call)));
+      // The predefined function makes a diagnostic for the result.
+      _check_finite();
+      return int_flag::no;
+    }
+    default:
+      assert(false);
+      return int_flag::no;
+  }
+}
+
+int_flag jit_codegen::_gen_binary(const binary_expr* e) {
+  int_flag lhs = _gen(e->get_lhs());
+  std::size_t slot = _depth++;
+  _max_depth = std::max(_max_depth, _depth);
+  _emit({ 0xF2, 0x0F, 0x11, 0x85 });          // movsd [rbp + disp32], xmm0
+  _emit_imm32(_slot_value(slot));
+  if (lhs == int_flag::dynamic) {
+    _emit({ 0x44, 0x89, 0xA5 });              // mov [rbp + disp32], r12d
+    _emit_imm32(_slot_flag(slot));
+  }
+  int_flag rhs = _gen(e->get_rhs());
+  _emit({ 0x66, 0x0F, 0x28, 0xC8 });          // movapd xmm1, xmm0
+  _emit({ 0xF2, 0x0F, 0x10, 0x85 });          // movsd xmm0, [rbp + disp32]
+  _emit_imm32(_slot_value(slot));
+
+  // Decide whether the result should be checked to be an Integer, and
+  // save it in r12d if it is only known at runtime.
+  int_flag should_check;
+  if (e->get_op_kind() == binary_expr::bo_pow) {
+    // See sema::_binary_on_basic_num_type.
+    should_check = lhs;
+    if (lhs == int_flag::dynamic) {
+      _emit({ 0x44, 0x8B, 0xA5 });            // mov r12d, [rbp + disp32]
+      _emit_imm32(_slot_flag(slot));
+    }
+  } else if (lhs == int_flag::no || rhs == int_flag::no) {
+    should_check = int_flag::no;
+  } else if (lhs == int_flag::yes) {
+    should_check = rhs;
+  } else {
+    should_check = int_flag::dynamic;
+    if (rhs == int_flag::yes)
+      _emit({ 0x44, 0x8B, 0xA5 });            // mov r12d, [rbp + disp32]
+    else
+      _emit({ 0x44, 0x23, 0xA5 });            // and r12d, [rbp + disp32]
+    _emit_imm32(_slot_flag(slot));
+  }
+  --_depth;
+
+  switch (e->get_op_kind()) {
+    case binary_expr::bo_add:
+      _emit({ 0xF2, 0x0F, 0x58, 0xC1 });      // addsd xmm0, xmm1
+      break;
+    case binary_expr::bo_sub:
+      _emit({ 0xF2, 0x0F, 0x5C, 0xC1 });      // subsd xmm0, xmm1
+      break;
+    case binary_expr::bo_mul:
+      _emit({ 0xF2, 0x0F, 0x59, 0xC1 });      // mulsd xmm0, xmm1
+      break;
+    case binary_expr::bo_div:
+      // The interpreter warns about the division by zero.
+      _emit({ 0x66, 0x0F, 0x57, 0xD2 });      // xorpd xmm2, xmm2
+      _emit({ 0x66, 0x0F, 0x2E, 0xCA });      // ucomisd xmm1, xmm2
+      _jump_to_fail({ 0x0F, 0x84 });          // je fail
+      _emit({ 0xF2, 0x0F, 0x5E, 0xC1 });      // divsd xmm0, xmm1
+      break;
+    case binary_expr::bo_pow:
+      _call(reinterpret_cast<std::uintptr_t>(&_pow));
+      break;
+    default:
+      assert(false);
+  }
+  _check_finite();
+  if (should_check == int_flag::no)
+    return int_flag::no;
+  _check_integer(should_check == int_flag::dynamic);
+  // The interpreter converts every Integer result, so -0 never reaches
+  // the next operation.
+  _normalize_integer(int_flag::dynamic);
+  return int_flag::dynamic;
+}
+
+int_flag jit_codegen::_gen_unary(const unary_expr* e) {
+  int_flag operand = _gen(e->get_operand());
+  if (e->get_op_kind() == unary_expr::uo_plus)
+    return operand;
+  assert(e->get_op_kind() == unary_expr::uo_minus);
+  _mov_rax(0x8000000000000000ull);
+  _emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC8 });    // movq xmm1, rax
+  _emit({ 0x66, 0x0F, 0x57, 0xC1 });          // xorpd xmm0, xmm1
+  if (operand == int_flag::no)
+    return int_flag::no;
+  _check_integer(operand == int_flag::dynamic);
+  _normalize_integer(int_flag::dynamic);
+  return int_flag::dynamic;
+}
+
+const std::vector<unsigned char>& jit_codegen::finish() {
+  std::int32_t frame_size = static_cast<std::int32_t>(16 * _max_depth);
+  std::memcpy(_code.data() + _frame_size_pos, &frame_size, sizeof(frame_size));
+  _emit({ 0xB8, 0x01, 0x00, 0x00, 0x00 });    // mov eax, 1
+  _emit({ 0xEB, 0x02 });                      // jmp +2
+  std::size_t fail_pos = _code.size();
+  _emit({ 0x31, 0xC0 });                      // fail: xor eax, eax
+  _emit({ 0x4C, 0x8B, 0x65, 0xF0 });          // mov r12, [rbp - 16]
+  _emit({ 0x48, 0x8B, 0x5D, 0xF8 });          // mov rbx, [rbp - 8]
+  _emit({ 0xC9 });                            // leave
+  _emit({ 0xC3 });                            // ret
+  for (std::size_t pos : _fail_jumps) {
+    auto rel = static_cast<std::int32_t>(fail_pos - (pos + 4));
+    std::memcpy(_code.data() + pos, &rel, sizeof(rel));
+  }
+  return _code;
+}
+} // namespace
+
+bool jit_compiler::is_supported() {
+#ifdef DRAWING_HAS_JIT
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool jit_compiler::can_compile(const expr* e) {
+  assert(e);
+  expr::inferred_kind kind = e->get_inferred_kind();
+  if (kind != expr::ik_integer && kind != expr::ik_float_point && kind != expr::ik_number)
+    return false;
+  switch (e->get_stmt_kind()) {
+    case stmt::num_expr_type:
+      return true;
+    case stmt::variable_expr_type: {
+      auto* var = static_cast<const variable_expr*>(e);
+      return var->has_bind_info() && var->get_bind_info().get_value_address();
+    }
+    case stmt::binary_expr_type: {
+      auto* binary = static_cast<const binary_expr*>(e);
+      return can_compile(binary->get_lhs()) && can_compile(binary->get_rhs());
+    }
+    case stmt::unary_expr_type:
+      return can_compile(static_cast<const unary_expr*>(e)->get_operand());
+    case stmt::call_expr_type: {
+      auto* call = static_cast<const call_expr*>(e);
+      return _get_math_function(call) && can_compile(call->get_arg_expr(0));
+    }
+    default:
+      return false;
+  }
+}
+
+std::optional<jit_function> jit_compiler::compile_values(const std::vector<expr*>& exprs) {
+  if (!is_supported() || !std::all_of(exprs.begin(), exprs.end(), &can_compile))
+    return std::nullopt;
+  jit_codegen codegen;
+  for (std::size_t i = 0; i < exprs.size(); ++i)
+    codegen.store_to_out(exprs[i], i);
+  return _load(codegen.finish());
+}
+
+std::optional<jit_function> jit_compiler::compile_assignment(expr* value, FLOAT_POINT_T* target) {
+  if (!is_supported() || !can_compile(value))
+    return std::nullopt;
+  jit_codegen codegen;
+  codegen.store_to_address(value, target);
+  return _load(codegen.finish());
+}
+
+std::optional<jit_function> jit_compiler::_load(const std::vector<unsigned char>& code) {
+#ifdef DRAWING_HAS_JIT
+  auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  std::size_t size = (code.size() + page_size - 1) / page_size * page_size;
+  void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED)
+    return std::nullopt;
+  std::memcpy(memory, code.data(), code.size());
+  if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(memory, size);
+    return std::nullopt;
+  }
+  jit_function result;
+  result._memory = memory;
+  result._size = size;
+  result._entry = reinterpret_cast<jit_function::entry_t>(memory);
+  return result;
+#else
+  (void)code;
+  return std::nullopt;
+#endif
+}
+
+INTERPRETER_NAMESPACE_END
@@ -0,0 +1,295 @@
+/**
+ * This file provides implementation of @code{render_server} interfaces.
+ *
+ * @author 19030500131 zy
+ */
+#include <Interpret/Serve.h>
+#include <Diagnostic/DiagConsumer.h>
+#include <Lex/Lexer.h>
+#include <Parse/Parser.h>
+#include <algorithm>
+#include <sstream>
+#include <streambuf>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DRAWING_HAS_UNIX_SOCKET
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+/**
+ * The stream buffer which appends the characters to a string, and drops
+ * them after the string reaches @code{render_server::max_output_size}.
+ */
+class limited_buffer final : public std::streambuf {
+public:
+  explicit limited_buffer(std::string& data) : _data(data) { }
+protected:
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      char ch = traits_type::to_char_type(c);
+      xsputn(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+  }
+  std::streamsize xsputn(const char* s, std::streamsize count) override {
+    std::size_t room = render_server::max_output_size - _data.size();
+    _data.append(s, std::min(room, static_cast<std::size_t>(count)));
+    return count;
+  }
+private:
+  std::string& _data;
+};
+} // namespace
+
+render_context::render_context() {
+  _internal.export_all_symbols(_table);
+  _internal.set_max_canvas_area(render_server::max_canvas_area);
+}
+
+render_result render_context::run(std::string_view program, std::chrono::milliseconds timeout) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  render_result result;
+  limited_buffer output_buffer(result.output), diagnostics_buffer(result.diagnostics);
+  std::ostream output(&output_buffer), diagnostics(&diagnostics_buffer);
+  stream_diag_consumer consumer(diagnostics);
+  diag_engine diag;
+  diag.set_consumer(&consumer);
+  file_manager source;
+  source.from_buffer(program.data(), program.size(), { });
+  diag.set_file(&source);
+  _internal.capture_output(output, result.image);
+
+  sema action(diag, _table);
+  lexer l(&source, diag);
+  parser p(l);
+  auto ast = p.parse_program();
+  interpreter runner(action, _internal);
+  runner.set_deadline(deadline);
+  runner.run_stmts(ast);
+  if (runner.is_timed_out()) {
+    result.status = "timeout";
+    diag.create_diag(err_run_timeout) << std::to_string(timeout.count()) << diag_build_finish;
+  } else if (consumer.has_error()) {
+    result.status = "error";
+  }
+  // The program which never saves the picture returns the final one.
+  if (result.image.empty())
+    _internal.encode_picture("picture.ppm", result.image);
+  return result;
+}
+
+render_server::render_server(std::string socket_path, std::size_t workers,
+                             std::chrono::milliseconds timeout)
+  : _path(std::move(socket_path)), _workers(workers), _timeout(timeout) { }
+
+render_server::~render_server() {
+  stop();
+}
+
+bool render_server::start() {
+#ifdef DRAWING_HAS_UNIX_SOCKET
+  sockaddr_un address{ };
+  address.sun_family = AF_UNIX;
+  if (_path.size() >= sizeof(address.sun_path))
+    return false;
+  std::memcpy(address.sun_path, _path.c_str(), _path.size() + 1);
+  auto* name = reinterpret_cast<const sockaddr*>(&address);
+  // The socket file of a server which has exited refuses the
+  // connections, and is replaced. A server still running keeps it.
+  struct stat info{ };
+  if (lstat(_path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool running = probe >= 0 && connect(probe, name, sizeof(address)) == 0;
+    if (probe >= 0)
+      close(probe);
+    if (!running)
+      unlink(_path.c_str());
+  }
+  _socket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (_socket < 0)
+    return false;
+  if (bind(_socket, name, sizeof(address)) != 0 || listen(_socket, SOMAXCONN) != 0) {
+    close(_socket);
+    _socket = -1;
+    return false;
+  }
+  _stopping = false;
+  for (std::size_t i = 0; i < _workers; ++i)
+    _threads.emplace_back([this] { _work(); });
+  return true;
+#else
+  return false;
+#endif
+}
+
+void render_server::wait() {
+  std::lock_guard<std::mutex> lock(_join_mutex);
+  for (std::thread& thread : _threads)
+    thread.join();
+  _threads.clear();
+}
+
+void render_server::stop() {
+#ifdef DRAWING_HAS_UNIX_SOCKET
+  if (_socket < 0)
+    return;
+  // Shutting down the socket wakes up the workers waiting for requests.
+  _stopping = true;
+  shutdown(_socket, SHUT_RDWR);
+  wait();
+  close(_socket);
+  _socket = -1;
+  unlink(_path.c_str());
+#endif
+}
+
+void render_server::_work() {
+#ifdef DRAWING_HAS_UNIX_SOCKET
+  while (true) {
+    // Prepare the next request while waiting for it.
+    render_context context;
+    int client = accept(_socket, nullptr, nullptr);
+    while (client < 0) {
+      if (_stopping || errno == EBADF || errno == EINVAL || errno == ENOTSOCK)
+        return;
+      // Wait a bit if the server runs out of the file descriptors.
+      if (errno != EINTR && errno != ECONNABORTED)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      client = accept(_socket, nullptr, nullptr);
+    }
+    serve_connection(client, context, _timeout);
+    close(client);
+  }
+#endif
+}
+
+#ifdef DRAWING_HAS_UNIX_SOCKET
+namespace {
+using clock_type = std::chrono::steady_clock;
+
+/**
+ * Waits until @param{fd} is ready for @param{events}. Returns false if
+ * the @param{deadline} passes first.
+ */
+bool wait_ready(int fd, short events, clock_type::time_point deadline) {
+  while (true) {
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - clock_type::now());
+    if (left.count() <= 0)
+      return false;
+    pollfd target{ fd, events, 0 };
+    // The broken connection is ready as well, and recv or send reports it.
+    int ready = poll(&target, 1, static_cast<int>(std::min<long long>(left.count(), INT_MAX)));
+    if (ready > 0)
+      return true;
+    if (ready < 0 && errno != EINTR)
+      return false;
+  }
+}
+
+bool send_all(int fd, const std::string& data, clock_type::time_point deadline) {
+#ifdef MSG_NOSIGNAL
+  // The server is not killed by SIGPIPE if the client goes away.
+  constexpr int flags = MSG_NOSIGNAL;
+#else
+  constexpr int flags = 0;
+#endif
+  for (std::size_t sent = 0; sent < data.size();) {
+    if (!wait_ready(fd, POLLOUT, deadline))
+      return false;
+    ssize_t length = send(fd, data.data() + sent, data.size() - sent, flags);
+    if (length < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    sent += static_cast<std::size_t>(length);
+  }
+  return true;
+}
+
+/**
+ * Returns the reply of a program which fails with the diagnostic
+ * @param{id} of @param{arg}, without its output and picture.
+ */
+render_result failed_result(diag_id id, const std::string& arg) {
+  render_result result;
+  result.status = "error";
+  std::ostringstream diagnostics;
+  stream_diag_consumer consumer(diagnostics);
+  diag_engine diag;
+  diag.set_consumer(&consumer);
+  diag.create_diag(id) << arg << diag_build_finish;
+  result.diagnostics = diagnostics.str();
+  return result;
+}
+} // namespace
+#endif
+
+bool serve_connection(int fd, render_context& context, std::chrono::milliseconds timeout) {
+#ifdef DRAWING_HAS_UNIX_SOCKET
+  // The reading and the writing share the time limit, so a slow client
+  // cannot hold the worker by sending or reading a byte at a time.
+  auto deadline = clock_type::now() + timeout;
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+  std::string program;
+  bool too_large = false;
+  char buf[65536];
+  while (true) {
+    if (!wait_ready(fd, POLLIN, deadline))
+      return false;
+    ssize_t length = recv(fd, buf, sizeof(buf), 0);
+    if (length == 0)
+      break;
+    if (length < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (program.size() + static_cast<std::size_t>(length) > render_server::max_program_size) {
+      too_large = true;
+      break;
+    }
+    program.append(buf, static_cast<std::size_t>(length));
+  }
+  render_result result;
+  if (too_large) {
+    result = failed_result(err_program_too_large, std::to_string(render_server::max_program_size));
+  } else {
+    auto start = clock_type::now();
+    // A program which fails inside the interpreter, e.g. runs out of
+    // memory, only fails its own request.
+    try {
+      result = context.run(program, timeout);
+    } catch (const std::exception& e) {
+      result = failed_result(err_run_failed, e.what());
+    } catch (...) {
+      result = failed_result(err_run_failed, "unknown exception");
+    }
+    // The running time is limited separately.
+    deadline += clock_type::now() - start;
+  }
+  std::string header = result.status + ' ' + std::to_string(result.output.size()) + ' ' +
+                       std::to_string(result.diagnostics.size()) + ' ' +
+                       std::to_string(result.image.size()) + '\n';
+  return send_all(fd, header, deadline) && send_all(fd, result.output, deadline) &&
+         send_all(fd, result.diagnostics, deadline) && send_all(fd, result.image, deadline);
+#else
+  return false;
+#endif
+}
+
+INTERPRETER_NAMESPACE_END
@@ -0,0 +1,224 @@
+/**
+ * This file provides implementation of @code{parameter_sweep} interfaces.
+ *
+ * @author 19030500131 zy
+ */
+#include <Interpret/Sweep.h>
+#include <Interpret/Effects.h>
+#include <Diagnostic/DiagConsumer.h>
+#include <Lex/Lexer.h>
+#include <Parse/Parser.h>
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+string_ref get_assigned_name(const stmt* s) {
+  auto* assignment = static_cast<const assignment_stmt*>(s);
+  return static_cast<const variable_expr*>(assignment->get_assignment_lhs())->get_name();
+}
+
+bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+} // namespace
+
+/**
+ * The state after the common prefix, which each variant starts from.
+ */
+struct parameter_sweep::_fork_state {
+  struct variable {
+    std::string name;
+    type var_type;
+    std::any value;
+  };
+  std::shared_ptr<const internal_impl::snapshot> internal;
+  std::vector<variable> variables;
+};
+
+parameter_sweep::parameter_sweep(diag_engine& diag, const file_manager& program,
+                                 const file_manager& sweep)
+  : _diag(diag), _program(program), _sweep(sweep) {
+  // The path of each variant is replaced with spaces, so the rest of the
+  // sweep file is parsed as a program with the same locations.
+  std::string& text = _sweep_text;
+  text.assign(sweep.get_file_buf_begin(), sweep.get_file_buf_end());
+  std::vector<std::size_t> line_starts;
+  for (std::size_t begin = 0; begin < text.size();) {
+    std::size_t end = text.find('\n', begin);
+    if (end == std::string::npos)
+      end = text.size();
+    std::size_t path = begin;
+    while (path < end && is_space(text[path]))
+      ++path;
+    std::size_t path_end = path;
+    while (path_end < end && !is_space(text[path_end]))
+      ++path_end;
+    std::string word = text.substr(path, path_end - path);
+    if (!word.empty() && word.compare(0, 2, "--") != 0 && word.compare(0, 2, "//") != 0) {
+      _variants.push_back({ std::move(word), { } });
+      line_starts.push_back(begin);
+      std::fill(text.begin() + path, text.begin() + path_end, ' ');
+    }
+    begin = end + 1;
+  }
+  _diag.set_file(&sweep);
+  lexer sweep_lexer(text.data(), text.data() + text.size(), _diag);
+  parser sweep_parser(sweep_lexer);
+  for (stmt_result_t& s : sweep_parser.parse_program()) {
+    if (!s)
+      continue;
+    if (s->get_stmt_kind() != stmt::assignment_stmt_type) {
+      _diag.create_diag(err_sweep_stmt, s->get_start_loc(), s->get_end_loc()) << diag_build_finish;
+      continue;
+    }
+    // The statement belongs to the variant of the line where it starts.
+    auto line = std::upper_bound(line_starts.begin(), line_starts.end(), s->get_start_loc());
+    _variants[line - line_starts.begin() - 1].assignments.push_back(std::move(s));
+  }
+
+  _diag.set_file(&program);
+  lexer program_lexer(&program, _diag);
+  parser program_parser(program_lexer);
+  _ast = program_parser.parse_program();
+  std::vector<string_ref> parameters;
+  for (const variant& v : _variants) {
+    for (const stmt_result_t& s : v.assignments)
+      parameters.push_back(get_assigned_name(s.get()));
+  }
+  std::sort(parameters.begin(), parameters.end());
+  parameters.erase(std::unique(parameters.begin(), parameters.end()), parameters.end());
+  std::vector<string_ref> defined;
+  for (std::size_t i = 0; i < _ast.size(); ++i) {
+    if (!_ast[i] || _ast[i]->get_stmt_kind() != stmt::assignment_stmt_type)
+      continue;
+    string_ref name = get_assigned_name(_ast[i].get());
+    if (std::binary_search(parameters.begin(), parameters.end(), name) &&
+        std::find(defined.begin(), defined.end(), name) == defined.end()) {
+      _definitions.emplace(i, name.str());
+      defined.push_back(name);
+    }
+  }
+  // The prefix is empty if a parameter is assigned in front of the
+  // program.
+  if (parameters.empty())
+    _prefix_length = _ast.size();
+  else if (defined.size() == parameters.size())
+    _prefix_length = _definitions.begin()->first;
+}
+
+parameter_sweep::~parameter_sweep() = default;
+
+std::vector<parameter_sweep::result> parameter_sweep::run(std::size_t threads) {
+  symbol_table table;
+  internal_impl internal;
+  internal.export_all_symbols(table);
+  sema action(_diag, table);
+  interpreter runner(action, internal);
+  if (_jit)
+    runner.enable_jit();
+  _diag.set_file(&_program);
+  stmt_effects effects;
+  for (std::size_t i = 0; i < _prefix_length; ++i) {
+    if (!_ast[i])
+      continue;
+    runner.visit(_ast[i].get());
+    effects.add(_ast[i].get());
+  }
+
+  _fork_state state;
+  state.internal = internal.take_snapshot();
+  for (string_ref name : effects.get_writes()) {
+    if (internal_impl::is_predefined_variable(name))
+      continue;
+    // The variable is not created if the assignment fails.
+    variable_info* info = table.get_variable(name);
+    bool saved = std::any_of(state.variables.begin(), state.variables.end(),
+                             [name](const _fork_state::variable& v) { return v.name == name; });
+    if (info && !saved)
+      state.variables.push_back({ name.str(), info->get_type(), info->get_value() });
+  }
+
+  std::vector<result> results(_variants.size());
+  std::atomic<std::size_t> next = 0;
+  auto work = [&] {
+    for (std::size_t i; (i = next++) < _variants.size();)
+      results[i] = _run_variant(_variants[i], state);
+  };
+  std::vector<std::thread> workers;
+  for (std::size_t i = 1; i < std::min(threads, _variants.size()); ++i)
+    workers.emplace_back(work);
+  work();
+  for (std::thread& worker : workers)
+    worker.join();
+  return results;
+}
+
+parameter_sweep::result parameter_sweep::_run_variant(variant& v, const _fork_state& state) const {
+  result r;
+  std::ostringstream output, diagnostics;
+  stream_diag_consumer consumer(diagnostics);
+  diag_engine diag;
+  diag.set_consumer(&consumer);
+  // The program is parsed again, since running the statements binds them
+  // to the variables of the variant. The errors have been reported.
+  ignore_diag_consumer ignore;
+  diag_engine parse_diag;
+  parse_diag.set_consumer(&ignore);
+  parse_diag.set_file(&_program);
+  lexer l(&_program, parse_diag);
+  parser p(l);
+  std::vector<stmt_result_t> stmts = p.parse_program();
+
+  symbol_table table;
+  internal_impl internal;
+  internal.export_all_symbols(table);
+  sema action(diag, table);
+  for (const auto& variable : state.variables)
+    (void)action.add_new_variable(typed_value(variable.var_type, variable.value), variable.name);
+  internal.restore(*state.internal);
+  std::string saved_image;
+  internal.capture_output(output, saved_image);
+  interpreter runner(action, internal);
+  if (_jit)
+    runner.enable_jit();
+
+  // Runs the assignments of the variant to the parameters which
+  // @param{replaced} returns true for.
+  auto assign = [&](auto replaced) {
+    bool found = false;
+    diag.set_file(&_sweep);
+    for (stmt_result_t& s : v.assignments) {
+      if (replaced(get_assigned_name(s.get()))) {
+        runner.visit(s.get());
+        found = true;
+      }
+    }
+    diag.set_file(&_program);
+    return found;
+  };
+  assign([this](string_ref name) {
+    return std::none_of(_definitions.begin(), _definitions.end(),
+                        [name](const auto& definition) { return definition.second == name; });
+  });
+  for (std::size_t i = _prefix_length; i < stmts.size(); ++i) {
+    if (!stmts[i])
+      continue;
+    // The definition of a parameter which the variant does not assign
+    // runs as usual.
+    auto definition = _definitions.find(i);
+    if (definition != _definitions.end() &&
+        assign([&definition](string_ref name) { return name == definition->second; }))
+      continue;
+    runner.visit(stmts[i].get());
+  }
+  r.written = internal.write_picture(v.image_path);
+  r.output = output.str();
+  r.diagnostics = diagnostics.str();
+  return r;
+}
+
+INTERPRETER_NAMESPACE_END
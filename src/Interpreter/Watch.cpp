@@ -0,0 +1,240 @@
+/**
+ * This file provides implementation of @code{watch_session} interfaces.
+ *
+ * @author 19030500131 zy
+ */
+#include <Interpret/Watch.h>
+#include <Interpret/Effects.h>
+#include <Lex/Lexer.h>
+#include <Parse/Parser.h>
+#include <iterator>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+INTERPRETER_NAMESPACE_BEGIN
+
+struct watch_session::_checkpoint {
+  struct variable {
+    std::string name;
+    type var_type;
+    std::any value;
+  };
+  std::shared_ptr<const internal_impl::snapshot> internal;
+  /**
+   * The runtime variables. The keys refer to the names in the values,
+   * which are shared with the other checkpoints.
+   */
+  std::map<string_ref, std::shared_ptr<const variable>> variables;
+};
+
+watch_session::watch_session(diag_engine& diag) : _diag(diag) {
+  _checkpoints.emplace(0, std::make_shared<const _checkpoint>(
+      _checkpoint{ _internal.take_snapshot(), {} }));
+}
+
+watch_session::~watch_session() = default;
+
+namespace {
+/**
+ * Returns true if @param{a} in @param{a_source} is spelled the same as
+ * @param{b} in @param{b_source}. A broken statement is never the same.
+ */
+bool is_same_stmt(const stmt* a, const file_manager& a_source,
+                  const stmt* b, const file_manager& b_source) {
+  if (!a || !b)
+    return false;
+  return string_ref(a_source.get_file_buf_begin() + a->get_start_loc(),
+                    a->get_end_loc() - a->get_start_loc()) ==
+         string_ref(b_source.get_file_buf_begin() + b->get_start_loc(),
+                    b->get_end_loc() - b->get_start_loc());
+}
+} // namespace
+
+std::size_t watch_session::run(std::unique_ptr<file_manager> source) {
+  _diag.set_file(source.get());
+  lexer l(source.get(), _diag);
+  parser p(l);
+  std::vector<stmt_result_t> program = p.parse_program();
+  std::size_t changed = 0;
+  while (changed < program.size() && changed < _program.size() &&
+         is_same_stmt(program[changed].get(), *source, _program[changed].get(), *_source))
+    ++changed;
+
+  // Restore the last checkpoint in front of the changed statement, and
+  // drop the ones after it.
+  auto restored = std::prev(_checkpoints.upper_bound(changed));
+  _checkpoints.erase(std::next(restored), _checkpoints.end());
+  std::size_t first = restored->first;
+  _runner.reset();
+  _action.reset();
+  _table = std::make_unique<symbol_table>();
+  _program = std::move(program);
+  _source = std::move(source);
+  _restored = restored->second;
+  _internal.export_all_symbols(*_table);
+  _action = std::make_unique<sema>(_diag, *_table);
+  for (const auto& [name, variable] : _restored->variables)
+    (void)_action->add_new_variable(typed_value(variable->var_type, variable->value), name);
+  _internal.restore(*_restored->internal);
+  _dirty.clear();
+
+  _runner = std::make_unique<interpreter>(*_action, _internal);
+  if (_jit)
+    _runner->enable_jit();
+  _runner->enable_parallel(_threads);
+  _runner->run_stmts(_program, first, [this](std::size_t index) { _after_stmt(index); });
+  return first;
+}
+
+void watch_session::_after_stmt(std::size_t index) {
+  if (_program[index]) {
+    stmt_effects effects;
+    effects.add(_program[index].get());
+    const auto& writes = effects.get_writes();
+    _dirty.insert(_dirty.end(), writes.begin(), writes.end());
+  }
+  // The checkpoint after the last statement is always taken, since new
+  // statements are often added to the end.
+  if ((index + 1) % _stride == 0 || index + 1 == _program.size())
+    _take_checkpoint(index + 1);
+}
+
+void watch_session::_take_checkpoint(std::size_t index) {
+  auto result = std::make_shared<_checkpoint>();
+  result->internal = _internal.take_snapshot();
+  result->variables = _checkpoints.rbegin()->second->variables;
+  for (string_ref name : _dirty) {
+    if (internal_impl::is_predefined_variable(name))
+      continue;
+    // The variable is not created if the assignment fails.
+    variable_info* info = _table->get_variable(name);
+    if (!info)
+      continue;
+    auto variable = std::make_shared<const _checkpoint::variable>(
+        _checkpoint::variable{ name.str(), info->get_type(), info->get_value() });
+    // The old key refers to the old value, so it is replaced as well.
+    result->variables.erase(name);
+    result->variables.emplace(variable->name, std::move(variable));
+  }
+  _dirty.clear();
+  _checkpoints.emplace(index, std::move(result));
+
+  if (_checkpoints.size() <= max_checkpoints)
+    return;
+  _stride *= 2;
+  // Keep the first checkpoint and the last one, which the next
+  // checkpoint is based on.
+  auto last = std::prev(_checkpoints.end());
+  for (auto iter = std::next(_checkpoints.begin()); iter != last;) {
+    if (iter->first % _stride != 0)
+      iter = _checkpoints.erase(iter);
+    else
+      ++iter;
+  }
+}
+
+file_watcher::file_watcher(std::filesystem::path path) : _path(std::move(path)) {
+#ifdef __linux__
+  // Watch the directory, since many editors save a file by replacing it.
+  std::filesystem::path dir = _path.parent_path();
+  if (dir.empty())
+    dir = ".";
+  _fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+  if (_fd >= 0 && inotify_add_watch(_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    close(_fd);
+    _fd = -1;
+  }
+#else
+  std::error_code error;
+  _last = std::filesystem::last_write_time(_path, error);
+  _valid = !error;
+#endif
+}
+
+file_watcher::~file_watcher() {
+#ifdef __linux__
+  if (_fd >= 0)
+    close(_fd);
+#endif
+}
+
+bool file_watcher::is_valid() const {
+#ifdef __linux__
+  return _fd >= 0;
+#else
+  return _valid;
+#endif
+}
+
+void file_watcher::drain() {
+#ifdef __linux__
+  bool changed = false;
+  if (_fd >= 0)
+    (void)_read_events(changed);
+#else
+  std::error_code error;
+  auto time = std::filesystem::last_write_time(_path, error);
+  if (!error)
+    _last = time;
+#endif
+}
+
+bool file_watcher::wait() {
+#ifdef __linux__
+  if (_fd < 0)
+    return false;
+  while (true) {
+    bool changed = false;
+    if (!_read_events(changed))
+      return false;
+    if (changed)
+      return true;
+    pollfd events{ _fd, POLLIN, 0 };
+    if (poll(&events, 1, -1) < 0 && errno != EINTR)
+      return false;
+  }
+#else
+  // Poll the modification time where inotify is not available.
+  if (!_valid)
+    return false;
+  while (true) {
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(_path, error);
+    if (!error && time != _last) {
+      _last = time;
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+#endif
+}
+
+#ifdef __linux__
+bool file_watcher::_read_events(bool& changed) {
+  std::string name = _path.filename().string();
+  alignas(inotify_event) char buf[4096];
+  while (true) {
+    ssize_t length = read(_fd, buf, sizeof(buf));
+    if (length < 0)
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    if (length == 0)
+      return false;
+    for (char* p = buf; p < buf + length;) {
+      auto* event = reinterpret_cast<inotify_event*>(p);
+      if (event->len != 0 && name == event->name)
+        changed = true;
+      p += sizeof(inotify_event) + event->len;
+    }
+  }
+}
+#endif
+
+INTERPRETER_NAMESPACE_END
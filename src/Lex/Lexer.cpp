@@ -1,4 +1,5 @@
 #include <Lex/Lexer.h>
+#include <Utils/Counters.h>
 
 #define CUR_IS(ch) (!at_end() && *_buf_cur == (ch))
 #define CUR_IS_NOT(ch) (!at_end() && *_buf_cur != (ch))
@@ -14,6 +15,13 @@ lexer::table_t lexer::kw_table({
   return lhs.compare_insensitive(rhs) == 0;
 });
 
+static void _count_token(const token& result) {
+  if (counter_registry::is_enabled() && result.is_not(token_kind::tk_eof)) {
+    static counter& tokens = counter_registry::get("lexer", "tokens");
+    tokens.add();
+  }
+}
+
 void lexer::_skip_white_space() {
   for (; !at_end() && std::isspace(*_buf_cur); ++_buf_cur)
     ;
@@ -188,6 +196,7 @@ void lexer::lex_and_consume(token& result) {
     _token_cache_list.pop_front();
   if (_token_cache_list.empty()) {
     _lex_impl(result);
+    _count_token(result);
     _token_cache_list.push_back(result);
   } else {
     result = _token_cache_list.front();
@@ -204,6 +213,7 @@ void lexer::_lex_n_and_cache(std::size_t count) {
   while (count--) {
     token result;
     _lex_impl(result);
+    _count_token(result);
     _token_cache_list.emplace_back(std::move(result));
   }
 }
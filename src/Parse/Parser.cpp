@@ -1,5 +1,8 @@
 #include <Parse/Parser.h>
 #include <Diagnostic/DiagData.h>
+#include <AST/StmtVisitor.h>
+#include <Utils/Counters.h>
+#include <charconv>
 
 INTERPRETER_NAMESPACE_BEGIN
 
@@ -144,7 +147,8 @@ bool parser::maybe_typo(token input, token_kind expected_tok) {
   if (is_keyword(expected_tok)) {
     string_ref spelling = get_spelling(expected_tok);
     unsigned max_edit_distance = 3;
-    auto distance = input.get_data().edit_distance(get_spelling(expected_tok), /* ignore_cases = */ true);
+    auto distance = input.get_data().edit_distance(spelling, /* ignore_cases = */ true,
+                                                   /* allow_replacements = */ true, max_edit_distance);
     return distance <= max_edit_distance && distance < input.get_length() && distance < spelling.size();
   }
   return false;
@@ -194,11 +198,82 @@ bool parser::skip_until(const std::vector<token_kind>& kinds,
   }
 }
 
+namespace {
+/**
+ * Counts the nodes of the syntax tree by their kinds.
+ */
+class node_counter : public stmt_visitor<node_counter> {
+public:
+  node_counter() {
+    static const char* const names[] = {
+      "unknown_stmt",
+#define STMT(CLASS, PARENT) #CLASS,
+#include <AST/ASTNodeDef.h>
+    };
+    for (const char* name : names)
+      _counters.push_back(&counter_registry::get("parser", name));
+  }
+
+  void count(stmt* s) {
+    if (!s)
+      return;
+    _counters[s->get_stmt_kind()]->add();
+    visit(s);
+  }
+
+  void visit_stmt(stmt*) { }
+
+  void visit_assignment_stmt(assignment_stmt* s) {
+    count(s->get_assignment_lhs());
+    count(s->get_assignment_rhs());
+  }
+
+  void visit_for_stmt(for_stmt* s) {
+    count(s->get_for_expr());
+    count(s->get_from_expr());
+    count(s->get_to_expr());
+    count(s->get_step_expr());
+    for (auto iter = s->body_begin(); iter != s->body_end(); ++iter)
+      count(iter->get());
+  }
+
+  void visit_expr_stmt(expr_stmt* s) {
+    count(s->get_expr());
+  }
+
+  void visit_binary_expr(binary_expr* e) {
+    count(e->get_lhs());
+    count(e->get_rhs());
+  }
+
+  void visit_unary_expr(unary_expr* e) {
+    count(e->get_operand());
+  }
+
+  void visit_tuple_expr(tuple_expr* e) {
+    for (auto iter = e->elem_begin(); iter != e->elem_end(); ++iter)
+      count(iter->get());
+  }
+
+  void visit_call_expr(call_expr* e) {
+    for (auto iter = e->param_begin(); iter != e->param_end(); ++iter)
+      count(iter->get());
+  }
+private:
+  std::vector<counter*> _counters;
+};
+} // namespace
+
 parser::stmt_group parser::parse_program() {
   stmt_group result;
   while (tok.is_not(token_kind::tk_eof)) {
     result.emplace_back(parse_stmt());
   }
+  if (counter_registry::is_enabled()) {
+    node_counter nodes;
+    for (const stmt_result_t& s : result)
+      nodes.count(s.get());
+  }
   return result;
 }
 
@@ -400,13 +475,15 @@ expr_result_t parser::parse_constant_value() {
   consume_token();  // move to the next token
   double result_value;
   string_ref data = value.get_data();
-  try {
-    result_value = std::stod(static_cast<std::string>(data));
-  } catch(std::out_of_range&) {
+  // The constant is parsed in place, and the result does not depend on
+  // the locale.
+  auto [end, error] = std::from_chars(data.begin(), data.end(), result_value);
+  if (error == std::errc::result_out_of_range) {
     diag(err_constant_too_large, value.get_start_location(), value.get_end_location())
       << diag_build_finish;
     return expr_error();
   }
+  assert(error == std::errc());
 
   bool has_float_point = std::find(data.begin(), data.end(), '.') != data.end();
   return std::make_unique<num_expr>(result_value,
@@ -415,11 +492,11 @@ expr_result_t parser::parse_constant_value() {
                                     has_float_point);
 }
 
-std::string parser::extract_string_token_value(token& t) {
+void parser::extract_string_token_value(token& t, std::string& result) {
   assert(t.is(token_kind::tk_string));
   string_ref raw = t.get_data();
-  std::string data = std::string(raw.begin() + 1, raw.end() - 1);
-  std::string result;
+  // without the quotation marks
+  string_ref data(raw.data() + 1, raw.size() - 2);
   for (auto iter = data.begin(); iter != data.end(); ++iter) {
     if (*iter == '\\') {
       ++iter; // iter cannot be 'end()' here, because in this case
@@ -462,7 +539,6 @@ std::string parser::extract_string_token_value(token& t) {
     } else
       result += *iter;
   }
-  return result;
 }
 
 /**
@@ -472,9 +548,18 @@ std::string parser::extract_string_token_value(token& t) {
 expr_result_t parser::parse_string_value() {
   assert(tok.is(token_kind::tk_string));
   std::size_t start_loc = tok.get_start_location();
+  token first = tok;
+  consume_token();
+  string_ref raw = first.get_data();
+  // Most strings are a single token without escape characters, whose
+  // value is just the characters in the source.
+  if (!tok.is(token_kind::tk_string) && std::find(raw.begin(), raw.end(), '\\') == raw.end())
+    return std::make_unique<string_expr>(string_ref(raw.data() + 1, raw.size() - 2),
+                                         start_loc, prev_tok_loc);
   std::string result;
+  extract_string_token_value(first, result);
   while (tok.is(token_kind::tk_string)) {
-    result += extract_string_token_value(tok);
+    extract_string_token_value(tok, result);
     consume_token();
   }
   return std::make_unique<string_expr>(std::move(result), start_loc, prev_tok_loc);
@@ -14,6 +14,7 @@ void symbol_table::add_variable(token_kind kind, string_ref spelling,
     spelling = get_spelling(kind);
   assert(_var_symbols.find(spelling) == _var_symbols.end());
   _var_symbols[spelling] = std::move(info);
+  _var_names.insert(spelling);
 }
 
 void symbol_table::add_function(token_kind kind, string_ref spelling,
@@ -32,7 +33,10 @@ void symbol_table::add_function(token_kind kind, string_ref spelling,
   };
   assert(_checker(_func_symbols[spelling], info));
 #endif
+  // The calls of all the overloads are counted together.
+  info->set_call_counter(&counter_registry::get("calls", spelling));
   _func_symbols[spelling].emplace_back(std::move(info));
+  _func_names.insert(spelling);
 }
 
 variable_info*
@@ -87,4 +91,23 @@ bool symbol_table::has_function(string_ref spelling) const {
   return _func_symbols.find(spelling) != _func_symbols.end();
 }
 
+/**
+ * A name is similar if at most 5 edits are needed.
+ */
+static constexpr unsigned _max_typo_distance = 5;
+
+std::optional<string_ref> symbol_table::find_similar_variable(string_ref spelling) const {
+  std::vector<string_ref> result = _var_names.find_closest(spelling, _max_typo_distance);
+  if (result.size() != 1)
+    return std::nullopt;
+  return result.front();
+}
+
+std::optional<string_ref> symbol_table::find_similar_function(string_ref spelling) const {
+  std::vector<string_ref> result = _func_names.find_closest(spelling, _max_typo_distance);
+  if (result.size() != 1)
+    return std::nullopt;
+  return result.front();
+}
+
 INTERPRETER_NAMESPACE_END
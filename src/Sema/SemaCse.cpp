@@ -0,0 +1,181 @@
+/**
+ * This file finds the common subexpressions of an expression, whose
+ * values are computed only once in each evaluation of the expression.
+ *
+ * Each pure numeric subexpression is given a key which is the same for
+ * the subexpressions computing the same value: the operators, the bound
+ * variables, the values of the literals and the pure math functions
+ * (sin, cos, tan, ln and abs) which make it up. The other functions
+ * (e.g. rand_int, print and draw) are never shared, and neither are the
+ * subexpressions containing their calls.
+ *
+ * @author 19030500131 zy
+ */
+#include <Sema/Sema.h>
+#include <AST/StmtVisitor.h>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+/**
+ * Returns true if the function @param{name} always returns the same
+ * value for the same argument and has no side effect.
+ */
+bool is_pure_function(string_ref name) {
+  return name == "sin" || name == "cos" || name == "tan" || name == "ln" || name == "abs";
+}
+
+bool is_number_kind(expr::inferred_kind kind) {
+  return kind == expr::ik_integer || kind == expr::ik_float_point || kind == expr::ik_number;
+}
+
+/**
+ * Computes the value of a call of sin or cos together with the value of
+ * the fused call of the other function, which is cached for it.
+ */
+template<bool Sin>
+bool sincos_kernel(sema& s, expr* e, number_value& result) {
+  auto* call = static_cast<call_expr*>(e);
+  number_value arg{};
+  if (!s._evaluate_number(call->get_arg_expr(0), arg))
+    return false;
+  // Convert the integer as the generic evaluator does, e.g. -0 is 0.
+  FLOAT_POINT_T x = arg.is_integer ? static_cast<FLOAT_POINT_T>(static_cast<INTEGER_T>(arg.value))
+                                   : arg.value;
+  // The compiler computes both with a single call of sincos.
+  FLOAT_POINT_T sin = std::sin(x);
+  FLOAT_POINT_T cos = std::cos(x);
+  result = { Sin ? sin : cos, false };
+  s._cache_number(call->get_fused_call(), { Sin ? cos : sin, false });
+  return true;
+}
+
+class common_subexpr_finder : public stmt_visitor<common_subexpr_finder, std::string> {
+public:
+  /**
+   * Makes the subexpressions with the same key share their values, and
+   * fuses the calls of sin and cos on the same argument.
+   */
+  void finish() {
+    for (auto& [arg, calls] : _sincos) {
+      auto [sin, cos] = calls;
+      if (!sin || !cos)
+        continue;
+      for (call_expr* call : { sin, cos }) {
+        if (!call->get_shared_node())
+          call->set_shared_node(call);
+      }
+      sin->set_fused_call(cos);
+      cos->set_fused_call(sin);
+      sin->set_inferred_info(sin->get_inferred_kind(), sin->is_inferred_constant(),
+                             &sincos_kernel<true>);
+      cos->set_inferred_info(cos->get_inferred_kind(), cos->is_inferred_constant(),
+                             &sincos_kernel<false>);
+    }
+  }
+
+  std::string visit_binary_expr(binary_expr* e) {
+    std::string lhs = visit(e->get_lhs());
+    std::string rhs = visit(e->get_rhs());
+    if (lhs.empty() || rhs.empty())
+      return {};
+    return _add(e, '(' + lhs + e->get_op_str().str() + rhs + ')');
+  }
+
+  std::string visit_unary_expr(unary_expr* e) {
+    std::string operand = visit(e->get_operand());
+    if (operand.empty())
+      return {};
+    return _add(e, '(' + e->get_op_str().str() + operand + ')');
+  }
+
+  std::string visit_variable_expr(variable_expr* e) {
+    if (!e->has_bind_info() || !is_number_kind(e->get_inferred_kind()))
+      return {};
+    // The variables cannot be assigned during the evaluation.
+    auto address = reinterpret_cast<std::uintptr_t>(&e->get_bind_info());
+    return _with_kind(e, 'v' + std::to_string(address));
+  }
+
+  std::string visit_num_expr(num_expr* e) {
+    double value = e->get_value();
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    // 2 is an Integer, but 2. is a Double.
+    return _with_kind(e, 'n' + std::to_string(bits));
+  }
+
+  std::string visit_tuple_expr(tuple_expr* e) {
+    for (auto iter = e->elem_begin(); iter != e->elem_end(); ++iter)
+      visit(iter->get());
+    return {};
+  }
+
+  std::string visit_call_expr(call_expr* e) {
+    std::string arg;
+    for (auto iter = e->param_begin(); iter != e->param_end(); ++iter)
+      arg = visit(iter->get());
+    if (arg.empty() || e->get_param_count() != 1 || !e->has_bind_info() ||
+        !is_pure_function(e->get_func_name()))
+      return {};
+    std::string key = _add(e, e->get_func_name().str() + '(' + arg + ')');
+    // Only the first call of each function is fused, the others share
+    // its value.
+    const function_info& info = e->get_bind_func();
+    if (_shared.at(key) == e && info.get_ret_type().is(type::FLOAT_POINT) &&
+        info.get_param_type(0).is(type::FLOAT_POINT)) {
+      if (e->get_func_name() == "sin")
+        _sincos[arg].first = e;
+      else if (e->get_func_name() == "cos")
+        _sincos[arg].second = e;
+    }
+    return key;
+  }
+
+  std::string visit_stmt(stmt*) {
+    return {};
+  }
+private:
+  /**
+   * The first subexpression of each key.
+   */
+  std::map<std::string, expr*> _shared;
+  /**
+   * The calls of sin and cos by the keys of their arguments.
+   */
+  std::map<std::string, std::pair<call_expr*, call_expr*>> _sincos;
+
+  /**
+   * Returns @param{key} prefixed with the inferred kind of @param{e},
+   * since the subexpressions with the same values may have different
+   * kinds, and only the ones with the same kind can share their values.
+   */
+  static std::string _with_kind(const expr* e, const std::string& key) {
+    return std::to_string(e->get_inferred_kind()) + key;
+  }
+
+  std::string _add(expr* e, std::string key) {
+    if (!is_number_kind(e->get_inferred_kind()))
+      return {};
+    key = _with_kind(e, key);
+    auto [iter, inserted] = _shared.emplace(key, e);
+    if (!inserted) {
+      iter->second->set_shared_node(iter->second);
+      e->set_shared_node(iter->second);
+    }
+    return key;
+  }
+};
+} // namespace
+
+void sema::_share_common_subexprs(expr* root) {
+  common_subexpr_finder finder;
+  finder.visit(root);
+  finder.finish();
+}
+
+INTERPRETER_NAMESPACE_END
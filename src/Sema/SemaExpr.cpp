@@ -2,6 +2,8 @@
 #include <AST/StmtVisitor.h>
 #include <iterator>
 #include <Diagnostic/DiagData.h>
+#include <Utils/Counters.h>
+#include <atomic>
 #include <cmath>
 #include <sstream>
 
@@ -93,26 +95,10 @@ private:
 
   std::optional<std::pair<string_ref, variable_info*>>
   _check_variable_typo(string_ref spelling) {
-    auto _distance_checker =
-        [_min_distance = 5u, spelling] (string_ref name, variable_info* info) mutable {
-            unsigned distance = spelling.edit_distance(name);
-            if (distance <= _min_distance && distance < std::min(spelling.size(), name.size())) {
-              _min_distance = distance;
-              return true;
-            }
-            return false;
-        };
-    std::vector<std::pair<string_ref, variable_info*>> _candidates;
-    _table.get_var_if(std::back_inserter(_candidates), _distance_checker);
-    if (_candidates.size() == 1) {
-      return _candidates.back();
-    } else if (_candidates.size() > 1) {
-      if (spelling.edit_distance(_candidates.back().first) <
-          spelling.edit_distance(_candidates[_candidates.size() - 2].first)) {
-        return _candidates.back();
-      }
-    }
-    return std::nullopt;
+    std::optional<string_ref> name = _table.find_similar_variable(spelling);
+    if (!name)
+      return std::nullopt;
+    return std::make_pair(*name, _table.get_variable(*name));
   }
 };
 }
@@ -160,7 +146,7 @@ RetTy visit_binary_##OP_NAME##_op(binary_expr* e) {
 #define UNARY_OP_FUNC(OP_NAME)                                          \
 RetTy visit_unary_##OP_NAME##_op(unary_expr* e) {                       \
   assert(e);                                                            \
-  auto operand = visit(e->get_operand());                               \
+  auto operand = evaluate(e->get_operand());                            \
   if (!operand)                                                         \
     return std::nullopt;                                                \
   if (!action.can_unary_##OP_NAME(operand->get_type())) {               \
@@ -203,8 +189,7 @@ RetTy visit_unary_##OP_NAME##_op(unary_expr* e) {                       \
 
   RetTy visit_string_expr(string_expr* e) {
     assert(e);
-    auto value = e->get_value();
-    return make_constant_typed_value(make_STRING_type(), std::move(value));
+    return make_constant_typed_value(make_STRING_type(), e->get_value().str());
   }
 
   RetTy visit_tuple_expr(tuple_expr* e) {
@@ -241,6 +226,10 @@ RetTy visit_unary_##OP_NAME##_op(unary_expr* e) {                       \
     std::vector<std::any> arguments;
     arguments.reserve(e->get_param_count());
     for (std::size_t i = 0; i < params.size(); ++i) {
+      if (params[i].get_type() == bind_info.get_param_type(i)) {
+        arguments.emplace_back(params[i].take_value());
+        continue;
+      }
       std::string _origin_value = params[i].get_value_spelling();
       std::string _origin_type = params[i].get_type().get_spelling();
       bool narrow = false;
@@ -256,7 +245,7 @@ RetTy visit_unary_##OP_NAME##_op(unary_expr* e) {                       \
       arguments.emplace_back(std::move(_converted_result.take_value()));
     }
     // prepare param loc
-    std::vector<std::size_t> param_loc;
+    location_list param_loc;
     param_loc.reserve(2 * e->get_param_count());
     for (auto iter = e->param_begin(); iter != e->param_end(); ++iter) {
       param_loc.push_back((*iter)->get_start_loc());
@@ -268,6 +257,16 @@ RetTy visit_unary_##OP_NAME##_op(unary_expr* e) {                       \
       return make_typed_value(bind_info.get_ret_type(), std::move(call_result));
     return std::nullopt;
   }
+
+  /**
+   * Evaluates @param{e} with its kernel if it has been selected by
+   * @code{sema::infer_type}, otherwise visits it.
+   */
+  RetTy evaluate(expr* e) {
+    if (e->get_kernel() || e->get_shared_node())
+      return action._evaluate_by_kernel(e);
+    return visit(e);
+  }
 private:
   bool _simplify;
   sema& action;
@@ -296,7 +295,7 @@ private:
     }
     for (; beg != end; ++beg) {
       assert(*beg);
-      RetTy elem = visit(beg->get());
+      RetTy elem = evaluate(beg->get());
       if (!elem)
         continue;
       result.emplace_back(std::move(*elem));
@@ -305,7 +304,7 @@ private:
   }
 
   std::pair<RetTy, RetTy> _evaluate_binary_operands(binary_expr* e) {
-    return { visit(e->get_lhs()), visit(e->get_rhs()) };
+    return { evaluate(e->get_lhs()), evaluate(e->get_rhs()) };
   }
 
 #define BASIC_TYPE(NAME, TYPE, SPELLING) \
@@ -316,6 +315,30 @@ static type make_##NAME##_type()         \
 }
 
 std::optional<typed_value> sema::evaluate(expr* e, bool simplify) {
+  if (counter_registry::is_enabled()) {
+    static counter& evaluations = counter_registry::get("sema", "evaluations");
+    evaluations.add();
+  }
+  if (e->get_inferred_kind() == expr::ik_unknown)
+    infer_type(e);
+  if (_evaluation_depth == 0) {
+    // The common subexpressions can only be found after the whole
+    // expression is inferred, i.e. after the calls in it are bound.
+    if (e->get_inferred_kind() != expr::ik_unknown && !e->is_subexprs_shared()) {
+      _share_common_subexprs(e);
+      e->set_subexprs_shared();
+    }
+    static std::atomic<std::uint64_t> evaluations{ 0 };
+    _evaluation = evaluations.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+  ++_evaluation_depth;
+  expr_eval_visitor visitor(*this);
+  std::optional<typed_value> result = visitor.evaluate(e);
+  --_evaluation_depth;
+  return result;
+}
+
+std::optional<typed_value> sema::_evaluate_unshared(expr* e) {
   expr_eval_visitor visitor(*this);
   return visitor.visit(e);
 }
@@ -368,7 +391,7 @@ sema::_binary_on_basic_num_type(const type& lhs_type, std::any lhs,
                                                              rhs_type, std::move(rhs));
 
   FLOAT_POINT_T result = 0;
-  std::string op_name;
+  const char* op_name = nullptr;
   // For n-th power operations, we cannot conclude that the result
   // must be a floating-point number based on the fact that the
   // right operand is a floating-point number. For example,
@@ -474,7 +497,8 @@ sema::_unary_on_basic_type(const type& op_type, std::any operand,
 std::optional<typed_value>
 sema::_binary_on_tuple_num(const type& lhs_type, std::any lhs_value,
                            const type& rhs_type, std::any rhs_value,
-                           std::size_t op_loc, std::function<_binary_op_impl_t> impl) const {
+                           std::size_t op_loc, binary_expr::op_kind kind,
+                           std::function<_binary_op_impl_t> impl) const {
   assert(lhs_type.is(type::TUPLE) != rhs_type.is(type::TUPLE));
   std::vector<std::any> tuple;
   const type* tuple_type, * other_type;
@@ -490,6 +514,10 @@ sema::_binary_on_tuple_num(const type& lhs_type, std::any lhs_value,
     tuple_type = &rhs_type;
     other_type = &lhs_type;
   }
+  if (other_type->is(type::INTEGER) || other_type->is(type::FLOAT_POINT)) {
+    if (auto flat = numeric_tuple::unpack(*tuple_type, tuple))
+      return _binary_on_numeric_tuple(*flat, *other_type, std::move(other), op_loc, kind);
+  }
   std::vector<typed_value> _result_untidy;
   _result_untidy.reserve(tuple.size());
   for (auto& elem : tuple) {
@@ -505,6 +533,38 @@ sema::_binary_on_tuple_num(const type& lhs_type, std::any lhs_value,
   return tidy_result;
 }
 
+std::optional<typed_value>
+sema::_binary_on_numeric_tuple(const numeric_tuple& tuple, const type& other_type, std::any other,
+                               std::size_t op_loc, binary_expr::op_kind kind) const {
+  FLOAT_POINT_T scalar = _extract_basic_integer_value(other_type, std::move(other));
+  numeric_tuple result(std::vector<FLOAT_POINT_T>(tuple.size()), false);
+  tuple_scalar_kernel(kind, tuple.data(), scalar, result.data(), tuple.size());
+  // The elements are computed as _binary_on_basic_num_type does, which
+  // stops at the first invalid result.
+  if (kind == binary_expr::bo_div && scalar == 0)
+    diag(warn_div_zero, op_loc) << diag_build_finish;
+  if (std::size_t idx = find_invalid_element(result.data(), result.size());
+      idx != result.size()) {
+    const char* op_name = nullptr;
+    switch (kind) {
+      case binary_expr::bo_add: op_name = "adding"; break;
+      case binary_expr::bo_sub: op_name = "subtracting"; break;
+      case binary_expr::bo_mul: op_name = "multiplying"; break;
+      case binary_expr::bo_div: op_name = "dividing"; break;
+      case binary_expr::bo_pow: op_name = "powering"; break;
+      default: assert(false);
+    }
+    diag(err_invalid_binary_result, op_loc)
+        << op_name << tuple[idx] << scalar << diag_build_finish;
+    return std::nullopt;
+  }
+  bool should_check = kind == binary_expr::bo_pow ?
+                      tuple.is_integer() :
+                      tuple.is_integer() && other_type.is(type::INTEGER);
+  result.set_integer(should_check && normalize_integer_elements(result.data(), result.size()));
+  return result.pack();
+}
+
 std::optional<typed_value>
 sema::_unary_on_tuple_elem(const type& operand_type, std::any operand_value, std::size_t op_loc,
                            std::function<_unary_op_impl_t> impl) const {
@@ -523,9 +583,9 @@ sema::_unary_on_tuple_elem(const type& operand_type, std::any operand_value, std
   return tidy_result;
 }
 
-#define BINARY_ON_TUPLE_NUM(CALLBACK)                                                   \
+#define BINARY_ON_TUPLE_NUM(CALLBACK, KIND)                                             \
 return _binary_on_tuple_num(lhs_type, std::move(lhs_value), rhs_type,                   \
-                            std::move(rhs_value), op_loc,                               \
+                            std::move(rhs_value), op_loc, KIND,                         \
   [this](const type& lhs_type, std::any lhs,                                            \
          const type& rhs_type, std::any rhs,                                            \
          std::size_t op_loc) {                                                          \
@@ -554,7 +614,7 @@ sema::_add_unchecked(const type& lhs_type, std::any lhs_value,
     _lhs_tuple.insert(_lhs_tuple.end(), _rhs_tuple.begin(), _rhs_tuple.end());
     return typed_value(lhs_type, std::make_any<std::vector<std::any>>(std::move(_lhs_tuple)));
   } else {
-    BINARY_ON_TUPLE_NUM(_add_unchecked);
+    BINARY_ON_TUPLE_NUM(_add_unchecked, binary_expr::bo_add);
   }
 }
 
@@ -568,7 +628,7 @@ sema::_sub_unchecked(const type& lhs_type, std::any lhs_value,
                                  rhs_type, std::move(rhs_value),
                                  op_loc, binary_expr::bo_sub);
   } else {
-    BINARY_ON_TUPLE_NUM(_sub_unchecked);
+    BINARY_ON_TUPLE_NUM(_sub_unchecked, binary_expr::bo_sub);
   }
 }
 
@@ -582,7 +642,7 @@ sema::_mul_unchecked(const type& lhs_type, std::any lhs_value, const type& rhs_t
                                  op_loc, binary_expr::bo_mul);
   } else {
     // multiply tuple element with number
-    BINARY_ON_TUPLE_NUM(_mul_unchecked);
+    BINARY_ON_TUPLE_NUM(_mul_unchecked, binary_expr::bo_mul);
   }
 }
 
@@ -596,7 +656,7 @@ sema::_div_unchecked(const type& lhs_type, std::any lhs_value,
                                  rhs_type, std::move(rhs_value),
                                  op_loc, binary_expr::bo_div);
   } else {
-    BINARY_ON_TUPLE_NUM(_div_unchecked);
+    BINARY_ON_TUPLE_NUM(_div_unchecked, binary_expr::bo_div);
   }
 }
 
@@ -610,7 +670,7 @@ sema::_pow_unchecked(const type& lhs_type, std::any lhs_value,
                                  rhs_type, std::move(rhs_value),
                                  op_loc, binary_expr::bo_pow);
   } else {
-    BINARY_ON_TUPLE_NUM(_pow_unchecked);
+    BINARY_ON_TUPLE_NUM(_pow_unchecked, binary_expr::bo_pow);
   }
 }
 
@@ -627,6 +687,10 @@ sema::_unary_minus_unchecked(const type& op_type, std::any op_value,
     // basic type
     return _unary_on_basic_type(op_type, std::move(op_value),
                                 op_loc, unary_expr::uo_minus);
+  } else if (auto flat = numeric_tuple::unpack(op_type, op_value)) {
+    tuple_negate_kernel(flat->data(), flat->data(), flat->size());
+    flat->set_integer(flat->is_integer() && normalize_integer_elements(flat->data(), flat->size()));
+    return flat->pack();
   } else {
     UNARY_ON_TUPLE_ELEM(_unary_minus_unchecked);
   }
@@ -668,6 +732,10 @@ int sema::compare(const type& lhs_type, std::any lhs_value,
                                rhs_type, std::move(rhs_value));
   }
   if (lhs_type.is(type::TUPLE) && rhs_type.is(type::TUPLE)) {
+    if (auto lhs_flat = numeric_tuple::unpack(lhs_type, lhs_value)) {
+      if (auto rhs_flat = numeric_tuple::unpack(rhs_type, rhs_value))
+        return compare_tuples(*lhs_flat, *rhs_flat);
+    }
     using tuple_t = std::vector<std::any>;
     tuple_t lhs_tuple = std::any_cast<tuple_t>(std::move(lhs_value));
     tuple_t rhs_tuple = std::any_cast<tuple_t>(std::move(rhs_value));
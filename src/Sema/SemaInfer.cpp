@@ -0,0 +1,347 @@
+#include <Sema/Sema.h>
+#include <AST/StmtVisitor.h>
+#include <Diagnostic/DiagData.h>
+#include <cmath>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+using kind_t = expr::inferred_kind;
+
+bool _is_numeric(kind_t kind) {
+  return kind == expr::ik_integer || kind == expr::ik_float_point || kind == expr::ik_number;
+}
+
+kind_t _get_kind_of_type(const type& t) {
+  switch (t.get_kind()) {
+    case type::INTEGER:
+      return expr::ik_integer;
+    case type::FLOAT_POINT:
+      return expr::ik_float_point;
+    case type::STRING:
+      return expr::ik_string;
+    case type::TUPLE:
+      return expr::ik_tuple;
+    default:
+      return expr::ik_void;
+  }
+}
+
+/**
+ * Returns whether @param{v} is an integer. The result is known
+ * at compile time unless the value is inferred as @code{ik_number}.
+ */
+template<kind_t Kind>
+bool _is_integer(number_value v) {
+  if constexpr (Kind == expr::ik_integer)
+    return true;
+  else if constexpr (Kind == expr::ik_float_point)
+    return false;
+  else
+    return v.is_integer;
+}
+
+/**
+ * Converts an Integer result as the generic evaluator does when it
+ * packs the value, so that -0 is 0 in the next operation.
+ */
+void _normalize_integer(number_value& v) {
+  if (v.is_integer)
+    v.value = static_cast<INTEGER_T>(v.value);
+}
+
+bool _evaluate_operand(sema& s, expr* e, number_value& result) {
+  return s._evaluate_number(e, result);
+}
+
+template<binary_expr::op_kind Kind>
+struct binary_op_traits;
+
+#define BINARY_OP_TRAITS(OP_NAME, NAME, EXPR)                           \
+template<>                                                              \
+struct binary_op_traits<binary_expr::bo_##OP_NAME> {                    \
+  static constexpr const char* name = NAME;                             \
+  static FLOAT_POINT_T apply(FLOAT_POINT_T lhs, FLOAT_POINT_T rhs) {    \
+    return EXPR;                                                        \
+  }                                                                     \
+};
+
+BINARY_OP_TRAITS(add, "adding", lhs + rhs)
+BINARY_OP_TRAITS(sub, "subtracting", lhs - rhs)
+BINARY_OP_TRAITS(mul, "multiplying", lhs * rhs)
+BINARY_OP_TRAITS(div, "dividing", lhs / rhs)
+BINARY_OP_TRAITS(pow, "powering", std::pow(lhs, rhs))
+
+#undef BINARY_OP_TRAITS
+
+/**
+ * The kernels below do the same as @code{sema::_binary_on_basic_num_type}
+ * and @code{sema::_unary_on_basic_type}, except that the types of the
+ * operands are given as the template arguments.
+ */
+template<binary_expr::op_kind Kind, kind_t Lhs, kind_t Rhs>
+bool binary_kernel(sema& s, expr* e, number_value& result) {
+  auto* b = static_cast<binary_expr*>(e);
+  number_value lhs{}, rhs{};
+  // Evaluate both operands even if the first one fails.
+  bool l_success = _evaluate_operand(s, b->get_lhs(), lhs);
+  bool r_success = _evaluate_operand(s, b->get_rhs(), rhs);
+  if (!l_success || !r_success)
+    return false;
+  if constexpr (Kind == binary_expr::bo_div) {
+    if (rhs.value == 0)
+      s.diag(warn_div_zero, b->get_op_loc()) << diag_build_finish;
+  }
+  result.value = binary_op_traits<Kind>::apply(lhs.value, rhs.value);
+  if (std::isinf(result.value) || std::isnan(result.value)) {
+    s.diag(err_invalid_binary_result, b->get_op_loc())
+        << binary_op_traits<Kind>::name << lhs.value << rhs.value << diag_build_finish;
+    return false;
+  }
+  // See sema::_binary_on_basic_num_type for the n-th power operations.
+  bool should_check;
+  if constexpr (Kind == binary_expr::bo_pow)
+    should_check = _is_integer<Lhs>(lhs);
+  else
+    should_check = _is_integer<Lhs>(lhs) && _is_integer<Rhs>(rhs);
+  result.is_integer = should_check && sema::check_double_to_int(result.value);
+  _normalize_integer(result);
+  return true;
+}
+
+bool unary_plus_kernel(sema& s, expr* e, number_value& result) {
+  return _evaluate_operand(s, static_cast<unary_expr*>(e)->get_operand(), result);
+}
+
+template<kind_t Operand>
+bool unary_minus_kernel(sema& s, expr* e, number_value& result) {
+  if (!_evaluate_operand(s, static_cast<unary_expr*>(e)->get_operand(), result))
+    return false;
+  result.value = -result.value;
+  result.is_integer = _is_integer<Operand>(result) && sema::check_double_to_int(result.value);
+  _normalize_integer(result);
+  return true;
+}
+
+template<kind_t Kind>
+bool variable_kernel(sema&, expr* e, number_value& result) {
+  const variable_info& info = static_cast<variable_expr*>(e)->get_bind_info();
+  if constexpr (Kind == expr::ik_integer)
+    result = { static_cast<FLOAT_POINT_T>(unpack_value<INTEGER_T>(info.get_value())), true };
+  else
+    result = { unpack_value<FLOAT_POINT_T>(info.get_value()), false };
+  return true;
+}
+
+template<kind_t Kind>
+bool num_kernel(sema&, expr* e, number_value& result) {
+  result = { static_cast<num_expr*>(e)->get_value(), Kind == expr::ik_integer };
+  return true;
+}
+
+template<binary_expr::op_kind Kind, kind_t Lhs>
+expr::kernel_t _select_binary_kernel(kind_t rhs) {
+  switch (rhs) {
+    case expr::ik_integer:
+      return &binary_kernel<Kind, Lhs, expr::ik_integer>;
+    case expr::ik_float_point:
+      return &binary_kernel<Kind, Lhs, expr::ik_float_point>;
+    default:
+      assert(rhs == expr::ik_number);
+      return &binary_kernel<Kind, Lhs, expr::ik_number>;
+  }
+}
+
+template<binary_expr::op_kind Kind>
+expr::kernel_t _select_binary_kernel(kind_t lhs, kind_t rhs) {
+  switch (lhs) {
+    case expr::ik_integer:
+      return _select_binary_kernel<Kind, expr::ik_integer>(rhs);
+    case expr::ik_float_point:
+      return _select_binary_kernel<Kind, expr::ik_float_point>(rhs);
+    default:
+      assert(lhs == expr::ik_number);
+      return _select_binary_kernel<Kind, expr::ik_number>(rhs);
+  }
+}
+
+expr::kernel_t _select_binary_kernel(binary_expr::op_kind kind, kind_t lhs, kind_t rhs) {
+  switch (kind) {
+#define BIN_OP(NAME, OP, PREC, ASSOC, TOKEN) \
+    case binary_expr::bo_##NAME: return _select_binary_kernel<binary_expr::bo_##NAME>(lhs, rhs);
+#include <AST/OpKindDef.h>
+    default:
+      assert(false);
+      return nullptr;
+  }
+}
+
+/**
+ * Infers the type of each expression bottom-up. A node which has been
+ * inferred is not visited again. If the type of a node cannot be known,
+ * the node is left @code{ik_unknown} and so are its ancestors.
+ */
+class type_infer_visitor : public stmt_visitor<type_infer_visitor, kind_t> {
+public:
+  kind_t infer(expr* e) {
+    assert(e);
+    if (e->get_inferred_kind() != expr::ik_unknown)
+      return e->get_inferred_kind();
+    return visit(e);
+  }
+
+  kind_t visit_binary_expr(binary_expr* e) {
+    kind_t lhs = infer(e->get_lhs());
+    kind_t rhs = infer(e->get_rhs());
+    if (lhs == expr::ik_unknown || rhs == expr::ik_unknown)
+      return expr::ik_unknown;
+    bool constant = e->get_lhs()->is_inferred_constant() && e->get_rhs()->is_inferred_constant();
+    if (_is_numeric(lhs) && _is_numeric(rhs)) {
+      // The result of the arithmetic operators is a floating point number
+      // if any operand is (only the left operand for pow), otherwise it
+      // depends on the value.
+      bool float_point = e->get_op_kind() == binary_expr::bo_pow ?
+                         lhs == expr::ik_float_point :
+                         lhs == expr::ik_float_point || rhs == expr::ik_float_point;
+      kind_t kind = float_point ? expr::ik_float_point : expr::ik_number;
+      e->set_inferred_info(kind, constant, _select_binary_kernel(e->get_op_kind(), lhs, rhs));
+      return kind;
+    }
+    // The operations on strings and tuples are evaluated by the generic
+    // evaluator, and the kind is only meaningful if the operation is valid.
+    kind_t kind;
+    if (lhs == expr::ik_void || rhs == expr::ik_void)
+      kind = expr::ik_void;
+    else if (lhs == expr::ik_tuple || rhs == expr::ik_tuple)
+      kind = expr::ik_tuple;
+    else
+      kind = expr::ik_string;
+    e->set_inferred_info(kind, constant, nullptr);
+    return kind;
+  }
+
+  kind_t visit_unary_expr(unary_expr* e) {
+    kind_t operand = infer(e->get_operand());
+    if (operand == expr::ik_unknown)
+      return expr::ik_unknown;
+    bool constant = e->get_operand()->is_inferred_constant();
+    if (!_is_numeric(operand)) {
+      e->set_inferred_info(operand, constant, nullptr);
+      return operand;
+    }
+    if (e->get_op_kind() == unary_expr::uo_plus) {
+      e->set_inferred_info(operand, constant, &unary_plus_kernel);
+      return operand;
+    }
+    assert(e->get_op_kind() == unary_expr::uo_minus);
+    switch (operand) {
+      case expr::ik_integer:
+        // -(-2147483648) is not an integer
+        e->set_inferred_info(expr::ik_number, constant, &unary_minus_kernel<expr::ik_integer>);
+        return expr::ik_number;
+      case expr::ik_float_point:
+        e->set_inferred_info(operand, constant, &unary_minus_kernel<expr::ik_float_point>);
+        return operand;
+      default:
+        e->set_inferred_info(operand, constant, &unary_minus_kernel<expr::ik_number>);
+        return operand;
+    }
+  }
+
+  kind_t visit_variable_expr(variable_expr* e) {
+    if (!e->has_bind_info())
+      return expr::ik_unknown;
+    const variable_info& info = e->get_bind_info();
+    kind_t kind = _get_kind_of_type(info.get_type());
+    expr::kernel_t kernel = nullptr;
+    if (kind == expr::ik_integer)
+      kernel = &variable_kernel<expr::ik_integer>;
+    else if (kind == expr::ik_float_point)
+      kernel = &variable_kernel<expr::ik_float_point>;
+    e->set_inferred_info(kind, info.is_constant(), kernel);
+    return kind;
+  }
+
+  kind_t visit_num_expr(num_expr* e) {
+    if (!e->has_float_point() && sema::check_double_to_int(e->get_value())) {
+      e->set_inferred_info(expr::ik_integer, true, &num_kernel<expr::ik_integer>);
+      return expr::ik_integer;
+    }
+    e->set_inferred_info(expr::ik_float_point, true, &num_kernel<expr::ik_float_point>);
+    return expr::ik_float_point;
+  }
+
+  kind_t visit_string_expr(string_expr* e) {
+    e->set_inferred_info(expr::ik_string, true, nullptr);
+    return expr::ik_string;
+  }
+
+  kind_t visit_tuple_expr(tuple_expr* e) {
+    bool known = true, constant = true;
+    for (auto iter = e->elem_begin(); iter != e->elem_end(); ++iter) {
+      known &= infer(iter->get()) != expr::ik_unknown;
+      constant &= (*iter)->is_inferred_constant();
+    }
+    if (!known)
+      return expr::ik_unknown;
+    e->set_inferred_info(expr::ik_tuple, constant, nullptr);
+    return expr::ik_tuple;
+  }
+
+  kind_t visit_call_expr(call_expr* e) {
+    bool known = true;
+    for (auto iter = e->param_begin(); iter != e->param_end(); ++iter)
+      known &= infer(iter->get()) != expr::ik_unknown;
+    // The result type is known after the overload resolution.
+    if (!known || !e->has_bind_info())
+      return expr::ik_unknown;
+    kind_t kind = _get_kind_of_type(e->get_bind_func().get_ret_type());
+    e->set_inferred_info(kind, false, nullptr);
+    return kind;
+  }
+};
+} // namespace
+
+expr::inferred_kind sema::infer_type(expr* e) {
+  type_infer_visitor visitor;
+  return visitor.infer(e);
+}
+
+bool sema::_evaluate_number(expr* e, number_value& result) {
+  expr* shared = e->get_shared_node();
+  if (shared && shared->find_cached_value(_evaluation, result))
+    return true;
+  if (expr::kernel_t kernel = e->get_kernel()) {
+    if (!kernel(*this, e, result))
+      return false;
+  } else {
+    // The expression has no kernel (e.g. a call expression), so we use
+    // the generic evaluator.
+    std::optional<typed_value> value = shared ? _evaluate_unshared(e) : evaluate(e);
+    if (!value)
+      return false;
+    if (value->get_type().is(type::INTEGER))
+      result = { static_cast<FLOAT_POINT_T>(unpack_value<INTEGER_T>(value->take_value())), true };
+    else
+      result = { unpack_value<FLOAT_POINT_T>(value->take_value()), false };
+  }
+  // A failed evaluation is not cached, so the same diagnostics are
+  // reported for the other occurrences.
+  if (shared)
+    shared->cache_value(_evaluation, result);
+  return true;
+}
+
+std::optional<typed_value> sema::_evaluate_by_kernel(expr* e) {
+  assert(e && (e->get_kernel() || e->get_shared_node()));
+  number_value result{};
+  if (!_evaluate_number(e, result))
+    return std::nullopt;
+  if (result.is_integer) {
+    return typed_value(type(type::INTEGER), static_cast<INTEGER_T>(result.value),
+                       e->is_inferred_constant());
+  }
+  return typed_value(type(type::FLOAT_POINT), result.value, e->is_inferred_constant());
+}
+
+INTERPRETER_NAMESPACE_END
@@ -0,0 +1,102 @@
+#include <Sema/Sema.h>
+#include <AST/StmtVisitor.h>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+class interval_eval_visitor : public stmt_visitor<interval_eval_visitor, interval_result_t> {
+public:
+  interval_eval_visitor(const variable_info* var, interval range)
+    : _var(var), _range(range) { }
+
+#define BINARY_OP_FUNC(OP_NAME, OP)                   \
+interval_result_t visit_binary_##OP_NAME##_op(binary_expr* e) { \
+  assert(e);                                          \
+  auto lhs = visit(e->get_lhs());                     \
+  if (!lhs)                                           \
+    return std::nullopt;                              \
+  auto rhs = visit(e->get_rhs());                     \
+  if (!rhs)                                           \
+    return std::nullopt;                              \
+  return OP;                                          \
+}
+
+  BINARY_OP_FUNC(add, *lhs + *rhs)
+  BINARY_OP_FUNC(sub, *lhs - *rhs)
+  BINARY_OP_FUNC(mul, *lhs * *rhs)
+  BINARY_OP_FUNC(div, *lhs / *rhs)
+  BINARY_OP_FUNC(pow, interval_pow(*lhs, *rhs))
+
+#undef BINARY_OP_FUNC
+
+  interval_result_t visit_unary_plus_op(unary_expr* e) {
+    assert(e);
+    return visit(e->get_operand());
+  }
+
+  interval_result_t visit_unary_minus_op(unary_expr* e) {
+    assert(e);
+    auto operand = visit(e->get_operand());
+    if (!operand)
+      return std::nullopt;
+    return -*operand;
+  }
+
+  interval_result_t visit_variable_expr(variable_expr* e) {
+    assert(e);
+    if (!e->has_bind_info())
+      return std::nullopt;
+    const variable_info& info = e->get_bind_info();
+    if (&info == _var)
+      return _range;
+    if (info.get_type().is(type::INTEGER))
+      return interval(unpack_value<INTEGER_T>(info.get_value()));
+    if (info.get_type().is(type::FLOAT_POINT))
+      return interval(unpack_value<FLOAT_POINT_T>(info.get_value()));
+    return std::nullopt;
+  }
+
+  interval_result_t visit_num_expr(num_expr* e) {
+    assert(e);
+    return interval(e->get_value());
+  }
+
+  interval_result_t visit_call_expr(call_expr* e) {
+    assert(e);
+    if (e->get_param_count() != 1)
+      return std::nullopt;
+    auto arg = visit(e->get_arg_expr(0));
+    if (!arg)
+      return std::nullopt;
+    // Only the pure math functions can be evaluated.
+    string_ref name = e->get_func_name();
+    if (name == "sin")
+      return interval_sin(*arg);
+    if (name == "cos")
+      return interval_cos(*arg);
+    if (name == "tan")
+      return interval_tan(*arg);
+    if (name == "ln")
+      return interval_ln(*arg);
+    if (name == "abs") {
+      // abs(Integer) fails on the minimum value of Integer
+      if (arg->contains(std::numeric_limits<INTEGER_T>::min()))
+        return std::nullopt;
+      return interval_abs(*arg);
+    }
+    return std::nullopt;
+  }
+
+private:
+  const variable_info* _var;
+  interval _range;
+};
+} // namespace
+
+interval_result_t
+sema::evaluate_interval(expr* e, const variable_info* var, interval range) const {
+  interval_eval_visitor visitor(var, range);
+  return visitor.visit(e);
+}
+
+INTERPRETER_NAMESPACE_END
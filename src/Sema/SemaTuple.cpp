@@ -0,0 +1,118 @@
+#include <Sema/NumericTuple.h>
+#include <Sema/Sema.h>
+#include <cmath>
+#include <limits>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+std::optional<numeric_tuple> numeric_tuple::unpack(const type& t, const std::any& value) {
+  if (t.is_not(type::TUPLE))
+    return std::nullopt;
+  const type& sub_type = t.get_sub_type();
+  if (sub_type.is_not(type::INTEGER) && sub_type.is_not(type::FLOAT_POINT))
+    return std::nullopt;
+  const auto& elems = std::any_cast<const std::vector<std::any>&>(value);
+  std::vector<FLOAT_POINT_T> values(elems.size());
+  if (sub_type.is(type::INTEGER)) {
+    for (std::size_t i = 0; i < elems.size(); ++i)
+      values[i] = std::any_cast<INTEGER_T>(elems[i]);
+  } else {
+    for (std::size_t i = 0; i < elems.size(); ++i)
+      values[i] = std::any_cast<FLOAT_POINT_T>(elems[i]);
+  }
+  return numeric_tuple(std::move(values), sub_type.is(type::INTEGER));
+}
+
+typed_value numeric_tuple::pack() const {
+  std::vector<std::any> elems;
+  elems.reserve(_values.size());
+  if (_is_integer) {
+    for (FLOAT_POINT_T value : _values)
+      elems.emplace_back(static_cast<INTEGER_T>(value));
+  } else {
+    for (FLOAT_POINT_T value : _values)
+      elems.emplace_back(value);
+  }
+  return typed_value(type(type::TUPLE, std::make_unique<type>(_is_integer ? type::INTEGER
+                                                                          : type::FLOAT_POINT)),
+                     std::make_any<std::vector<std::any>>(std::move(elems)));
+}
+
+void tuple_scalar_kernel(binary_expr::op_kind kind, const FLOAT_POINT_T* values,
+                         FLOAT_POINT_T scalar, FLOAT_POINT_T* out, std::size_t count) {
+  // Choose the operator once, so that every loop is a simple loop over
+  // the arrays.
+  switch (kind) {
+    case binary_expr::bo_add:
+      for (std::size_t i = 0; i < count; ++i)
+        out[i] = values[i] + scalar;
+      break;
+    case binary_expr::bo_sub:
+      for (std::size_t i = 0; i < count; ++i)
+        out[i] = values[i] - scalar;
+      break;
+    case binary_expr::bo_mul:
+      for (std::size_t i = 0; i < count; ++i)
+        out[i] = values[i] * scalar;
+      break;
+    case binary_expr::bo_div:
+      for (std::size_t i = 0; i < count; ++i)
+        out[i] = values[i] / scalar;
+      break;
+    case binary_expr::bo_pow:
+      for (std::size_t i = 0; i < count; ++i)
+        out[i] = std::pow(values[i], scalar);
+      break;
+    default:
+      assert(false);
+  }
+}
+
+void tuple_negate_kernel(const FLOAT_POINT_T* values, FLOAT_POINT_T* out, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i)
+    out[i] = -values[i];
+}
+
+std::size_t find_invalid_element(const FLOAT_POINT_T* values, std::size_t count) {
+  // `x - x` is 0 for the finite numbers and NaN for the others, so the
+  // check needs no branch in the common case where all are finite.
+  bool all_finite = true;
+  for (std::size_t i = 0; i < count; ++i)
+    all_finite &= values[i] - values[i] == 0;
+  if (all_finite)
+    return count;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (std::isinf(values[i]) || std::isnan(values[i]))
+      return i;
+  }
+  return count;
+}
+
+bool normalize_integer_elements(FLOAT_POINT_T* values, std::size_t count) {
+  constexpr auto min = static_cast<FLOAT_POINT_T>(std::numeric_limits<INTEGER_T>::min());
+  constexpr auto max = static_cast<FLOAT_POINT_T>(std::numeric_limits<INTEGER_T>::max());
+  bool all_integer = true;
+  for (std::size_t i = 0; i < count; ++i) {
+    // Adding a positive zero only changes -0 to +0.
+    values[i] += 0.0;
+    all_integer &= values[i] >= min && values[i] <= max && std::trunc(values[i]) == values[i];
+  }
+  return all_integer;
+}
+
+int compare_tuples(const numeric_tuple& lhs, const numeric_tuple& rhs) {
+  std::size_t size = std::min(lhs.size(), rhs.size());
+  for (std::size_t i = 0; i < size; ++i) {
+    if (lhs[i] < rhs[i])
+      return -1;
+    if (lhs[i] > rhs[i])
+      return 1;
+  }
+  if (lhs.size() < rhs.size())
+    return -1;
+  if (lhs.size() == rhs.size())
+    return 0;
+  return 1;
+}
+
+INTERPRETER_NAMESPACE_END
@@ -1,4 +1,5 @@
 #include <Sema/Sema.h>
+#include <Utils/Counters.h>
 #include <iterator>
 #include <algorithm>
 #include <sstream>
@@ -62,6 +63,10 @@ sema::convert_to(std::vector<std::any> values, const type& src, const type& dst,
     return values;
   }
   // for basic type
+  if (counter_registry::is_enabled()) {
+    static counter& conversions = counter_registry::get("sema", "conversions");
+    conversions.add(values.size());
+  }
   if (dst.is(type::INTEGER)) {
     assert(src.is(type::FLOAT_POINT));
     narrow = true;
@@ -118,30 +123,13 @@ sema::_get_candidate_functions(string_ref func_name, std::size_t func_name_loc)
     return {};
   }
   // check whether it is a typo
-  auto _distance_checker =
-      [_min_distance = 5u, func_name] (string_ref name, const function_info* info) mutable  {
-    unsigned distance = func_name.edit_distance(name);
-    if (distance <= _min_distance && distance < std::min(name.size(), func_name.size())) {
-      _min_distance = distance;
-      return true;
-    }
-    return false;
-  };
-  std::vector<std::pair<string_ref, const function_info*>> _typo_names;
-  _symbol_table.get_func_if(std::back_inserter(_typo_names), _distance_checker);
-  if (_typo_names.size() > 1) {
-    if (func_name.edit_distance(_typo_names.back().first) ==
-        func_name.edit_distance(_typo_names[_typo_names.size() - 2].first)) {
-      diag(err_use_unknown_identifier, func_name_loc) << diag_build_finish;
-      return {};
-    }
-  }
-  if (_typo_names.empty()) {
+  std::optional<string_ref> _typo_name = _symbol_table.find_similar_function(func_name);
+  if (!_typo_name) {
     diag(err_use_unknown_identifier, func_name_loc) << diag_build_finish;
     return {};
   }
   diag(err_use_unknown_identifier_with_hint, func_name_loc)
-    << _typo_names.front().first << diag_build_finish;
+    << *_typo_name << diag_build_finish;
   return {};
 }
 
@@ -295,6 +283,10 @@ sema::_find_best_viable_function(std::vector<const function_info*> viable_funcs,
 const function_info*
 sema::overload_resolution(string_ref func_name, std::size_t func_name_loc,
                           const std::vector<const type*>& param_types) const {
+  if (counter_registry::is_enabled()) {
+    static counter& resolutions = counter_registry::get("sema", "overload_resolutions");
+    resolutions.add();
+  }
   std::vector<const function_info*> candidate = _get_candidate_functions(func_name, func_name_loc);
   if (candidate.empty())
     return nullptr;
@@ -0,0 +1,62 @@
+/**
+ * This file provides implementation of @code{bk_tree} interfaces.
+ *
+ * @author 19030500131 zy
+ */
+#include <Utils/BKTree.h>
+#include <algorithm>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+void bk_tree::insert(string_ref word) {
+  if (_nodes.empty()) {
+    _nodes.push_back({ word, {} });
+    return;
+  }
+  std::size_t cur = 0;
+  while (true) {
+    unsigned distance = word.edit_distance(_nodes[cur].word);
+    if (distance == 0)
+      return;
+    auto& children = _nodes[cur].children;
+    auto iter = std::find_if(children.begin(), children.end(), [distance](const auto& child) {
+      return child.first == distance;
+    });
+    if (iter == children.end()) {
+      children.emplace_back(distance, _nodes.size());
+      // `children` is invalid after this.
+      _nodes.push_back({ word, {} });
+      return;
+    }
+    cur = iter->second;
+  }
+}
+
+std::vector<string_ref> bk_tree::find_closest(string_ref word, unsigned max_distance) const {
+  std::vector<string_ref> result;
+  if (_nodes.empty())
+    return result;
+  // The distance of the closest words found so far. Only the words
+  // no further than it are searched.
+  unsigned best = max_distance;
+  std::vector<std::size_t> pending{ 0 };
+  while (!pending.empty()) {
+    const _node& node = _nodes[pending.back()];
+    pending.pop_back();
+    unsigned distance = word.edit_distance(node.word);
+    if (distance <= best && distance < std::min(word.size(), node.word.size())) {
+      if (distance < best) {
+        result.clear();
+        best = distance;
+      }
+      result.push_back(node.word);
+    }
+    for (auto [label, child] : node.children) {
+      if (label + best >= distance && label <= distance + best)
+        pending.push_back(child);
+    }
+  }
+  return result;
+}
+
+INTERPRETER_NAMESPACE_END
@@ -0,0 +1,81 @@
+/**
+ * This file provides implementation of @code{counter_registry} interfaces.
+ *
+ * @author 19030500131 zy
+ */
+#include <Utils/Counters.h>
+#include <map>
+#include <mutex>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+// The nodes of std::map are never moved, so the references to the
+// counters stay valid when new counters are added.
+using group_t = std::map<std::string, counter>;
+
+std::map<std::string, group_t>& get_groups() {
+  static std::map<std::string, group_t> groups;
+  return groups;
+}
+
+std::mutex& get_mutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+void append_json_string(std::string& out, const std::string& str) {
+  out += '"';
+  for (char ch : str) {
+    if (ch == '"' || ch == '\\')
+      out += '\\';
+    out += ch;
+  }
+  out += '"';
+}
+} // namespace
+
+counter& counter_registry::get(string_ref group, string_ref name) {
+  std::lock_guard<std::mutex> lock(get_mutex());
+  return get_groups()[group.str()][name.str()];
+}
+
+void counter_registry::reset() {
+  std::lock_guard<std::mutex> lock(get_mutex());
+  for (auto& [group_name, group] : get_groups()) {
+    for (auto& [name, value] : group)
+      value.reset();
+  }
+}
+
+std::string counter_registry::to_json() {
+  std::lock_guard<std::mutex> lock(get_mutex());
+  std::string result = "{";
+  bool first_group = true;
+  for (const auto& [group_name, group] : get_groups()) {
+    bool first = true;
+    for (const auto& [name, value] : group) {
+      std::uint64_t count = value.get();
+      if (count == 0)
+        continue;
+      if (first) {
+        if (!first_group)
+          result += ", ";
+        append_json_string(result, group_name);
+        result += ": {";
+        first_group = false;
+      } else {
+        result += ", ";
+      }
+      append_json_string(result, name);
+      result += ": " + std::to_string(count);
+      first = false;
+    }
+    if (!first)
+      result += '}';
+  }
+  result += '}';
+  return result;
+}
+
+INTERPRETER_NAMESPACE_END
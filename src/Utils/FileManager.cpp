@@ -1,4 +1,5 @@
 #include <Utils/FileManager.h>
+#include <algorithm>
 #include <fstream>
 #include <iterator>
 
@@ -45,4 +46,16 @@ std::error_code file_manager::from_file(const std::filesystem::path& file_path)
     return result_ec;
   return _read_file_and_set_to_buf(file_path, file_size);
 }
+
+void file_manager::from_buffer(const char* buf, std::size_t length,
+                               const std::filesystem::path& file_name) {
+  std::unique_ptr<char[]> _temp_buf(new char[length + 1]);
+  std::copy(buf, buf + length, _temp_buf.get());
+  _file_name = file_name;
+  _length = length;
+  // if the end of the file is not '\n', add it
+  if (!_length || _temp_buf[_length - 1] != '\n')
+    _temp_buf[_length++] = '\n';
+  _data_buf = std::move(_temp_buf);
+}
 INTERPRETER_NAMESPACE_END
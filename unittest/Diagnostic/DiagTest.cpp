@@ -290,6 +290,30 @@ TEST(diag_engine_test, location) {
   }
 }
 
+TEST(diag_engine_test, lazy_lines) {
+  // The lines are found while the diagnostics are made, in any order.
+  diag_engine engine;
+  temp_file_manager manager("first\n\nthird line\nfourth\n");
+  engine.set_file(&manager);
+  std::vector<std::tuple<std::size_t, std::size_t, string_ref>> expected = {
+    { 13, 2, "third line" }, { 2, 0, "first" }, { 20, 3, "fourth" },
+    { 6, 1, "" }, { 17, 2, "third line" }, { 24, 3, "fourth" },
+  };
+  for (auto [location, line, source] : expected) {
+    diag_builder result = engine.create_diag(err_test_type, location);
+    const diag_data& data = result.get_diag_data();
+    EXPECT_EQ(data.line_idx, line) << location;
+    EXPECT_EQ(data.source_line, source) << location;
+    EXPECT_FALSE(data.is_invalid) << location;
+  }
+  // A new file discards the lines of the old one.
+  temp_file_manager another("a\nb\n");
+  engine.set_file(&another);
+  diag_builder result = engine.create_diag(err_test_type, 2);
+  EXPECT_EQ(result.get_diag_data().line_idx, 1);
+  EXPECT_EQ(result.get_diag_data().source_line, "b");
+}
+
 TEST(diag_builder_test, param) {
   diag_engine engine;
   std::unique_ptr<test_diag_consumer> consumer = std::make_unique<test_diag_consumer>();
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+#include <Interpret/InternalSupport/Canvas.h>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+const cv::Scalar background(30, 20, 10);
+const cv::Scalar color(0, 0, 255, 255);
+
+bool is_background(const cv::Mat& image) {
+  for (int y = 0; y < image.rows; ++y) {
+    const uchar* row = image.ptr(y);
+    for (int x = 0; x < image.cols; ++x) {
+      if (row[3 * x] != 30 || row[3 * x + 1] != 20 || row[3 * x + 2] != 10)
+        return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+TEST(CanvasTest, untouched) {
+  canvas c(cv::Size(600, 300), background);
+  EXPECT_FALSE(c.empty());
+  EXPECT_EQ(c.allocated_tiles(), 0);
+  cv::Mat image = c.render_rows(0, 300);
+  EXPECT_EQ(image.rows, 300);
+  EXPECT_EQ(image.cols, 600);
+  EXPECT_TRUE(is_background(image));
+  EXPECT_TRUE(canvas().empty());
+}
+
+TEST(CanvasTest, allocate_on_touch) {
+  canvas c(cv::Size(600, 600), background);
+  c.circle(cv::Point(10, 10), 3, color, 0);
+  EXPECT_EQ(c.allocated_tiles(), 1);
+  c.circle(cv::Point(12, 12), 3, color, 0);
+  EXPECT_EQ(c.allocated_tiles(), 1);
+  // the circle covers four tiles
+  c.circle(cv::Point(512, 512), 3, color, 0);
+  EXPECT_EQ(c.allocated_tiles(), 5);
+  // the circle is off the canvas
+  c.circle(cv::Point(-100, 100), 3, color, 0);
+  EXPECT_EQ(c.allocated_tiles(), 5);
+  // fixed-point coordinates
+  c.circle(cv::Point(550 << 4, 100 << 4), 3 << 4, color, 4);
+  EXPECT_EQ(c.allocated_tiles(), 6);
+
+  EXPECT_FALSE(is_background(c.render_rows(0, 20)));
+  EXPECT_TRUE(is_background(c.render_rows(20, 80)));
+}
+
+TEST(CanvasTest, polylines) {
+  canvas c(cv::Size(1000, 1000), background);
+  c.polylines({ cv::Point(10, 10) }, color, 2, 0);
+  EXPECT_EQ(c.allocated_tiles(), 0);
+  // crosses the tiles in the first row
+  c.polylines({ cv::Point(10, 10), cv::Point(500, 10), cv::Point(990, 10) }, color, 2, 0);
+  EXPECT_EQ(c.allocated_tiles(), 4);
+  // goes back to the first tile through the second row
+  c.polylines({ cv::Point(10, 300), cv::Point(700, 300), cv::Point(10, 400) }, color, 2, 0);
+  EXPECT_EQ(c.allocated_tiles(), 7);
+  EXPECT_TRUE(is_background(c.render_rows(500, 1000)));
+}
+
+TEST(CanvasTest, stamps) {
+  canvas c(cv::Size(600, 600), background);
+  EXPECT_TRUE(c.stamp(cv::Point(10, 10)));
+  EXPECT_FALSE(c.stamp(cv::Point(10, 10)));
+  EXPECT_TRUE(c.stamp(cv::Point(11, 10)));
+  EXPECT_TRUE(c.stamp(cv::Point(10, 11)));
+  EXPECT_TRUE(c.stamp(cv::Point(599, 599)));
+  EXPECT_FALSE(c.stamp(cv::Point(599, 599)));
+  // stamps do not allocate the tiles
+  EXPECT_EQ(c.allocated_tiles(), 0);
+  c.clear_stamps();
+  EXPECT_TRUE(c.stamp(cv::Point(10, 10)));
+  EXPECT_TRUE(c.stamp(cv::Point(599, 599)));
+}
+
+TEST(CanvasTest, write_ppm) {
+  canvas c(cv::Size(300, 270), background);
+  c.circle(cv::Point(5, 5), 2, color, 0);
+  std::string path = ::testing::TempDir() + "canvas_test.ppm";
+  ASSERT_TRUE(c.write(path, /* flip = */true));
+
+  std::ifstream in(path, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  std::string header = "P6\n300 270\n255\n";
+  ASSERT_EQ(data.size(), header.size() + 300 * 270 * 3);
+  EXPECT_EQ(data.substr(0, header.size()), header);
+  // The image is flipped, and the pixels are in RGB order.
+  cv::Mat rows = c.render_rows(0, 270);
+  for (int y = 0; y < 270; ++y) {
+    const uchar* expected = rows.ptr(269 - y);
+    const char* actual = data.data() + header.size() + 900 * y;
+    for (int x = 0; x < 300; ++x) {
+      ASSERT_EQ(static_cast<uchar>(actual[3 * x]), expected[3 * x + 2]);
+      ASSERT_EQ(static_cast<uchar>(actual[3 * x + 1]), expected[3 * x + 1]);
+      ASSERT_EQ(static_cast<uchar>(actual[3 * x + 2]), expected[3 * x]);
+    }
+  }
+  // The frames are the same PPM images.
+  std::ostringstream frames;
+  ASSERT_TRUE(c.write_frame(frames, /* flip = */true));
+  ASSERT_TRUE(c.write_frame(frames, /* flip = */true));
+  EXPECT_EQ(frames.str(), data + data);
+}
+
+TEST(CanvasTest, dirty_tiles) {
+  canvas c(cv::Size(600, 300), background);
+  // All the tiles of a new canvas have changed.
+  EXPECT_EQ(c.take_dirty_tiles(), std::vector<std::size_t>({ 0, 1, 2, 3, 4, 5 }));
+  EXPECT_TRUE(c.take_dirty_tiles().empty());
+  c.circle(cv::Point(10, 10), 3, color, 0);
+  c.circle(cv::Point(12, 12), 3, color, 0);
+  c.circle(cv::Point(520, 270), 3, color, 0);
+  EXPECT_EQ(c.take_dirty_tiles(), std::vector<std::size_t>({ 0, 5 }));
+  EXPECT_DOUBLE_EQ(c.touched_fraction(), (256.0 * 256 + 88.0 * 44) / (600 * 300));
+
+  // Only the drawn tiles are reset.
+  c.clear();
+  EXPECT_EQ(c.allocated_tiles(), 0);
+  EXPECT_TRUE(is_background(c.render_rows(0, 300)));
+  EXPECT_EQ(c.take_dirty_tiles(), std::vector<std::size_t>({ 0, 5 }));
+  // The stamps are cleared as well.
+  EXPECT_TRUE(c.stamp(cv::Point(10, 10)));
+  c.circle(cv::Point(300, 10), 3, color, 0);
+  EXPECT_EQ(c.take_dirty_tiles(), std::vector<std::size_t>({ 1 }));
+  EXPECT_DOUBLE_EQ(c.touched_fraction(), (2 * 256.0 * 256 + 88.0 * 44) / (600 * 300));
+}
+
+TEST(CanvasTest, frame_encoder) {
+  canvas c(cv::Size(600, 300), background);
+  frame_encoder encoder;
+  auto _check_frame = [&] {
+    std::ostringstream expected, actual;
+    ASSERT_TRUE(c.write_frame(expected, /* flip = */true));
+    ASSERT_TRUE(encoder.write(c, actual, /* flip = */true));
+    EXPECT_EQ(actual.str(), expected.str());
+  };
+  _check_frame();
+  c.circle(cv::Point(10, 10), 3, color, 0);
+  _check_frame();
+  c.polylines({ cv::Point(10, 290), cv::Point(590, 20) }, color, 2, 0);
+  _check_frame();
+  _check_frame();
+  c.clear();
+  c.circle(cv::Point(300, 150), 3, color, 0);
+  _check_frame();
+  // A new canvas of the same size.
+  c = canvas(cv::Size(600, 300), color);
+  _check_frame();
+}
+
+TEST(CanvasTest, translucent) {
+  canvas c(cv::Size(300, 300), background);
+  cv::Scalar red(0, 0, 255, 128);
+  // The translucent discs add up.
+  c.circle(cv::Point(10, 10), 5, red, 0);
+  cv::Vec3b once = c.render_rows(10, 11).at<cv::Vec3b>(0, 10);
+  EXPECT_EQ(once, cv::Vec3b({ 15, 10, 133 }));
+  c.circle(cv::Point(10, 10), 5, red, 0);
+  cv::Vec3b twice = c.render_rows(10, 11).at<cv::Vec3b>(0, 10);
+  EXPECT_EQ(twice, cv::Vec3b({ 7, 5, 194 }));
+  // The mask is cleared after each primitive.
+  c.polylines({ cv::Point(200, 200), cv::Point(250, 200) }, red, 2, 0);
+  EXPECT_EQ(c.render_rows(10, 11).at<cv::Vec3b>(0, 10), twice);
+  EXPECT_EQ(c.render_rows(200, 201).at<cv::Vec3b>(0, 220), once);
+}
+
+TEST(CanvasTest, translucent_crossing) {
+  canvas c(cv::Size(512, 256), background);
+  cv::Scalar red(0, 0, 255, 128);
+  // The polyline leaves the first tile and crosses itself at (200, 100)
+  // when it comes back, where it is blended only once.
+  c.polylines({ cv::Point(100, 100), cv::Point(400, 100), cv::Point(400, 200), cv::Point(100, 50) },
+              red, 4, 0);
+  cv::Mat row = c.render_rows(100, 101);
+  EXPECT_EQ(row.at<cv::Vec3b>(0, 200), row.at<cv::Vec3b>(0, 150));
+}
+
+TEST(CanvasTest, premultiplied_alpha) {
+  // The 8-bit pixels may lose a bit when the alpha is divided.
+  auto _expect_near = [](const cv::Mat& rows, int x, const cv::Vec4b& expected) {
+    const cv::Vec4b& actual = rows.at<cv::Vec4b>(0, x);
+    for (int c = 0; c < 4; ++c)
+      EXPECT_NEAR(actual[c], expected[c], 1) << c;
+  };
+  for (auto format : { canvas::pixel_format::bgra, canvas::pixel_format::bgra_float }) {
+    canvas c(cv::Size(300, 300), cv::Scalar(0, 0, 0, 0), format);
+    EXPECT_EQ(c.channels(), 4);
+    cv::Mat rows = c.render_rows(0, 1);
+    EXPECT_EQ(rows.channels(), 4);
+    _expect_near(rows, 0, { 0, 0, 0, 0 });
+    // The color keeps its value, and only the alpha adds up.
+    c.circle(cv::Point(10, 10), 5, cv::Scalar(0, 100, 200, 128), 0);
+    _expect_near(c.render_rows(10, 11), 10, { 0, 100, 200, 128 });
+    c.circle(cv::Point(10, 10), 5, cv::Scalar(0, 100, 200, 128), 0);
+    _expect_near(c.render_rows(10, 11), 10, { 0, 100, 200, 192 });
+    c.circle(cv::Point(100, 10), 5, color, 0);
+    _expect_near(c.render_rows(10, 11), 100, { 0, 0, 255, 255 });
+    // The wide rows are blended 16 pixels at a time.
+    c.polylines({ cv::Point(100, 200), cv::Point(200, 200) }, cv::Scalar(0, 100, 200, 128), 4, 0);
+    _expect_near(c.render_rows(200, 201), 150, { 0, 100, 200, 128 });
+    // The frames have no alpha.
+    std::ostringstream frame;
+    ASSERT_TRUE(c.write_frame(frame, /* flip = */false));
+    std::string header = "P6\n300 300\n255\n";
+    ASSERT_EQ(frame.str().size(), header.size() + 300 * 300 * 3);
+    EXPECT_NEAR(static_cast<uchar>(frame.str()[header.size() + 3 * (10 * 300 + 10)]), 200, 1);
+    c.clear();
+    _expect_near(c.render_rows(10, 11), 10, { 0, 0, 0, 0 });
+  }
+}
+
+TEST(CanvasTest, float_precision) {
+  cv::Scalar faint(255, 255, 255, 1);
+  canvas bgra(cv::Size(20, 20), cv::Scalar(0, 0, 0, 255), canvas::pixel_format::bgra);
+  canvas bgra_float(cv::Size(20, 20), cv::Scalar(0, 0, 0, 255), canvas::pixel_format::bgra_float);
+  for (int i = 0; i < 255; ++i) {
+    bgra.circle(cv::Point(10, 10), 3, faint, 0);
+    bgra_float.circle(cv::Point(10, 10), 3, faint, 0);
+  }
+  // The 8-bit pixels stop changing at 128, where a faint color
+  // changes less than a half.
+  EXPECT_EQ(bgra.render_rows(10, 11).at<cv::Vec4b>(0, 10)[0], 128);
+  EXPECT_EQ(bgra_float.render_rows(10, 11).at<cv::Vec4b>(0, 10)[0], 161);
+}
+
+INTERPRETER_NAMESPACE_END
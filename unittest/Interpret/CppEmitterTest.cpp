@@ -0,0 +1,134 @@
+#include <MockTools.h>
+#include <Sema/Sema.h>
+#include <Interpret/InternalSupport/InternalImpl.h>
+#include <Interpret/CppEmitter.h>
+#include <Interpret/Serve.h>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+/**
+ * The main function of the program emitted from EmittedSample.txt (see
+ * unittest/Interpret/CMakeLists.txt).
+ */
+int emitted_sample_main(int argc, char* argv[]);
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+class CppEmitterTest : public ::testing::Test {
+protected:
+  diag_engine engine;
+  test_diag_consumer consumer;
+  std::unique_ptr<test_file_manager> manager;
+  std::unique_ptr<lexer> l;
+  symbol_table table;
+  internal_impl impl;
+
+  void SetUp() override {
+    engine.set_consumer(&consumer);
+    impl.export_all_symbols(table);
+  }
+
+  template<std::size_t N>
+  std::optional<std::string> emit(const char(& str)[N]) {
+    consumer.clear();
+    manager = std::make_unique<test_file_manager>(str);
+    engine.set_file(manager.get());
+    l = std::make_unique<lexer>(manager.get(), engine);
+    parser p(*l);
+    sema action(engine, table);
+    return cpp_emitter(action).emit(p.parse_program(), *manager);
+  }
+
+  static bool contains(const std::string& code, const char* str) {
+    return code.find(str) != std::string::npos;
+  }
+
+  static std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  }
+};
+} // namespace
+
+TEST_F(CppEmitterTest, parameters) {
+  auto code = emit("n is 40;\n"
+                   "r is n / 3;\n"
+                   "name is \"a\\\"b\";\n"
+                   "for T from 0 to n step 1 {\n"
+                   "  m is T * r;\n"
+                   "  draw(m, n);\n"
+                   "}");
+  ASSERT_TRUE(code);
+  EXPECT_EQ(consumer.get_data_size(), 0);
+  // The variables defined at the top level are the parameters.
+  EXPECT_TRUE(contains(*code, "INTEGER_T v_n{};"));
+  EXPECT_TRUE(contains(*code, "number_value v_r{ 0, true };"));
+  EXPECT_TRUE(contains(*code, "STRING_T v_name{};"));
+  EXPECT_TRUE(contains(*code, "rt.parse_parameters(argc, argv, { \"n\", \"r\", \"name\" })"));
+  EXPECT_TRUE(contains(*code, "rt.apply_parameter(\"name\", v_name);"));
+  EXPECT_FALSE(contains(*code, "rt.apply_parameter(\"m\""));
+  // The strings are escaped.
+  EXPECT_TRUE(contains(*code, "STRING_T(\"a\\\"b\")"));
+  // The predefined symbols are accessed directly.
+  EXPECT_TRUE(contains(*code, "rt._internal_draw_xy(success, { 85, 86, 88, 89 }"));
+  EXPECT_TRUE(contains(*code, "transpiled_runtime::float_point(rt.var_t())"));
+  EXPECT_TRUE(contains(*code, "transpiled_runtime::stroke_scope"));
+}
+
+TEST_F(CppEmitterTest, overloads) {
+  // The overload is chosen when running the program if it depends on
+  // the type of one argument.
+  auto code = emit("n is 3;\n"
+                   "print(n / 2);\n"
+                   "print(abs(n));");
+  ASSERT_TRUE(code);
+  EXPECT_TRUE(contains(*code, "->is_integer) { "));
+  EXPECT_TRUE(contains(*code, "rt._internal_print_integer("));
+  EXPECT_TRUE(contains(*code, "rt._internal_print_double("));
+  EXPECT_TRUE(contains(*code, "rt._internal_abs_integer("));
+  EXPECT_FALSE(contains(*code, "rt._internal_abs_float("));
+}
+
+TEST_F(CppEmitterTest, unsupported) {
+  EXPECT_FALSE(emit("x is \"a\" + 1;"));
+  ASSERT_EQ(consumer.get_data_size(), 1);
+  EXPECT_EQ(consumer.get_data().level, diag_data::ERROR);
+  EXPECT_EQ(consumer.get_data()._result_diag_message,
+            "cannot translate the operators on strings and tuples to C++");
+
+  EXPECT_FALSE(emit("n is 2;\np is (n / 3, 1);"));
+  ASSERT_EQ(consumer.get_data_size(), 1);
+  EXPECT_EQ(consumer.get_data()._result_diag_message,
+            "cannot deduce the type of 'p' before running the program");
+
+  // The errors the interpreter would report are reported while emitting.
+  EXPECT_FALSE(emit("draw(1);"));
+  EXPECT_EQ(consumer.get_data()._result_diag_message, "no matching function for call to 'draw'");
+  EXPECT_FALSE(emit("line_width is \"a\";"));
+  EXPECT_EQ(consumer.get_data_size(), 1);
+}
+
+TEST_F(CppEmitterTest, emitted_program) {
+  // The emitted program draws the same picture and prints the same
+  // output as the interpreter.
+  std::string source = read_file(EMITTED_SAMPLE_SOURCE);
+  ASSERT_FALSE(source.empty());
+  render_result expected = render_context().run(source, std::chrono::seconds(10));
+  ASSERT_EQ(expected.status, "ok");
+  ASSERT_TRUE(expected.diagnostics.empty()) << expected.diagnostics;
+
+  std::string path = ::testing::TempDir() + "emitted_sample.ppm";
+  std::string name = "emitted_sample", parameter = "path=" + path;
+  char* argv[] = { name.data(), parameter.data(), nullptr };
+  std::ostringstream output;
+  std::streambuf* old_buf = std::cout.rdbuf(output.rdbuf());
+  int status = emitted_sample_main(2, argv);
+  std::cout.rdbuf(old_buf);
+  EXPECT_EQ(status, 0);
+  EXPECT_EQ(output.str(), expected.output);
+  EXPECT_EQ(read_file(path), expected.image);
+}
+
+INTERPRETER_NAMESPACE_END
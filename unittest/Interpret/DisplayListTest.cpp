@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <Interpret/InternalSupport/DisplayList.h>
+#include <fstream>
+#include <sstream>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+/**
+ * Prints the records in a readable form.
+ */
+struct test_visitor {
+  std::ostringstream out;
+
+  void on_canvas(cv::Size size, const std::array<INTEGER_T, 4>& color, canvas::pixel_format format) {
+    out << "canvas " << size.width << 'x' << size.height << ' '
+        << color[0] << ',' << color[1] << ',' << color[2] << ',' << color[3] << ' '
+        << static_cast<int>(format) << ';';
+  }
+  void on_state(const display_list::draw_state& state) {
+    out << "state " << state.origin[0] << ',' << state.origin[1] << ' '
+        << state.scale[0] << ',' << state.scale[1] << ' ' << state.rot << ' '
+        << state.line_width << ' ' << state.line_color[3] << ' ' << state.line_mode << ';';
+  }
+  void on_point(cv::Point2d p, std::size_t site) {
+    out << "point " << p.x << ',' << p.y << '@' << site << ';';
+  }
+  void on_begin_stroke() { out << "begin;"; }
+  void on_end_stroke() { out << "end;"; }
+  void on_skip_points() { out << "skip;"; }
+  void on_flush() { out << "flush;"; }
+  void on_clear() { out << "clear;"; }
+};
+
+display_list::draw_state make_state(INTEGER_T width) {
+  return { { 1, 2 }, { 3, 4 }, 0.5, width, { 0, 0, 0, 255 }, 0 };
+}
+} // namespace
+
+TEST(DisplayListTest, record) {
+  display_list list;
+  list.record_canvas(cv::Size(30, 40), { 255, 255, 255, 128 }, canvas::pixel_format::bgra);
+  list.record_begin_stroke();
+  list.record_state(make_state(1));
+  list.record_point(cv::Point2d(0.25, -1.5), 7);
+  // the state is not changed
+  list.record_state(make_state(1));
+  list.record_point(cv::Point2d(1, 2), 7);
+  list.record_state(make_state(2));
+  list.record_point(cv::Point2d(3, 4), 9);
+  list.record_skip_points();
+  list.record_end_stroke();
+  list.record_flush();
+  list.record_clear();
+
+  test_visitor visitor;
+  EXPECT_TRUE(list.replay(visitor));
+  EXPECT_EQ(visitor.out.str(),
+            "canvas 30x40 255,255,255,128 1;begin;state 1,2 3,4 0.5 1 255 0;point 0.25,-1.5@7;"
+            "point 1,2@7;state 1,2 3,4 0.5 2 255 0;point 3,4@9;skip;end;flush;clear;");
+}
+
+TEST(DisplayListTest, save_and_load) {
+  display_list list;
+  list.record_canvas(cv::Size(30, 40), { 1, 2, 3, 255 }, canvas::pixel_format::bgra_float);
+  list.record_state(make_state(1));
+  list.record_point(cv::Point2d(5, 6), 1);
+  std::string path = ::testing::TempDir() + "display_list_test.bin";
+  ASSERT_TRUE(list.save(path));
+
+  auto loaded = display_list::load(path);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(loaded->size(), list.size());
+  test_visitor expected, actual;
+  list.replay(expected);
+  EXPECT_TRUE(loaded->replay(actual));
+  EXPECT_EQ(actual.out.str(), expected.out.str());
+
+  // not a display list
+  std::ofstream(path) << "P6\n1 1\n255\n";
+  EXPECT_FALSE(display_list::load(path));
+  EXPECT_FALSE(display_list::load(::testing::TempDir() + "no_such_file.bin"));
+}
+
+TEST(DisplayListTest, broken) {
+  display_list list;
+  list.record_canvas(cv::Size(30, 40), { 1, 2, 3, 255 }, canvas::pixel_format::bgr);
+  list.record_point(cv::Point2d(5, 6), 1);
+  std::string path = ::testing::TempDir() + "display_list_test.bin";
+  ASSERT_TRUE(list.save(path));
+  // cuts the last point
+  std::ifstream in(path, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  std::ofstream(path, std::ios::binary) << data.substr(0, data.size() - 4);
+
+  auto loaded = display_list::load(path);
+  ASSERT_TRUE(loaded);
+  test_visitor visitor;
+  EXPECT_FALSE(loaded->replay(visitor));
+}
+
+INTERPRETER_NAMESPACE_END
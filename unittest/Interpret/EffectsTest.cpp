@@ -0,0 +1,78 @@
+#include <MockTools.h>
+#include <Interpret/Effects.h>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+class EffectsTest : public ::testing::Test {
+protected:
+  diag_engine engine;
+  test_diag_consumer consumer;
+  std::unique_ptr<test_file_manager> manager;
+  parser::stmt_group stmts;
+
+  void SetUp() override {
+    engine.set_consumer(&consumer);
+  }
+
+  /**
+   * Parses @param{str} and returns the effects of each statement.
+   */
+  template<std::size_t N>
+  std::vector<stmt_effects> get_effects(const char(& str)[N]) {
+    // The names in the effects refer to the source.
+    manager = std::make_unique<test_file_manager>(str);
+    engine.set_file(manager.get());
+    lexer l(manager.get(), engine);
+    parser p(l);
+    stmts = p.parse_program();
+    EXPECT_EQ(consumer.get_data_size(), 0);
+    std::vector<stmt_effects> result(stmts.size());
+    for (std::size_t i = 0; i < stmts.size(); ++i)
+      result[i].add(stmts[i].get());
+    return result;
+  }
+};
+} // namespace
+
+TEST_F(EffectsTest, reads_and_writes) {
+  auto effects = get_effects("a is b + c * 2;\n"
+                             "for T from a to B step 1 draw(T, -cos(d));\n"
+                             "print(a);");
+  ASSERT_EQ(effects.size(), 3);
+  EXPECT_TRUE(effects[0].reads("b"));
+  EXPECT_TRUE(effects[0].reads("c"));
+  EXPECT_FALSE(effects[0].reads("a"));
+  EXPECT_TRUE(effects[0].writes("a"));
+  EXPECT_FALSE(effects[0].draws());
+  EXPECT_TRUE(effects[1].reads("a"));
+  EXPECT_TRUE(effects[1].reads("B"));
+  EXPECT_FALSE(effects[1].reads("b"));
+  EXPECT_TRUE(effects[1].reads("d"));
+  // The keywords are spelled in lower case.
+  EXPECT_TRUE(effects[1].writes("t"));
+  EXPECT_TRUE(effects[1].draws());
+  EXPECT_FALSE(effects[1].has_io());
+  EXPECT_TRUE(effects[2].has_io());
+  EXPECT_TRUE(effects[2].get_writes().empty());
+}
+
+TEST_F(EffectsTest, depends_on) {
+  auto effects = get_effects("a is 1;\n"
+                             "b is 2;\n"
+                             "for T from 0 to b step 1 draw(T, T);\n"
+                             "line_width is 3;\n"
+                             "print(a);");
+  ASSERT_EQ(effects.size(), 5);
+  EXPECT_FALSE(effects[1].depends_on(effects[0]));
+  EXPECT_TRUE(effects[2].depends_on(effects[1]));
+  EXPECT_FALSE(effects[2].depends_on(effects[0]));
+  EXPECT_FALSE(effects[4].depends_on(effects[3]));
+  EXPECT_TRUE(effects[4].depends_on(effects[0]));
+  // The drawing state is read by the draw calls.
+  EXPECT_TRUE(effects[2].depends_on(effects[3]));
+  EXPECT_TRUE(stmt_effects::is_drawing_state("origin"));
+  EXPECT_FALSE(stmt_effects::is_drawing_state("a"));
+}
+
+INTERPRETER_NAMESPACE_END
@@ -0,0 +1,152 @@
+#include <MockTools.h>
+#include <Sema/Sema.h>
+#include <Interpret/InternalSupport/InternalImpl.h>
+#include <Interpret/Interpreter.h>
+#include <Interpret/Jit.h>
+#include <cmath>
+#include <cstring>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+class JitTest : public ::testing::Test {
+protected:
+  diag_engine engine;
+  test_diag_consumer consumer;
+  std::unique_ptr<test_file_manager> manager;
+  std::unique_ptr<lexer> l;
+  symbol_table table;
+  internal_impl impl;
+  FLOAT_POINT_T x = 0;
+  INTEGER_T i = 0;
+
+  void SetUp() override {
+    if (!jit_compiler::is_supported())
+      GTEST_SKIP();
+    engine.set_consumer(&consumer);
+    impl.export_all_symbols(table);
+    table.add_variable(token_kind::tk_identifier, "x", make_info_from_var(x));
+    table.add_variable(token_kind::tk_identifier, "i", make_info_from_var(i));
+  }
+
+  template<std::size_t N>
+  parser generate_parser(const char(& str)[N]) {
+    consumer.clear();
+    manager = std::make_unique<test_file_manager>(str);
+    engine.set_file(manager.get());
+    l = std::make_unique<lexer>(manager.get(), engine);
+    return parser(*l);
+  }
+
+  /**
+   * Compiles @param{str}, and checks that the compiled code computes
+   * the same value as the interpreter with the current values of the
+   * variables, or fails exactly when the interpreter makes a diagnostic.
+   */
+  template<std::size_t N>
+  void check_same(const char(& str)[N]) {
+    SCOPED_TRACE(str);
+    sema action(engine, table);
+    auto ast = generate_parser(str).parse_expr();
+    ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+    // The calls are bound when they are evaluated for the first time.
+    auto result = action.evaluate(ast.get());
+    action.infer_type(ast.get());
+    ASSERT_TRUE(jit_compiler::can_compile(ast.get()));
+    auto code = jit_compiler::compile_values({ ast.get() });
+    ASSERT_TRUE(code);
+    FLOAT_POINT_T jit_result = 0;
+    bool jit_success = (*code)(&jit_result);
+    ASSERT_EQ(jit_success, result.has_value());
+    if (!result)
+      return;
+    FLOAT_POINT_T expected = result->get_type().is(type::INTEGER)
+        ? unpack_value<INTEGER_T>(result->get_value())
+        : unpack_value<FLOAT_POINT_T>(result->get_value());
+    // The results must be exactly the same, including the sign of zero.
+    EXPECT_EQ(std::memcmp(&jit_result, &expected, sizeof(FLOAT_POINT_T)), 0)
+      << jit_result << " != " << expected;
+  }
+};
+} // namespace
+
+TEST_F(JitTest, arithmetic) {
+  std::pair<FLOAT_POINT_T, INTEGER_T> values[] = {
+    { 0, 0 }, { 2.5, 7 }, { -3.25, -4 }, { 1e10, 65536 }, { 0.1, 2147483647 },
+  };
+  for (auto [x_value, i_value] : values) {
+    x = x_value;
+    i = i_value;
+    check_same("x + i * 2 - 1.5");
+    check_same("i / 3 + x / 3");
+    check_same("i * i * i");
+    check_same("-(0 * x)");
+    check_same("-(0 * i) + 0");
+    check_same("-(0 * i) * x");
+    check_same("x * -(i * 0) - (-(0 * i) / 2)");
+    check_same("-i - x");
+    check_same("+x * -2");
+    check_same("i ** 2 + x ** 0.5");
+    check_same("2 ** i");
+    check_same("x ** i");
+    check_same("(i + 1) / (i - 1)");
+  }
+}
+
+TEST_F(JitTest, math_functions) {
+  FLOAT_POINT_T values[] = { 0, 0.5, 1, 2.75, 100 };
+  for (FLOAT_POINT_T value : values) {
+    x = value;
+    i = static_cast<INTEGER_T>(value) + 1;
+    check_same("sin(x) * cos(i)");
+    check_same("abs(x - 3) + abs(i * 0.5)");
+    check_same("sin(-(0 * i)) + cos(-i * i)");
+    check_same("tan(x) + ln(i)");
+    check_same("sin(PI * x) + E");
+  }
+}
+
+TEST_F(JitTest, fallback) {
+  // The compiled code fails where the interpreter makes a diagnostic.
+  x = 0;
+  i = 0;
+  check_same("1 / x");
+  check_same("1 / i");
+  check_same("ln(x - 1)");
+  check_same("2 ** (x + 1024)");
+  x = 1;
+  check_same("1 / x");
+  check_same("ln(x - 1 + 1)");
+  // Strings and tuples cannot be compiled.
+  sema action(engine, table);
+  auto ast = generate_parser("(x, 1)").parse_expr();
+  ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+  action.infer_type(ast.get());
+  EXPECT_FALSE(jit_compiler::can_compile(ast.get()));
+}
+
+TEST_F(JitTest, loop) {
+  const char code[] = "for T from 0 to 300 step 1 {\n"
+                      "  i is i + 1;\n"
+                      "  x is x + sin(T) * T / 3 - i;\n"
+                      "  x is x / (i - 100);\n"
+                      "}";
+  auto run = [&](bool jit) {
+    x = 0.5;
+    i = 0;
+    sema action(engine, table);
+    interpreter runner(action, impl);
+    if (jit)
+      runner.enable_jit();
+    runner.run_stmts(generate_parser(code).parse_program());
+    return consumer.get_data_size();
+  };
+  std::size_t diag_count = run(false);
+  FLOAT_POINT_T expected_x = x;
+  INTEGER_T expected_i = i;
+  EXPECT_EQ(run(true), diag_count);
+  EXPECT_EQ(i, expected_i);
+  EXPECT_EQ(std::memcmp(&x, &expected_x, sizeof(FLOAT_POINT_T)), 0);
+}
+
+INTERPRETER_NAMESPACE_END
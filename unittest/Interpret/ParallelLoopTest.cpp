@@ -0,0 +1,141 @@
+#include <MockTools.h>
+#include <Sema/Sema.h>
+#include <Interpret/InternalSupport/InternalImpl.h>
+#include <Interpret/Interpreter.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+class ParallelLoopTest : public ::testing::Test {
+protected:
+  diag_engine engine;
+  test_diag_consumer consumer;
+
+  void SetUp() override {
+    engine.set_consumer(&consumer);
+  }
+
+  struct run_result {
+    std::string list;
+    std::size_t diag_count;
+    FLOAT_POINT_T t;
+    std::size_t overlapped;
+  };
+
+  /**
+   * Runs @param{str} on @param{threads} threads, and returns the
+   * recorded display list.
+   */
+  template<std::size_t N>
+  run_result run(const char(& str)[N], std::size_t threads) {
+    consumer.clear();
+    test_file_manager manager(str);
+    engine.set_file(&manager);
+    lexer l(&manager, engine);
+    parser p(l);
+    symbol_table table;
+    internal_impl impl;
+    impl.export_all_symbols(table);
+    impl.start_recording();
+    sema action(engine, table);
+    interpreter runner(action, impl);
+    runner.enable_parallel(threads);
+    runner.run_stmts(p.parse_program());
+    std::string path = ::testing::TempDir() + "parallel_loop_test.bin";
+    EXPECT_TRUE(impl.get_display_list()->save(path));
+    std::ifstream file(path, std::ios::binary);
+    std::string list((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::remove(path.c_str());
+    return { std::move(list), consumer.get_data_size(),
+             unpack_value<FLOAT_POINT_T>(table.get_variable("t")->get_value()),
+             runner.get_schedule_stats().overlapped };
+  }
+
+  /**
+   * Checks that running @param{str} on several threads draws the same
+   * picture, and returns the number of the overlapped statements.
+   */
+  template<std::size_t N>
+  std::size_t check_same(const char(& str)[N]) {
+    SCOPED_TRACE(str);
+    run_result expected = run(str, 1);
+    EXPECT_EQ(expected.overlapped, 0);
+    std::size_t overlapped = 0;
+    for (std::size_t threads : { 2, 3, 8 }) {
+      run_result result = run(str, threads);
+      EXPECT_EQ(result.list, expected.list);
+      EXPECT_EQ(result.diag_count, expected.diag_count);
+      EXPECT_EQ(result.t, expected.t);
+      overlapped = std::max(overlapped, result.overlapped);
+    }
+    return overlapped;
+  }
+};
+} // namespace
+
+TEST_F(ParallelLoopTest, same_as_serial) {
+  check_same("origin is (250, 250);\n"
+             "r is 100;\n"
+             "for T from 0 to 2 * PI step PI / 5000 {\n"
+             "  draw(cos(T) * r, sin(T) * r);\n"
+             "  draw(T * 10, -(T * T) / 3);\n"
+             "}");
+  check_same("line_mode is 1;\n"
+             "line_width is 3;\n"
+             "for T from -100 to 100 step 0.01 draw(T * 2, abs(T) ** 1.5 / 10);");
+  check_same("i is 0;\n"
+             "for i from 0 to 40000 step 3 draw(i / 100 + 1, (i * i) / 10000000);\n"
+             "for T from 0 to i step 1 draw(T / 200, 10);");
+  // An Integer -0 is 0 in the next operation.
+  check_same("i is 2;\n"
+             "for T from 0 to 1000 step 1 draw(T, -(0 * i) * 2.5 + (0 * -i) / 4);");
+}
+
+TEST_F(ParallelLoopTest, diagnostics) {
+  // The iterations which make diagnostics run in the interpreter.
+  check_same("for T from -5 to 5 step 0.001 draw(ln(T) * 10, 1 / (T - 0.5));");
+  check_same("for T from 0 to 10000 step 1 draw(T / (T - 5000), 2 ** (T / 5));");
+}
+
+TEST_F(ParallelLoopTest, effects) {
+  // The loops which assign or print are not run in parallel, and still
+  // run as before.
+  check_same("x is 0;\n"
+             "for T from 0 to 1000 step 1 {\n"
+             "  x is x + T;\n"
+             "  draw(x / 1000, T);\n"
+             "}");
+  check_same("for T from 0 to 100 step 1 {\n"
+             "  line_width is T / 10 + 1;\n"
+             "  draw(T, T);\n"
+             "}");
+  check_same("for rot from 0 to 1 step 0.001 draw(100, 0);");
+}
+
+TEST_F(ParallelLoopTest, schedule) {
+  // The loops are evaluated ahead while the statements in front of
+  // them run, and the points are drawn in the order of the statements.
+  EXPECT_GT(check_same("origin is (100, 100);\n"
+                       "for T from 0 to 2 * PI step 0.001 draw(cos(T) * 50, sin(T) * 50);\n"
+                       "line_width is 3;\n"
+                       "scale is (2, 1);\n"
+                       "for T from 0 to 2 * PI step 0.001 draw(cos(T) * 80, sin(2 * T) * 80);\n"
+                       "r is 20;\n"
+                       "for T from -r to r step 0.01 draw(T, T ** 2 / r);\n"
+                       "for T from 0 to 100 step 0.01 draw(T, ln(T - 50));"), 0);
+  // The loop reading the variable assigned in front of it waits for
+  // the assignment.
+  check_same("a is 10;\n"
+             "for T from 0 to 1000 step 1 draw(T, a);\n"
+             "a is 20;\n"
+             "for T from 0 to 1000 step 1 draw(T, a);\n"
+             "T is 5;\n"
+             "for T to 2000 draw(T, a);");
+}
+
+INTERPRETER_NAMESPACE_END
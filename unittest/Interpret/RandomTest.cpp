@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <Interpret/InternalSupport/Random.h>
+#include <limits>
+#include <vector>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+TEST(RandomTest, known_answers) {
+  // The test vectors of Philox4x32-10 in Random123.
+  using block_t = philox_random::block_t;
+  EXPECT_EQ(philox_random::philox({ 0, 0, 0, 0 }, { 0, 0 }),
+            (block_t{ 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 }));
+  EXPECT_EQ(philox_random::philox({ 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+                                  { 0xffffffff, 0xffffffff }),
+            (block_t{ 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd }));
+  EXPECT_EQ(philox_random::philox({ 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 },
+                                  { 0xa4093822, 0x299f31d0 }),
+            (block_t{ 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }));
+}
+
+TEST(RandomTest, reproducible) {
+  philox_random a(42), b(42), c(43);
+  std::vector<FLOAT_POINT_T> values;
+  bool all_same = true;
+  for (int i = 0; i < 100; ++i) {
+    FLOAT_POINT_T value = a.next_uniform();
+    EXPECT_GE(value, 0);
+    EXPECT_LT(value, 1);
+    EXPECT_EQ(value, b.next_uniform());
+    all_same &= value == c.next_uniform();
+    values.push_back(value);
+  }
+  EXPECT_FALSE(all_same);
+  a.reseed(42);
+  EXPECT_EQ(a.get_position(), 0);
+  EXPECT_EQ(a.next_uniform(), values[0]);
+}
+
+TEST(RandomTest, random_access) {
+  // Any part of the sequence can be computed directly, in any order.
+  philox_random sequential(7);
+  std::vector<FLOAT_POINT_T> expected(1001);
+  for (FLOAT_POINT_T& value : expected)
+    value = sequential.next_uniform();
+  philox_random random(7);
+  for (std::size_t i : { 1000, 3, 0, 999, 500 })
+    EXPECT_EQ(random.uniform_at(i), expected[i]);
+  std::vector<FLOAT_POINT_T> part(600);
+  random.fill_uniform(401, part.data(), part.size());
+  for (std::size_t i = 0; i < part.size(); ++i)
+    EXPECT_EQ(part[i], expected[401 + i]);
+  random.next_uniform();
+  random.next_uniforms(part.data(), 10);
+  EXPECT_EQ(random.get_position(), 11);
+  for (std::size_t i = 0; i < 10; ++i)
+    EXPECT_EQ(part[i], expected[1 + i]);
+}
+
+TEST(RandomTest, integers) {
+  philox_random random;
+  std::vector<int> counts(5);
+  for (int i = 0; i < 5000; ++i) {
+    INTEGER_T value = random.next_integer(3, -1);
+    ASSERT_GE(value, -1);
+    ASSERT_LE(value, 3);
+    ++counts[value + 1];
+  }
+  for (int count : counts)
+    EXPECT_GT(count, 800);
+  EXPECT_EQ(random.next_integer(9, 9), 9);
+  INTEGER_T min = std::numeric_limits<INTEGER_T>::min();
+  INTEGER_T max = std::numeric_limits<INTEGER_T>::max();
+  INTEGER_T value = random.next_integer(min, max);
+  EXPECT_TRUE(value >= min && value <= max);
+}
+
+TEST(RandomTest, normals) {
+  philox_random a(1), b(1);
+  std::vector<FLOAT_POINT_T> values(20000);
+  a.next_normals(values.data(), values.size());
+  FLOAT_POINT_T sum = 0, square_sum = 0;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    if (i < 600) {
+      EXPECT_EQ(values[i], b.next_normal());
+    }
+    sum += values[i];
+    square_sum += values[i] * values[i];
+  }
+  FLOAT_POINT_T mean = sum / values.size();
+  EXPECT_NEAR(mean, 0, 0.05);
+  EXPECT_NEAR(square_sum / values.size() - mean * mean, 1, 0.05);
+}
+
+INTERPRETER_NAMESPACE_END
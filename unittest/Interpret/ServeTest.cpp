@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include <Interpret/Serve.h>
+#include <atomic>
+#include <filesystem>
+#include <cstdio>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+INTERPRETER_NAMESPACE_BEGIN
+
+using namespace std::chrono_literals;
+
+TEST(ServeTest, run) {
+  const std::string header = "P6\n8 4\n255\n";
+  render_context context;
+  render_result result = context.run("background_size is (8, 4);\n"
+                                     "a is 1 + 2;\n"
+                                     "print(a);\n"
+                                     "draw(1, 1);\n", 1s);
+  EXPECT_EQ(result.status, "ok");
+  EXPECT_EQ(result.output, "print: 3\n");
+  EXPECT_TRUE(result.diagnostics.empty());
+  // The final picture is returned if the program does not save it.
+  ASSERT_EQ(result.image.size(), header.size() + 8 * 4 * 3);
+  EXPECT_EQ(result.image.substr(0, header.size()), header);
+
+  // The saved picture is not written to the file, and the variables of
+  // the other programs are not seen.
+  std::string path = ::testing::TempDir() + "serve_test.pnm";
+  render_context other;
+  result = other.run("background_size is (8, 4);\n"
+                     "save(\"" + path + "\");\n"
+                     "print(a);\n", 1s);
+  EXPECT_EQ(result.status, "error");
+  EXPECT_TRUE(result.output.empty());
+  EXPECT_NE(result.diagnostics.find("error: "), std::string::npos);
+  EXPECT_EQ(result.image.substr(0, header.size()), header);
+  EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST(ServeTest, timeout) {
+  render_context context;
+  render_result result = context.run("x is 0;\n"
+                                     "for t from 0 to 1000000000 x is t;\n"
+                                     "print(x);\n", 50ms);
+  EXPECT_EQ(result.status, "timeout");
+  EXPECT_TRUE(result.output.empty());
+  EXPECT_NE(result.diagnostics.find("the program is stopped after running for 50 ms"),
+            std::string::npos);
+}
+
+TEST(ServeTest, random_count) {
+  // The count is checked before the numbers are made.
+  render_context context;
+  render_result result = context.run("print(rand_floats(2000000));\n", 1s);
+  EXPECT_EQ(result.status, "error");
+  EXPECT_TRUE(result.output.empty());
+  EXPECT_NE(result.diagnostics.find("invalid value '2000000' for 'rand_floats'"),
+            std::string::npos);
+}
+
+TEST(ServeTest, canvas_area) {
+  // The picture is never made, and the canvas keeps its default size.
+  render_context context;
+  render_result result = context.run("background_size is (60000, 60000);\n", 1s);
+  EXPECT_EQ(result.status, "error");
+  EXPECT_NE(result.diagnostics.find("the canvas cannot have more than 16777216 pixels"),
+            std::string::npos);
+  std::string header = "P6\n500 500\n255\n";
+  EXPECT_EQ(result.image.substr(0, header.size()), header);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+namespace {
+/**
+ * Sends @param{program} to the server at @param{path}, and returns the
+ * reply.
+ */
+std::string request(const std::string& path, const std::string& program) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address{ };
+  address.sun_family = AF_UNIX;
+  std::snprintf(address.sun_path, sizeof(address.sun_path), "%s", path.c_str());
+  if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+    close(fd);
+    return { };
+  }
+  EXPECT_EQ(write(fd, program.data(), program.size()), static_cast<ssize_t>(program.size()));
+  shutdown(fd, SHUT_WR);
+  std::string reply;
+  char buf[4096];
+  ssize_t length;
+  while ((length = read(fd, buf, sizeof(buf))) > 0)
+    reply.append(buf, static_cast<std::size_t>(length));
+  close(fd);
+  return reply;
+}
+} // namespace
+
+TEST(ServeTest, server) {
+  std::string path = ::testing::TempDir() + "serve_test.sock";
+  render_server server(path, 2, 5s);
+  ASSERT_TRUE(server.start());
+  // The requests are served at the same time.
+  std::string first;
+  std::thread client([&] { first = request(path, "background_size is (8, 4);\nprint(1);\n"); });
+  std::string second = request(path, "background_size is (8, 4);\nprint(2);\n");
+  client.join();
+
+  std::string header = "P6\n8 4\n255\n";
+  std::string image_size = std::to_string(header.size() + 8 * 4 * 3);
+  for (const auto& [reply, output] : { std::pair(first, "print: 1\n"),
+                                       std::pair(second, "print: 2\n") }) {
+    std::string expected = "ok 9 0 " + image_size + '\n' + output + header;
+    EXPECT_EQ(reply.substr(0, expected.size()), expected);
+    EXPECT_EQ(reply.size(), expected.size() + 8 * 4 * 3);
+  }
+
+  server.stop();
+  EXPECT_FALSE(std::filesystem::exists(path));
+  EXPECT_TRUE(request(path, "print(1);\n").empty());
+}
+
+TEST(ServeTest, slow_client) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  // Each byte arrives well within the time limit, but the program never
+  // ends.
+  std::atomic<bool> done = false;
+  std::thread client([&] {
+    while (!done && write(fds[1], " ", 1) == 1)
+      std::this_thread::sleep_for(10ms);
+  });
+  render_context context;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(serve_connection(fds[0], context, 100ms));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+  done = true;
+  client.join();
+  close(fds[0]);
+  close(fds[1]);
+}
+#endif
+
+INTERPRETER_NAMESPACE_END
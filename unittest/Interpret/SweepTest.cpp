@@ -0,0 +1,101 @@
+#include <MockTools.h>
+#include <Interpret/Sweep.h>
+#include <Interpret/Serve.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+class SweepTest : public ::testing::Test {
+protected:
+  diag_engine engine;
+  test_diag_consumer consumer;
+
+  void SetUp() override {
+    engine.set_consumer(&consumer);
+  }
+
+  static file_manager make_source(const std::string& code, const char* name) {
+    file_manager result;
+    result.from_buffer(code.data(), code.size(), name);
+    return result;
+  }
+
+  static std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  }
+
+  /**
+   * Returns the picture and the output of @param{code} run from scratch.
+   */
+  static std::string run_fresh(const std::string& code) {
+    render_result result = render_context().run(code, std::chrono::seconds(10));
+    EXPECT_TRUE(result.diagnostics.empty()) << result.diagnostics;
+    return result.image + result.output;
+  }
+};
+} // namespace
+
+TEST_F(SweepTest, fork_after_prefix) {
+  std::string dir = ::testing::TempDir();
+  auto make_code = [](const std::string& color, const std::string& width) {
+    return "background_size is (64, 64);\n"
+           "line_mode is 1;\n"
+           "x is 10;\n"
+           "for t from 0 to 40 step 1 draw(t, t + x);\n"
+           "line_color is " + color + ";\n"
+           "line_width is " + width + ";\n"
+           "for t from 0 to 40 step 1 draw(t, 50 - t);\n"
+           "print(x);\n"
+           "save(\"sweep_test.ppm\");\n";
+  };
+  file_manager program = make_source(make_code("(0, 0, 255)", "1"), "sweep_test.txt");
+  file_manager variants = make_source("-- the variants\n"
+                                      + dir + "sweep_a.ppm line_color is (255, 0, 0);\n"
+                                      + dir + "sweep_b.ppm  line_width is 3; line_color is (0, 255, 0);\n"
+                                      + dir + "sweep_c.ppm\n", "sweep_test.sweep");
+  parameter_sweep sweep(engine, program, variants);
+  ASSERT_EQ(sweep.get_variants().size(), 3);
+  // The loop in front of the first parameter runs once.
+  EXPECT_EQ(sweep.prefix_length(), 4);
+  std::vector<parameter_sweep::result> results = sweep.run(2);
+  ASSERT_EQ(results.size(), 3);
+  for (const parameter_sweep::result& result : results) {
+    EXPECT_TRUE(result.written);
+    EXPECT_EQ(result.output, "print: 10\n");
+    EXPECT_TRUE(result.diagnostics.empty());
+  }
+  EXPECT_EQ(read_file(dir + "sweep_a.ppm") + results[0].output,
+            run_fresh(make_code("(255, 0, 0)", "1")));
+  EXPECT_EQ(read_file(dir + "sweep_b.ppm") + results[1].output,
+            run_fresh(make_code("(0, 255, 0)", "3")));
+  EXPECT_EQ(read_file(dir + "sweep_c.ppm") + results[2].output,
+            run_fresh(make_code("(0, 0, 255)", "1")));
+  // The picture saved by the program is not written.
+  EXPECT_FALSE(std::filesystem::exists("sweep_test.ppm"));
+  EXPECT_EQ(consumer.get_data_size(), 0);
+}
+
+TEST_F(SweepTest, parameter_in_front) {
+  std::string dir = ::testing::TempDir();
+  file_manager program = make_source("x is 1;\nprint(x + y);\n", "sweep_test.txt");
+  file_manager variants = make_source(dir + "sweep_a.ppm y is 2;\n"
+                                      + dir + "sweep_b.ppm y is 3; draw(1, 1);\n",
+                                      "sweep_test.sweep");
+  parameter_sweep sweep(engine, program, variants);
+  // `draw` is not an assignment.
+  ASSERT_EQ(consumer.get_data_size(), 1);
+  EXPECT_EQ(consumer.get_data(0)._result_diag_message, "a variant can only assign the parameters");
+  EXPECT_EQ(consumer.get_data(0).line_idx, 1);
+  // `y` is not assigned by the program, so it is assigned first.
+  EXPECT_EQ(sweep.prefix_length(), 0);
+  std::vector<parameter_sweep::result> results = sweep.run(1);
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_EQ(results[0].output, "print: 3\n") << results[0].diagnostics;
+  EXPECT_EQ(results[1].output, "print: 4\n");
+}
+
+INTERPRETER_NAMESPACE_END
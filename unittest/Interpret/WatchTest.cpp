@@ -0,0 +1,123 @@
+#include <MockTools.h>
+#include <Interpret/Watch.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+class WatchTest : public ::testing::Test {
+protected:
+  diag_engine engine;
+  test_diag_consumer consumer;
+  static constexpr const char* image_path = "watch_test.ppm";
+
+  void SetUp() override {
+    engine.set_consumer(&consumer);
+  }
+
+  void TearDown() override {
+    std::remove(image_path);
+  }
+
+  static std::unique_ptr<file_manager> make_source(const std::string& code) {
+    auto result = std::make_unique<file_manager>();
+    result->from_buffer(code.data(), code.size(), "watch_test.txt");
+    return result;
+  }
+
+  /**
+   * Returns the picture saved by the last run and the values of
+   * @param{names} in @param{session}.
+   */
+  static std::string get_result(const watch_session& session,
+                                std::initializer_list<const char*> names) {
+    std::ifstream file(image_path, std::ios::binary);
+    std::string result((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_FALSE(result.empty());
+    for (const char* name : names) {
+      variable_info* info = session.get_symbol_table()->get_variable(name);
+      EXPECT_NE(info, nullptr) << name;
+      if (info)
+        result += typed_value(info->get_type(), info->get_value()).get_value_spelling();
+      result += ';';
+    }
+    return result;
+  }
+
+  /**
+   * Runs @param{code} in a new session, and returns the result.
+   */
+  std::string run_fresh(const std::string& code, std::initializer_list<const char*> names) {
+    watch_session session(engine);
+    EXPECT_EQ(session.run(make_source(code)), 0);
+    return get_result(session, names);
+  }
+};
+} // namespace
+
+TEST_F(WatchTest, restart_from_changed_stmt) {
+  std::string head = "background_size is (64, 64);\n"
+                     "line_mode is 1;\n"
+                     "x is 10;\n"
+                     "for t from 0 to 20 step 1 draw(t + x, t);\n"
+                     "seed is 3;\n"
+                     "z is rand_float(0, 1);\n";
+  std::string tail = "for t from 0 to 10 step 1 draw(y, t + z);\n"
+                     "save(\"watch_test.ppm\");\n";
+  std::initializer_list<const char*> names = { "x", "y", "z" };
+  watch_session session(engine);
+  EXPECT_EQ(session.run(make_source(head + "y is x * 2;\n" + tail)), 0);
+
+  std::string code = head + "y is x * 3 + rand_int(0, 5);\n" + tail;
+  EXPECT_EQ(session.run(make_source(code)), 6);
+  EXPECT_EQ(get_result(session, names), run_fresh(code, names));
+  // Nothing runs if the program is the same.
+  EXPECT_EQ(session.run(make_source(code)), 9);
+
+  code += "w is y + z;\n";
+  EXPECT_EQ(session.run(make_source(code)), 9);
+  EXPECT_EQ(get_result(session, { "w" }), run_fresh(code, { "w" }));
+
+  code.replace(code.find("x is 10"), 7, "x is 20");
+  EXPECT_EQ(session.run(make_source(code)), 2);
+  EXPECT_EQ(get_result(session, names), run_fresh(code, names));
+  EXPECT_EQ(consumer.get_data_size(), 0);
+}
+
+TEST_F(WatchTest, bounded_checkpoints) {
+  auto make_code = [](int changed) {
+    std::string code = "a0 is 0;\n";
+    for (int i = 1; i < 300; ++i) {
+      code += "a" + std::to_string(i) + " is a" + std::to_string(i - 1) +
+              (i == changed ? " + 2;\n" : " + 1;\n");
+    }
+    return code + "draw(a299, 0);\nsave(\"watch_test.ppm\");\n";
+  };
+  watch_session session(engine);
+  EXPECT_EQ(session.run(make_source(make_code(0))), 0);
+  EXPECT_LE(session.checkpoint_count(), watch_session::max_checkpoints);
+
+  std::string code = make_code(250);
+  std::size_t first = session.run(make_source(code));
+  EXPECT_LE(first, 250);
+  EXPECT_GT(first, 200);
+  EXPECT_EQ(get_result(session, { "a0", "a250", "a299" }),
+            run_fresh(code, { "a0", "a250", "a299" }));
+  EXPECT_EQ(consumer.get_data_size(), 0);
+}
+
+TEST_F(WatchTest, file_watcher) {
+  std::string path = ::testing::TempDir() + "watch_test_source.txt";
+  std::ofstream(path) << "draw(1, 1);\n";
+  file_watcher watcher(path);
+  ASSERT_TRUE(watcher.is_valid());
+  watcher.drain();
+  // The file is saved while the program runs, before waiting.
+  std::ofstream(path) << "draw(2, 2);\n";
+  EXPECT_TRUE(watcher.wait());
+  std::remove(path.c_str());
+}
+
+INTERPRETER_NAMESPACE_END
@@ -2,6 +2,7 @@
 #include <Lex/Lexer.h>
 #include <Diagnostic/DiagConsumer.h>
 #include <Diagnostic/DiagData.h>
+#include <Utils/Counters.h>
 #include <MockTools.h>
 
 INTERPRETER_NAMESPACE_BEGIN
@@ -214,4 +215,18 @@ TEST_F(LexerTest, cache) {
   }
 }
 
+TEST_F(LexerTest, counters) {
+  counter_registry::reset();
+  counter_registry::enable();
+  lexer l = generate_lexer("abc 12..3;");
+  l.look_ahead(2);
+  // The cached tokens are counted once.
+  auto result = lex_all(l);
+  counter_registry::enable(false);
+  EXPECT_EQ(result.size(), 5);
+  EXPECT_EQ(counter_registry::get("lexer", "tokens").get(), 5);
+  EXPECT_EQ(counter_registry::get("diagnostics", "err_unknown_char").get(), 1);
+  counter_registry::reset();
+}
+
 INTERPRETER_NAMESPACE_END
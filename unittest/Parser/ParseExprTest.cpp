@@ -52,7 +52,7 @@ public:
   }
   void visit_string_expr(string_expr* e) {
     assert(e);
-    result += e->get_value() + ' ';
+    result += e->get_value().str() + ' ';
   }
 
   std::string take_result() && { return std::move(result); }
@@ -107,7 +107,16 @@ TEST_F(ParserTest, SingleExpr) {
     char code[] = R"((1, (3), 2 + 7, a*3, (2 + a(3, (4, 5))), (1, 2, 3 + 5)))";
     EXPECT_EQ(PARSE_CODE(code), "(1 , 3 , 2 7 + , a 3 * , 2 a(3 , (4 , 5 , ) , ) + , (1 , 2 , 3 5 + , ) , ) ");
   }
+  // number
+  {
+    char code[] = R"(12. + 0.125 + 007)";
+    EXPECT_EQ(PARSE_CODE(code), "12 0.125 + 7 + ");
+  }
   // string
+  {
+    char code[] = R"("")";
+    EXPECT_EQ(PARSE_CODE(code), " ");
+  }
   {
     char code[] = R"("abc""bcd""ef")";
     EXPECT_EQ(PARSE_CODE(code), "abcbcdef ");
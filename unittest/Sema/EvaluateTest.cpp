@@ -2,6 +2,9 @@
 #include <Sema/Sema.h>
 #include <Interpret/InternalSupport/InternalImpl.h>
 #include <Interpret/Interpreter.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 #include <sstream>
 
 INTERPRETER_NAMESPACE_BEGIN
@@ -858,6 +861,55 @@ TEST_F(EvaluateTest, unary_minus) {
   }
 }
 
+TEST_F(EvaluateTest, numeric_tuple) {
+  {
+    char code[] = "(1, 4, 9) ** 0.5";
+    auto result = evaluate(code);
+    EXPECT_TRUE(result);
+    EXPECT_TRUE(result->get_type().get_sub_type().is(type::INTEGER));
+    using real_t = std::vector<INTEGER_T>;
+    real_t expected = {1, 2, 3};
+    EXPECT_EQ(unpack_value<real_t>(result->get_value()), expected);
+    EXPECT_EQ(consumer.get_data_size(), 0);
+  }
+  {
+    // The elements which are Integers are converted to Doubles as well.
+    char code[] = "(0, 2147483647) * -2";
+    auto result = evaluate(code);
+    EXPECT_TRUE(result);
+    EXPECT_TRUE(result->get_type().get_sub_type().is(type::FLOAT_POINT));
+    auto value = unpack_value<std::vector<FLOAT_POINT_T>>(result->get_value());
+    ASSERT_EQ(value.size(), 2);
+    EXPECT_EQ(value[0], 0);
+    EXPECT_FALSE(std::signbit(value[0]));
+    EXPECT_EQ(value[1], -4294967294.0);
+  }
+  {
+    char code[] = "-(0, -2147483647 - 1)";
+    auto result = evaluate(code);
+    EXPECT_TRUE(result);
+    EXPECT_TRUE(result->get_type().get_sub_type().is(type::FLOAT_POINT));
+    auto value = unpack_value<std::vector<FLOAT_POINT_T>>(result->get_value());
+    ASSERT_EQ(value.size(), 2);
+    EXPECT_FALSE(std::signbit(value[0]));
+    EXPECT_EQ(value[1], 2147483648.0);
+  }
+  {
+    char code[] = "(1, 2.5, 10 ** 300) ** 2";
+    auto result = evaluate(code);
+    EXPECT_FALSE(result);
+    ASSERT_EQ(consumer.get_data_size(), 1);
+    EXPECT_EQ(consumer.get_data()._result_diag_message,
+              "invalid result of powering '1e+300' and '2'");
+  }
+  {
+    char code[] = "(1, 2) / 0";
+    auto result = evaluate(code);
+    EXPECT_FALSE(result);
+    EXPECT_EQ(consumer.get_data_size(), 2);
+  }
+}
+
 TEST_F(EvaluateTest, Multi) {
   symbol_table table;
   table.add_variable(token_kind::tk_identifier, "iglobaltest", make_info_from_var(iglobaltest));;
@@ -877,5 +929,319 @@ TEST_F(EvaluateTest, Multi) {
   }
 }
 
+TEST_F(EvaluateTest, infer) {
+  INTEGER_T ival = 2;
+  symbol_table table;
+  table.add_variable(token_kind::tk_identifier, "ival", make_info_from_var(ival));
+  table.add_function(token_kind::tk_identifier, "iiifun", make_info_from_func(&iiifun));
+  sema action(engine, table);
+  {
+    char code[] = "ival * 2 + 1.5";
+    auto ast = generate_parser(code).parse_expr();
+    ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+    EXPECT_EQ(action.infer_type(ast.get()), expr::ik_float_point);
+    auto* e = static_cast<binary_expr*>(ast.get());
+    EXPECT_EQ(e->get_lhs()->get_inferred_kind(), expr::ik_number);
+    EXPECT_TRUE(e->get_kernel());
+    EXPECT_FALSE(e->is_inferred_constant());
+    auto result = action.evaluate(ast.get());
+    EXPECT_TRUE(result);
+    EXPECT_TRUE(result->get_type().is(type::FLOAT_POINT));
+    EXPECT_DOUBLE_EQ(unpack_value<FLOAT_POINT_T>(result->get_value()), 5.5);
+    // the kernel reads the current value of the variable
+    ival = 2147483647;
+    result = action.evaluate(ast.get());
+    EXPECT_TRUE(result);
+    EXPECT_DOUBLE_EQ(unpack_value<FLOAT_POINT_T>(result->get_value()), 4294967295.5);
+    EXPECT_EQ(consumer.get_data_size(), 0);
+  }
+  {
+    // The result of Integer * Integer depends on the value.
+    char code[] = "ival * ival";
+    auto ast = generate_parser(code).parse_expr();
+    ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+    ival = 3;
+    auto result = action.evaluate(ast.get());
+    EXPECT_EQ(ast->get_inferred_kind(), expr::ik_number);
+    EXPECT_TRUE(result->get_type().is(type::INTEGER));
+    EXPECT_EQ(unpack_value<INTEGER_T>(result->get_value()), 9);
+    ival = 65536;
+    result = action.evaluate(ast.get());
+    EXPECT_TRUE(result->get_type().is(type::FLOAT_POINT));
+    EXPECT_DOUBLE_EQ(unpack_value<FLOAT_POINT_T>(result->get_value()), 4294967296.0);
+  }
+  {
+    // The call is inferred after it is bound to a function.
+    char code[] = "-iiifun(1, 2) / 2";
+    auto ast = generate_parser(code).parse_expr();
+    ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+    EXPECT_EQ(action.infer_type(ast.get()), expr::ik_unknown);
+    auto result = action.evaluate(ast.get());
+    EXPECT_TRUE(result);
+    EXPECT_DOUBLE_EQ(unpack_value<FLOAT_POINT_T>(result->get_value()), -1.5);
+    EXPECT_EQ(action.infer_type(ast.get()), expr::ik_number);
+    EXPECT_TRUE(ast->get_kernel());
+    result = action.evaluate(ast.get());
+    EXPECT_TRUE(result);
+    EXPECT_DOUBLE_EQ(unpack_value<FLOAT_POINT_T>(result->get_value()), -1.5);
+  }
+  {
+    // An Integer -0 is 0 in the next operation, as in the generic
+    // evaluator.
+    ival = 3;
+    char codes[][18] = { "-(0 * ival) * 2.5", "(0 * -ival) * 2.5" };
+    for (auto& code : codes) {
+      auto ast = generate_parser(code).parse_expr();
+      ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+      EXPECT_EQ(action.infer_type(ast.get()), expr::ik_float_point);
+      auto result = action.evaluate(ast.get());
+      EXPECT_TRUE(result);
+      EXPECT_EQ(unpack_value<FLOAT_POINT_T>(result->get_value()), 0);
+      EXPECT_FALSE(std::signbit(unpack_value<FLOAT_POINT_T>(result->get_value()))) << code;
+    }
+  }
+  {
+    char code[] = "(1, 2) * 2";
+    auto ast = generate_parser(code).parse_expr();
+    ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+    EXPECT_EQ(action.infer_type(ast.get()), expr::ik_tuple);
+    EXPECT_FALSE(ast->get_kernel());
+    EXPECT_TRUE(ast->is_inferred_constant());
+  }
+  {
+    char code[] = "1 / 0";
+    auto ast = generate_parser(code).parse_expr();
+    ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+    EXPECT_FALSE(action.evaluate(ast.get()));
+    EXPECT_EQ(consumer.get_data_size(), 2);
+  }
+}
+
+int sin_calls = 0, cos_calls = 0, abs_calls = 0, next_calls = 0;
+
+FLOAT_POINT_T counted_sin(FLOAT_POINT_T v) { ++sin_calls; return std::sin(v); }
+
+FLOAT_POINT_T counted_cos(FLOAT_POINT_T v) { ++cos_calls; return std::cos(v); }
+
+FLOAT_POINT_T counted_abs(FLOAT_POINT_T v) { ++abs_calls; return std::abs(v); }
+
+FLOAT_POINT_T ffnext(FLOAT_POINT_T v) { return v + ++next_calls; }
+
+TEST_F(EvaluateTest, common_subexprs) {
+  FLOAT_POINT_T x = 1;
+  INTEGER_T n = 3;
+  symbol_table table;
+  table.add_variable(token_kind::tk_identifier, "x", make_info_from_var(x));
+  table.add_variable(token_kind::tk_identifier, "n", make_info_from_var(n));
+  table.add_function(token_kind::tk_identifier, "sin", make_info_from_func(&counted_sin));
+  table.add_function(token_kind::tk_identifier, "cos", make_info_from_func(&counted_cos));
+  table.add_function(token_kind::tk_identifier, "abs", make_info_from_func(&counted_abs));
+  table.add_function(token_kind::tk_identifier, "next", make_info_from_func(&ffnext));
+  sema action(engine, table);
+  {
+    char code[] = "abs(x - 3) * abs(x - 3) + abs(x - 3)";
+    auto ast = generate_parser(code).parse_expr();
+    ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+    // The calls are bound in the first evaluation.
+    EXPECT_TRUE(action.evaluate(ast.get()));
+    for (FLOAT_POINT_T value : { 5.0, -2.5 }) {
+      x = value;
+      abs_calls = 0;
+      auto result = action.evaluate(ast.get());
+      ASSERT_TRUE(result);
+      EXPECT_DOUBLE_EQ(unpack_value<FLOAT_POINT_T>(result->get_value()),
+                       std::abs(value - 3) * std::abs(value - 3) + std::abs(value - 3));
+      EXPECT_EQ(abs_calls, 1);
+    }
+  }
+  {
+    char code[] = "(sin(x * 2) + 1, cos(x * 2) * sin(x * 2))";
+    auto ast = generate_parser(code).parse_expr();
+    ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+    EXPECT_TRUE(action.evaluate(ast.get()));
+    for (FLOAT_POINT_T value : { 0.5, 2.0 }) {
+      x = value;
+      sin_calls = cos_calls = 0;
+      auto result = action.evaluate(ast.get());
+      ASSERT_TRUE(result);
+      auto elems = unpack_value<std::vector<FLOAT_POINT_T>>(result->get_value());
+      ASSERT_EQ(elems.size(), 2);
+      EXPECT_EQ(elems[0], std::sin(value * 2) + 1);
+      EXPECT_EQ(elems[1], std::cos(value * 2) * std::sin(value * 2));
+      // Both are computed by the fused kernel.
+      EXPECT_EQ(sin_calls, 0);
+      EXPECT_EQ(cos_calls, 0);
+    }
+  }
+  {
+    // 2 and 2. have the same value but not the same kind, so the
+    // products do not share their values.
+    char codes[][18] = { "(n * 2, n * 2.)", "(n * 2., n * 2)", "(n * 2, 2. * n)" };
+    for (auto& code : codes) {
+      SCOPED_TRACE(code);
+      auto ast = generate_parser(code).parse_expr();
+      ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+      for (int i = 0; i < 2; ++i) {
+        auto result = action.evaluate(ast.get());
+        ASSERT_TRUE(result);
+        EXPECT_TRUE(result->get_type().get_sub_type().is(type::FLOAT_POINT));
+        auto elems = unpack_value<std::vector<FLOAT_POINT_T>>(result->get_value());
+        EXPECT_EQ(elems, std::vector<FLOAT_POINT_T>({ 6, 6 }));
+      }
+    }
+    auto ast = generate_parser("(n * 2 + 1) * (n * 2 + 1)").parse_expr();
+    ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+    auto result = action.evaluate(ast.get());
+    ASSERT_TRUE(result);
+    EXPECT_TRUE(result->get_type().is(type::INTEGER));
+    EXPECT_EQ(unpack_value<INTEGER_T>(result->get_value()), 49);
+  }
+  {
+    // The functions which are not pure are always called.
+    char code[] = "next(x) - next(x)";
+    auto ast = generate_parser(code).parse_expr();
+    ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+    EXPECT_TRUE(action.evaluate(ast.get()));
+    next_calls = 0;
+    auto result = action.evaluate(ast.get());
+    ASSERT_TRUE(result);
+    EXPECT_EQ(next_calls, 2);
+    EXPECT_DOUBLE_EQ(unpack_value<FLOAT_POINT_T>(result->get_value()), -1);
+  }
+  {
+    // A failed subexpression makes the same diagnostics each time.
+    char code[] = "1 / (x - x) + 1 / (x - x)";
+    auto ast = generate_parser(code).parse_expr();
+    ASSERT_TRUE(action.bind_expr_variables(ast.get()));
+    EXPECT_FALSE(action.evaluate(ast.get()));
+    EXPECT_EQ(consumer.get_data_size(), 4);
+  }
+}
+
+TEST_F(EvaluateTest, line_mode) {
+  {
+    char code[] = "line_mode is 1;";
+    run(code);
+    EXPECT_EQ(consumer.get_data_size(), 0);
+  }
+  {
+    char code[] = "line_mode is 2;";
+    run(code);
+    EXPECT_EQ(consumer.get_data_size(), 1);
+  }
+}
+
+TEST_F(EvaluateTest, stamps) {
+  // The red stroke covers the black point, so the black point drawn at
+  // the same place again is not skipped.
+  char code[] = "background_size is (20, 10);\n"
+                "draw(5, 5);\n"
+                "line_mode is 1;\n"
+                "line_color is (255, 0, 0);\n"
+                "for t from 0 to 10 step 1 draw(t, 5);\n"
+                "line_mode is 0;\n"
+                "line_color is (0, 0, 0);\n"
+                "draw(5, 5);";
+  symbol_table table;
+  internal_impl impl;
+  impl.export_all_symbols(table);
+  sema action(engine, table);
+  interpreter runner(action, impl);
+  runner.run_stmts(generate_parser(code).parse_program());
+  EXPECT_EQ(consumer.get_data_size(), 0);
+  std::string image;
+  ASSERT_TRUE(impl.encode_picture("picture.ppm", image));
+  std::string header = "P6\n20 10\n255\n";
+  ASSERT_EQ(image.size(), header.size() + 20 * 10 * 3);
+  // The picture is flipped vertically.
+  std::size_t center = header.size() + ((10 - 1 - 5) * 20 + 5) * 3;
+  EXPECT_EQ(image.substr(center, 3), std::string(3, '\0'));
+}
+
+TEST_F(EvaluateTest, color_depth) {
+  {
+    char code[] = "color_depth is 32;";
+    run(code);
+    EXPECT_EQ(consumer.get_data_size(), 0);
+  }
+  {
+    char code[] = "color_depth is 16;";
+    run(code);
+    EXPECT_EQ(consumer.get_data_size(), 1);
+  }
+  {
+    char code[] = "draw(0, 0); color_depth is 32;";
+    run(code);
+    EXPECT_EQ(consumer.get_data_size(), 1);
+  }
+}
+
+TEST_F(EvaluateTest, emit_frame) {
+  char code[] = "background_size is (20, 10);\n"
+                "for t from 0 to 3 step 1 {\n"
+                "  clear();\n"
+                "  draw(t * 5, 5);\n"
+                "  emit_frame(path);\n"
+                "}\n"
+                "clear();\n"
+                "emit_frame(path);";
+  // The path is given in a variable, so it is not escaped in the code.
+  STRING_T path = ::testing::TempDir() + "evaluate_test_frames.ppm";
+  symbol_table table;
+  internal_impl impl;
+  impl.export_all_symbols(table);
+  table.add_variable(token_kind::tk_identifier, "path", make_info_from_var(path));
+  sema action(engine, table);
+  interpreter runner(action, impl);
+  runner.run_stmts(generate_parser(code).parse_program());
+  EXPECT_EQ(consumer.get_data_size(), 0);
+  std::ifstream in(path, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  std::remove(path.c_str());
+  std::string header = "P6\n20 10\n255\n";
+  std::size_t frame_size = header.size() + 20 * 10 * 3;
+  ASSERT_EQ(data.size(), 4 * frame_size);
+  std::vector<std::string> frames;
+  for (std::size_t i = 0; i < 4; ++i) {
+    frames.push_back(data.substr(i * frame_size, frame_size));
+    EXPECT_EQ(frames[i].substr(0, header.size()), header);
+  }
+  // Each frame only has the point drawn after the last clear.
+  EXPECT_NE(frames[0], frames[1]);
+  EXPECT_NE(frames[1], frames[2]);
+  EXPECT_EQ(frames[3], header + std::string(20 * 10 * 3, static_cast<char>(255)));
+}
+
+TEST_F(EvaluateTest, for_loop) {
+  char code[] = "i is 0; n is 0;\n"
+                "for i from 0 to 10 step 1 {\n"
+                "  i is i + 2;\n"
+                "  n is n + 1;\n"
+                "}\n"
+                "x is 0.0; m is 0;\n"
+                "for x from 0 to 1 step 0.1 m is m + 1;\n"
+                "k is 0;\n"
+                "for k from -3 to 2.5 step 2 n is n + 1;";
+  symbol_table table;
+  internal_impl impl;
+  impl.export_all_symbols(table);
+  sema action(engine, table);
+  interpreter runner(action, impl);
+  runner.run_stmts(generate_parser(code).parse_program());
+  // The body assigns the loop variable.
+  EXPECT_EQ(unpack_value<INTEGER_T>(table.get_variable("i")->get_value()), 12);
+  // The values are accumulated by the additions.
+  FLOAT_POINT_T x = 0;
+  INTEGER_T m = 0;
+  for (; x < 1; x += 0.1)
+    ++m;
+  EXPECT_EQ(unpack_value<FLOAT_POINT_T>(table.get_variable("x")->get_value()), x);
+  EXPECT_EQ(unpack_value<INTEGER_T>(table.get_variable("m")->get_value()), m);
+  EXPECT_EQ(unpack_value<INTEGER_T>(table.get_variable("k")->get_value()), 3);
+  EXPECT_EQ(unpack_value<INTEGER_T>(table.get_variable("n")->get_value()), 7);
+  EXPECT_EQ(consumer.get_data_size(), 0);
+}
+
 } // namespace
 INTERPRETER_NAMESPACE_END
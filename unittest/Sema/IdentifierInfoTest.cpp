@@ -255,7 +255,58 @@ TEST(IdentifierInfo, variable) {
     auto result = val->take_value();
     EXPECT_EQ(unpack_value<vec_t>(val->get_value()), vec_t{});
   }
+  {
+    // The value rejected by the filter is not assigned.
+    std::vector<INTEGER_T> val = { 1, 2 };
+    auto var = make_info_from_var(val, [](diag_info_pack&, const std::vector<INTEGER_T>& v) {
+      return v.size() == 2;
+    });
+    pack.success = true;
+    for (INTEGER_T i = 0; i < 3; ++i) {
+      var->set_value(pack, pack_value(std::vector<INTEGER_T>{ i, i + 1 }));
+      EXPECT_TRUE(pack.success);
+      EXPECT_EQ(val, (std::vector<INTEGER_T>{ i, i + 1 }));
+    }
+    var->set_value(pack, pack_value(std::vector<INTEGER_T>{ 5 }));
+    EXPECT_FALSE(pack.success);
+    EXPECT_EQ(val, (std::vector<INTEGER_T>{ 2, 3 }));
+  }
 }
+
+TEST(IdentifierInfo, location_list) {
+  location_list locs{ 1, 2 };
+  EXPECT_EQ(locs.size(), 2);
+  EXPECT_EQ(locs[1], 2);
+  // The locations are moved to the heap when there are too many.
+  for (std::size_t i = 2; i < 2 * location_list::inline_size; ++i)
+    locs.push_back(i + 1);
+  EXPECT_EQ(locs.size(), 2 * location_list::inline_size);
+  for (std::size_t i = 0; i < locs.size(); ++i)
+    EXPECT_EQ(locs[i], i + 1);
+  location_list copy = locs;
+  EXPECT_TRUE(std::equal(copy.begin(), copy.end(), locs.begin(), locs.end()));
+}
+TEST(IdentifierInfo, similar_names) {
+  symbol_table table;
+  int value = 0;
+  for (const char* name : { "line_width", "line_color", "width", "x", "y" })
+    table.add_variable(token_kind::tk_identifier, name, make_info_from_var(value));
+  table.add_function(token_kind::tk_identifier, "_iadd_for_test", make_info_from_func(&_iadd_for_test));
+  table.add_function(token_kind::tk_identifier, "_iadd_for_test", make_info_from_func(&_fsub_for_test));
+  table.add_function(token_kind::tk_identifier, "_iget_for_test", make_info_from_func(&_iget_for_test));
+  EXPECT_EQ(table.find_similar_variable("line_widht"), string_ref("line_width"));
+  EXPECT_EQ(table.find_similar_variable("widht"), string_ref("width"));
+  // equally similar
+  EXPECT_EQ(table.find_similar_variable("line_xxxxx"), std::nullopt);
+  // too short or too far
+  EXPECT_EQ(table.find_similar_variable("z"), std::nullopt);
+  EXPECT_EQ(table.find_similar_variable("something"), std::nullopt);
+  // The overloads are one name.
+  EXPECT_EQ(table.find_similar_function("_iadd_for_tset"), string_ref("_iadd_for_test"));
+  EXPECT_EQ(table.find_similar_function("_ixxx_for_test"), std::nullopt);
+  EXPECT_EQ(table.find_similar_function("line_width"), std::nullopt);
+}
+
 /*
 TEST(IdentifierInfo, symbol_table) {
   symbol_table table;
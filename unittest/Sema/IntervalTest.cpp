@@ -0,0 +1,108 @@
+#include <MockTools.h>
+#include <Sema/Sema.h>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+namespace {
+class IntervalTest : public ::testing::Test {
+protected:
+  diag_engine engine;
+  test_diag_consumer consumer;
+  std::unique_ptr<test_file_manager> manager;
+  std::unique_ptr<lexer> l;
+  FLOAT_POINT_T var = 0;
+  symbol_table table;
+
+  void SetUp() override {
+    engine.set_consumer(&consumer);
+    table.add_variable(token_kind::tk_identifier, "x", make_info_from_var(var));
+  }
+
+  template<std::size_t N>
+  interval_result_t evaluate(const char(& str)[N], interval range) {
+    consumer.clear();
+    manager = std::make_unique<test_file_manager>(str);
+    engine.set_file(manager.get());
+    l = std::make_unique<lexer>(manager.get(), engine);
+    parser p(*l);
+    auto ast = p.parse_expr();
+    sema action(engine, table);
+    if (!action.bind_expr_variables(ast.get()))
+      return std::nullopt;
+    return action.evaluate_interval(ast.get(), table.get_variable("x"), range);
+  }
+};
+
+TEST_F(IntervalTest, arithmetic) {
+  {
+    char code[] = "x * 2 + 1";
+    auto result = evaluate(code, interval(-1, 3));
+    ASSERT_TRUE(result);
+    EXPECT_NEAR(result->lo, -1, 1e-9);
+    EXPECT_NEAR(result->hi, 7, 1e-9);
+  }
+  {
+    char code[] = "-x ** 2";
+    auto result = evaluate(code, interval(-2, 1));
+    ASSERT_TRUE(result);
+    EXPECT_NEAR(result->lo, -4, 1e-9);
+    EXPECT_NEAR(result->hi, 0, 1e-9);
+  }
+  {
+    char code[] = "1 / x";
+    EXPECT_FALSE(evaluate(code, interval(-1, 1)));
+    auto result = evaluate(code, interval(2, 4));
+    ASSERT_TRUE(result);
+    EXPECT_NEAR(result->lo, 0.25, 1e-9);
+    EXPECT_NEAR(result->hi, 0.5, 1e-9);
+  }
+  {
+    char code[] = "x ** 0.5";
+    EXPECT_FALSE(evaluate(code, interval(-1, 1)));
+    auto result = evaluate(code, interval(4, 9));
+    ASSERT_TRUE(result);
+    EXPECT_NEAR(result->lo, 2, 1e-9);
+    EXPECT_NEAR(result->hi, 3, 1e-9);
+  }
+}
+
+TEST_F(IntervalTest, function) {
+  {
+    char code[] = "sin(x)";
+    auto result = evaluate(code, interval(0, 2));
+    ASSERT_TRUE(result);
+    EXPECT_NEAR(result->lo, 0, 1e-9);
+    EXPECT_NEAR(result->hi, 1, 1e-9);
+  }
+  {
+    char code[] = "cos(x)";
+    auto result = evaluate(code, interval(3, 3.5));
+    ASSERT_TRUE(result);
+    EXPECT_NEAR(result->lo, -1, 1e-9);
+    EXPECT_NEAR(result->hi, std::cos(3.5), 1e-9);
+  }
+  {
+    char code[] = "tan(x)";
+    EXPECT_FALSE(evaluate(code, interval(1, 2)));
+    auto result = evaluate(code, interval(-1, 1));
+    ASSERT_TRUE(result);
+    EXPECT_NEAR(result->lo, std::tan(-1), 1e-9);
+    EXPECT_NEAR(result->hi, std::tan(1), 1e-9);
+  }
+  {
+    char code[] = "ln(x) + abs(x - 3)";
+    EXPECT_FALSE(evaluate(code, interval(0, 1)));
+    auto result = evaluate(code, interval(1, 4));
+    ASSERT_TRUE(result);
+    EXPECT_LE(result->lo, 0);
+    EXPECT_GE(result->hi, std::log(4) + 1);
+  }
+  {
+    // impure functions cannot be evaluated
+    char code[] = "rand_int(0, x)";
+    EXPECT_FALSE(evaluate(code, interval(0, 1)));
+  }
+}
+
+} // namespace
+INTERPRETER_NAMESPACE_END
@@ -0,0 +1,62 @@
+#include <Utils/BKTree.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <string>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+TEST(BKTreeTest, basic) {
+  bk_tree tree;
+  EXPECT_TRUE(tree.find_closest("abc", 5).empty());
+  for (const char* word : { "book", "books", "cake", "boo", "cape", "cart", "boon", "book" })
+    tree.insert(word);
+  EXPECT_EQ(tree.size(), 7);
+  EXPECT_EQ(tree.find_closest("book", 5), std::vector<string_ref>{ "book" });
+  EXPECT_EQ(tree.find_closest("bookss", 5), std::vector<string_ref>{ "books" });
+  std::vector<string_ref> result = tree.find_closest("caqe", 2);
+  std::sort(result.begin(), result.end());
+  EXPECT_EQ(result, (std::vector<string_ref>{ "cake", "cape" }));
+  EXPECT_TRUE(tree.find_closest("caqe", 0).empty());
+  // The distance must be less than the length of both words.
+  EXPECT_TRUE(tree.find_closest("b", 5).empty());
+}
+
+TEST(BKTreeTest, same_as_full_scan) {
+  std::mt19937 engine(1);
+  auto random_word = [&engine]() {
+    std::uniform_int_distribution<int> length(1, 8), letter('a', 'e');
+    std::string result(static_cast<std::size_t>(length(engine)), ' ');
+    for (char& ch : result)
+      ch = static_cast<char>(letter(engine));
+    return result;
+  };
+  std::vector<std::string> words(2000);
+  bk_tree tree;
+  for (std::string& word : words) {
+    word = random_word();
+    tree.insert(word);
+  }
+  for (int i = 0; i < 200; ++i) {
+    std::string query = random_word();
+    string_ref ref = query;
+    unsigned best = 3;
+    std::vector<string_ref> expected;
+    for (const std::string& word : words) {
+      unsigned distance = ref.edit_distance(word);
+      if (distance > best || distance >= std::min(query.size(), word.size()))
+        continue;
+      if (distance < best)
+        expected.clear();
+      best = distance;
+      if (std::find(expected.begin(), expected.end(), string_ref(word)) == expected.end())
+        expected.push_back(word);
+    }
+    std::vector<string_ref> result = tree.find_closest(query, 3);
+    std::sort(expected.begin(), expected.end());
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(result, expected) << query;
+  }
+}
+
+INTERPRETER_NAMESPACE_END
@@ -0,0 +1,37 @@
+#include <Utils/Counters.h>
+#include <gtest/gtest.h>
+
+INTERPRETER_NAMESPACE_BEGIN
+
+TEST(CountersTest, disabled) {
+  counter_registry::reset();
+  ASSERT_FALSE(counter_registry::is_enabled());
+  counter& c = counter_registry::get("test", "disabled");
+  c.add();
+  c.add(10);
+  EXPECT_EQ(c.get(), 0);
+  EXPECT_EQ(counter_registry::to_json(), "{}");
+}
+
+TEST(CountersTest, json) {
+  counter_registry::reset();
+  counter_registry::enable();
+  counter& b = counter_registry::get("test", "b");
+  // The same counter is returned for the same names.
+  EXPECT_EQ(&b, &counter_registry::get("test", "b"));
+  b.add(3);
+  counter_registry::get("test", "a").add();
+  counter_registry::get("another", "\"quoted\"").add(2);
+  counter_registry::get("another", "zero");
+  counter_registry::get("empty", "zero");
+  counter_registry::enable(false);
+  b.add();
+  EXPECT_EQ(b.get(), 3);
+  EXPECT_EQ(counter_registry::to_json(),
+            R"({"another": {"\"quoted\"": 2}, "test": {"a": 1, "b": 3}})");
+  counter_registry::reset();
+  EXPECT_EQ(b.get(), 0);
+  EXPECT_EQ(counter_registry::to_json(), "{}");
+}
+
+INTERPRETER_NAMESPACE_END